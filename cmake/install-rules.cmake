@@ -1,5 +1,5 @@
 install(
-    TARGETS krompir_exe
+    TARGETS krompir_exe krompir_blogq
     RUNTIME COMPONENT krompir_Runtime
 )
 
@@ -26,3 +26,23 @@ if(NOT PROJECT_IS_TOP_LEVEL)
     set(warning_guard SYSTEM)
   endif()
 endif()
+
+# ---- Allocation tracking ----
+
+# Replaces the global operator new/delete to count allocations per subsystem,
+# which costs a little on every allocation, so it is off unless asked for
+option(
+    krompir_TRACK_ALLOCATIONS
+    "Count heap allocations per subsystem and show them in the GUI"
+    OFF
+)
+
+# ---- io_uring ----
+
+# Lets instance verification batch its reads through io_uring on Linux, with
+# no library needed, falling back to blocking reads when the kernel says no
+option(
+    krompir_USE_IO_URING
+    "Read files through io_uring on Linux when verifying instances"
+    ON
+)
@@ -15,6 +15,8 @@ class Recipe(ConanFile):
 
         self.requires("argparse/2.9")
 
+        self.requires("zlib/1.3")
+
     def build_requirements(self):
         self.test_requires("catch2/3.3.1")
 
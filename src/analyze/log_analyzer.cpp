@@ -0,0 +1,794 @@
+#include "log_analyzer.hpp"
+
+#include "logging.hpp"
+#include "memory/alloc_tracker.hpp"
+#include "metrics/metrics.hpp"
+#include "packs/pack.hpp"
+#include "utils/mapped_file.hpp"
+#include "utils/strings.hpp"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+
+namespace {
+
+using krompir::analyze::ClassIndex;
+using krompir::analyze::Suspect;
+using krompir::utils::StringHash;
+
+using Scores = std::unordered_map<std::string, Suspect, StringHash, std::equal_to<>>;
+
+// Don't bother splitting logs smaller than this between threads
+constexpr std::size_t MIN_CHUNK_SIZE = 8u << 20u;
+
+// How much each kind of evidence counts towards a mod's score
+constexpr double FRAME_WEIGHT = 4.0;
+constexpr double FRAME_DECAY = 0.25;
+constexpr double MIXIN_WEIGHT = 6.0;
+constexpr double SUSPECTED_WEIGHT = 10.0;
+constexpr double ERROR_LINE_WEIGHT = 0.5;
+
+/**
+ * Mod IDs, module names and JARs that belong to the game or the mod loader.
+ *
+ * These show up in nearly every stack trace and are never the culprit.
+ */
+constexpr std::array PLATFORM_MODS = {
+    std::string_view("bootstraplauncher"),
+    std::string_view("client"),
+    std::string_view("eventbus"),
+    std::string_view("fabric-loader"),
+    std::string_view("fabricloader"),
+    std::string_view("fml"),
+    std::string_view("fmlcore"),
+    std::string_view("fmlloader"),
+    std::string_view("forge"),
+    std::string_view("intermediary"),
+    std::string_view("java"),
+    std::string_view("javafmllanguage"),
+    std::string_view("knot"),
+    std::string_view("minecraft"),
+    std::string_view("mixin"),
+    std::string_view("modlauncher"),
+    std::string_view("neoforge"),
+    std::string_view("patched"),
+    std::string_view("securejarhandler"),
+    std::string_view("server"),
+    std::string_view("unknown"),
+};
+
+/**
+ * Packages of the JDK, the game, the mod loaders and their libraries.
+ */
+constexpr std::array PLATFORM_PACKAGES = {
+    std::string_view("com.google."),
+    std::string_view("com.mojang."),
+    std::string_view("cpw.mods."),
+    std::string_view("io.netty."),
+    std::string_view("it.unimi."),
+    std::string_view("java."),
+    std::string_view("javax."),
+    std::string_view("jdk."),
+    std::string_view("net.fabricmc."),
+    std::string_view("net.minecraft."),
+    std::string_view("net.minecraftforge."),
+    std::string_view("net.neoforged."),
+    std::string_view("org.apache."),
+    std::string_view("org.lwjgl."),
+    std::string_view("org.spongepowered."),
+    std::string_view("sun."),
+};
+
+/**
+ * Prefixes of methods merged into a class by mixin, whose names embed the mod ID.
+ *
+ * e.g. `handler$zbd000$sodium$onRender`
+ */
+constexpr std::array MIXIN_METHOD_PREFIXES = {
+    std::string_view("handler"),
+    std::string_view("localvar"),
+    std::string_view("modify"),
+    std::string_view("modifyExpressionValue"),
+    std::string_view("redirect"),
+    std::string_view("wrapOperation"),
+    std::string_view("wrapWithCondition"),
+};
+
+bool
+is_platform_mod(std::string_view mod)
+{
+    return std::find(PLATFORM_MODS.begin(), PLATFORM_MODS.end(), mod)
+           != PLATFORM_MODS.end();
+}
+
+bool
+is_platform_class(std::string_view class_name)
+{
+    return std::any_of(
+        PLATFORM_PACKAGES.begin(),
+        PLATFORM_PACKAGES.end(),
+        [&](std::string_view pkg) { return class_name.starts_with(pkg); }
+    );
+}
+
+/**
+ * Check if a string looks like a mod ID, i.e. `[a-z0-9_.-]{2,64}`.
+ */
+bool
+is_mod_id(std::string_view str)
+{
+    constexpr std::size_t MAX_LENGTH = 64;
+    if (str.size() < 2 || str.size() > MAX_LENGTH)
+        return false;
+
+    return std::all_of(str.begin(), str.end(), [](char chr) {
+        return (chr >= 'a' && chr <= 'z') || (chr >= '0' && chr <= '9') || chr == '_'
+               || chr == '-' || chr == '.';
+    });
+}
+
+/**
+ * Check if a log line was logged at ERROR or FATAL level.
+ */
+bool
+is_error_line(std::string_view line)
+{
+    return line.find("/ERROR]") != std::string_view::npos
+           || line.find("/FATAL]") != std::string_view::npos;
+}
+
+/**
+ * Guess a mod ID from a mixin config name such as `create.mixins.json`.
+ */
+std::string_view
+mixin_config_mod(std::string_view config)
+{
+    if (config.ends_with(".json"))
+        config.remove_suffix(std::string_view(".json").size());
+
+    while (!config.empty()) {
+        const auto dot = config.find('.');
+        const auto token = config.substr(0, dot);
+
+        if (token != "mixins" && token != "mixin" && is_mod_id(token))
+            return token;
+        if (dot == std::string_view::npos)
+            break;
+
+        config.remove_prefix(dot + 1);
+    }
+
+    return {};
+}
+
+/**
+ * Scans part of a log, collecting evidence against mods.
+ */
+class ChunkScanner {
+    const ClassIndex& index_;
+    Scores& scores_;
+    Scores* unsettled_;
+
+    std::size_t lines_ = 0;
+    std::size_t frame_depth_ = 0;
+    bool in_suspected_ = false;
+    const char* settled_at_ = nullptr;
+
+    enum class Evidence { frame, mixin, mention };
+
+    void
+    blame_(std::string_view mod, Evidence kind, double weight)
+    {
+        if (mod.empty() || is_platform_mod(mod))
+            return;
+
+        auto& scores = unsettled_ != nullptr ? *unsettled_ : scores_;
+
+        auto iter = scores.find(mod);
+        if (iter == scores.end())
+            iter = scores.emplace(mod, Suspect{.mod = std::string(mod)}).first;
+
+        auto& suspect = iter->second;
+        suspect.score += weight;
+
+        switch (kind) {
+            case Evidence::frame:
+                ++suspect.frames;
+                break;
+            case Evidence::mixin:
+                ++suspect.mixins;
+                break;
+            case Evidence::mention:
+                ++suspect.mentions;
+                break;
+        }
+    }
+
+    void
+    blame_mixin_config_(std::string_view config, double weight)
+    {
+        if (auto mod = index_.find(config))
+            blame_(*mod, Evidence::mixin, weight);
+        else
+            blame_(mixin_config_mod(config), Evidence::mixin, weight);
+    }
+
+    /**
+     * Blame every mixin config listed in a transformer annotation, e.g.
+     * `{re:mixin,pl:mixin:APP:create.mixins.json:Foo,pl:mixin:A}`.
+     */
+    void
+    transformers_(std::string_view text, double weight)
+    {
+        constexpr std::string_view MARKER = "pl:mixin:APP:";
+
+        for (auto pos = text.find(MARKER); pos != std::string_view::npos;
+             pos = text.find(MARKER, pos)) {
+            pos += MARKER.size();
+
+            const auto config = text.substr(pos, text.find_first_of(":,}", pos) - pos);
+            blame_mixin_config_(config, weight);
+        }
+    }
+
+    /**
+     * Handle a stack frame, without the leading `at `.
+     *
+     * e.g. `TRANSFORMER/create@0.5.1/com.example.Foo.bar(Foo.java:12) ~[create.jar:?]`
+     */
+    void
+    frame_(std::string_view frame)
+    {
+        const double weight =
+            FRAME_WEIGHT / (1.0 + FRAME_DECAY * static_cast<double>(frame_depth_));
+
+        const auto paren = frame.find('(');
+        if (paren == std::string_view::npos)
+            return;
+
+        auto qualified = frame.substr(0, paren);
+        const auto rest = frame.substr(paren);
+
+        // Module path, e.g. `TRANSFORMER/create@0.5.1/`
+        std::string_view module_mod;
+        if (const auto slash = qualified.rfind('/'); slash != std::string_view::npos) {
+            auto modules = qualified.substr(0, slash);
+            qualified.remove_prefix(slash + 1);
+
+            while (!modules.empty()) {
+                const auto sep = modules.find('/');
+                const auto module = modules.substr(0, sep);
+
+                if (const auto at_sign = module.find('@');
+                    at_sign != std::string_view::npos) {
+                    module_mod = module.substr(0, at_sign);
+                }
+
+                if (sep == std::string_view::npos)
+                    break;
+                modules.remove_prefix(sep + 1);
+            }
+        }
+
+        const auto dot = qualified.rfind('.');
+        if (dot == std::string_view::npos)
+            return;
+
+        const auto class_name = qualified.substr(0, dot);
+        const auto method = qualified.substr(dot + 1);
+
+        // Mixin handlers merged into the class: `handler$zbd000$modid$name`
+        if (const auto sep = method.find('$'); sep != std::string_view::npos) {
+            const auto kind = method.substr(0, sep);
+            const auto tail = method.substr(sep + 1);
+
+            const auto id_start = tail.find('$');
+            const bool is_handler = std::find(
+                                        MIXIN_METHOD_PREFIXES.begin(),
+                                        MIXIN_METHOD_PREFIXES.end(),
+                                        kind
+                                    )
+                                    != MIXIN_METHOD_PREFIXES.end();
+
+            if (is_handler && id_start != std::string_view::npos) {
+                auto mod = tail.substr(id_start + 1);
+                mod = mod.substr(0, mod.find('$'));
+
+                if (mod.size() < tail.size() - id_start - 1 && is_mod_id(mod))
+                    blame_(mod, Evidence::mixin, weight);
+            }
+        }
+
+        // Mixin configs applied to the class
+        transformers_(rest, weight);
+
+        // Now work out who owns the class itself
+        if (auto mod = index_.find_class(class_name)) {
+            blame_(*mod, Evidence::frame, weight);
+            return;
+        }
+
+        if (!module_mod.empty()) {
+            blame_(module_mod, Evidence::frame, weight);
+            return;
+        }
+
+        if (is_platform_class(class_name))
+            return;
+
+        // JAR annotation, e.g. `~[create-1.20.1-0.5.1.jar%23123!/:?]`
+        const auto open = rest.find('[');
+        const auto jar_end = rest.find(".jar", open);
+        if (open == std::string_view::npos || jar_end == std::string_view::npos)
+            return;
+
+        if (auto mod = index_.find(rest.substr(open + 1, jar_end + 3 - open))) {
+            blame_(*mod, Evidence::frame, weight);
+            return;
+        }
+
+        // Without an index entry, fall back to the JAR name less its version
+        const auto jar = krompir::packs::split_jar_name(
+            rest.substr(open + 1, jar_end - open - 1)
+        );
+        if (is_mod_id(jar.id))
+            blame_(jar.id, Evidence::frame, weight);
+    }
+
+    /**
+     * Handle an entry in a crash report's "Suspected Mods" section.
+     *
+     * e.g. `Create (create), Version: 0.5.1`
+     */
+    void
+    suspected_(std::string_view line)
+    {
+        const auto close = line.find(')');
+        const auto open = line.rfind('(', close);
+        if (close == std::string_view::npos || open == std::string_view::npos)
+            return;
+
+        const auto mod = line.substr(open + 1, close - open - 1);
+        if (is_mod_id(mod))
+            blame_(mod, Evidence::mention, SUSPECTED_WEIGHT);
+    }
+
+    /**
+     * Handle an ERROR or FATAL line.
+     *
+     * Forge prefixes messages with the logger, which is often the mod ID:
+     * `[12:00:00] [main/ERROR] [create/]: ...`
+     */
+    void
+    error_line_(std::string_view line)
+    {
+        // Mixin errors name the offending mod, or at least its config
+        bool found_mod = false;
+        for (const auto marker : {"from mod ", "for mod "}) {
+            const auto pos = line.find(marker);
+            if (pos == std::string_view::npos)
+                continue;
+
+            auto mod = line.substr(pos + std::string_view(marker).size());
+            mod = mod.substr(0, mod.find_first_of(" \t:,"));
+
+            if (is_mod_id(mod)) {
+                blame_(mod, Evidence::mixin, MIXIN_WEIGHT);
+                found_mod = true;
+                break;
+            }
+        }
+
+        for (auto pos = line.find(".json"); !found_mod && pos != std::string_view::npos;
+             pos = line.find(".json", pos + 1)) {
+            const auto start = line.find_last_of(" \t[('\"", pos);
+            const auto begin = start == std::string_view::npos ? 0 : start + 1;
+            const auto config = line.substr(begin, pos + 5 - begin);
+
+            if (config.find("mixin") != std::string_view::npos)
+                blame_mixin_config_(config, MIXIN_WEIGHT);
+        }
+
+        // Logger name, following the thread and level
+        auto level_end = line.find("/ERROR] [");
+        if (level_end == std::string_view::npos)
+            level_end = line.find("/FATAL] [");
+        if (level_end == std::string_view::npos)
+            return;
+
+        auto logger = line.substr(level_end + std::string_view("/ERROR] [").size());
+        logger = logger.substr(0, logger.find(']'));
+        if (logger.ends_with('/'))
+            logger.remove_suffix(1);
+
+        if (logger.find('.') != std::string_view::npos) {
+            if (auto mod = index_.find_class(logger))
+                blame_(*mod, Evidence::mention, ERROR_LINE_WEIGHT);
+        }
+        else if (is_mod_id(logger)) {
+            blame_(logger, Evidence::mention, ERROR_LINE_WEIGHT);
+        }
+    }
+
+public:
+    /**
+     * @param scores Where to add evidence.
+     * @param unsettled Where to add evidence until a line shows whether the
+     *        chunk started inside a "Suspected Mods" section, or null if
+     *        `in_suspected` is known to be right.
+     * @param in_suspected Whether the chunk starts inside such a section.
+     */
+    ChunkScanner(
+        const ClassIndex& index,
+        Scores& scores,
+        Scores* unsettled = nullptr,
+        bool in_suspected = false
+    ) :
+        index_(index), scores_(scores), unsettled_(unsettled),
+        in_suspected_(in_suspected)
+    {}
+
+    void
+    operator()(std::string_view line)
+    {
+        ++lines_;
+
+        const auto trimmed = krompir::utils::trim_left(line);
+
+        // Both end or start a section, whatever came before them
+        if (unsettled_ != nullptr
+            && (trimmed.empty() || trimmed.starts_with("Suspected Mod"))) {
+            unsettled_ = nullptr;
+            settled_at_ = line.data();
+        }
+
+        if (trimmed.starts_with("at ")) {
+            frame_(trimmed.substr(3));
+            ++frame_depth_;
+            return;
+        }
+
+        frame_depth_ = 0;
+
+        if (in_suspected_) {
+            if (trimmed.empty()) {
+                in_suspected_ = false;
+                return;
+            }
+
+            suspected_(trimmed);
+            return;
+        }
+
+        if (trimmed.starts_with("Suspected Mod")) {
+            in_suspected_ = true;
+            suspected_(trimmed);
+            return;
+        }
+
+        if (is_error_line(line) || !trimmed.starts_with('['))
+            error_line_(line);
+    }
+
+    [[nodiscard]] std::size_t
+    lines() const noexcept
+    {
+        return lines_;
+    }
+
+    [[nodiscard]] bool
+    in_suspected() const noexcept
+    {
+        return in_suspected_;
+    }
+
+    /**
+     * Get the lines of `chunk` whose evidence went to the unsettled scores.
+     */
+    [[nodiscard]] std::string_view
+    unsettled(std::string_view chunk) const noexcept
+    {
+        if (settled_at_ == nullptr)
+            return chunk;
+
+        return chunk.substr(0, static_cast<std::size_t>(settled_at_ - chunk.data()));
+    }
+};
+
+/**
+ * Check if the line at the start of `text` is a stack frame.
+ */
+bool
+starts_with_frame(std::string_view text)
+{
+    const auto line = text.substr(0, text.find('\n'));
+    return krompir::utils::trim_left(line).starts_with("at ");
+}
+
+/**
+ * Split `text` into roughly even chunks, on line boundaries.
+ *
+ * Stack traces are never split, as the weight of a frame depends on its depth.
+ */
+std::vector<std::string_view>
+split_chunks(std::string_view text, unsigned threads)
+{
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+
+    const std::size_t count =
+        std::clamp<std::size_t>(text.size() / MIN_CHUNK_SIZE, 1, threads);
+    const std::size_t target = text.size() / count;
+
+    std::vector<std::string_view> chunks;
+    chunks.reserve(count);
+
+    while (!text.empty()) {
+        if (chunks.size() + 1 == count || text.size() <= target) {
+            chunks.push_back(text);
+            break;
+        }
+
+        auto end = text.find('\n', target);
+        while (end != std::string_view::npos && starts_with_frame(text.substr(end + 1)))
+            end = text.find('\n', end + 1);
+        end = end == std::string_view::npos ? text.size() : end + 1;
+
+        chunks.push_back(text.substr(0, end));
+        text.remove_prefix(end);
+    }
+
+    return chunks;
+}
+
+/**
+ * Scan a log in parallel, adding evidence to `scores`.
+ *
+ * @returns The number of lines scanned.
+ */
+std::size_t
+scan(std::string_view text, const ClassIndex& index, unsigned threads, Scores& scores)
+{
+    const auto chunks = split_chunks(text, threads);
+
+    /**
+     * Chunks after the first are scanned as if they did not start inside a
+     * "Suspected Mods" section, keeping the evidence found before that is
+     * known apart, to scan it again if they did.
+     */
+    struct Partial {
+        Scores scores;
+        Scores unsettled;
+        std::string_view unsettled_text;
+        bool in_suspected = false;
+        std::size_t lines = 0;
+    };
+
+    std::vector<Partial> partial(chunks.size());
+
+    auto run = [&](std::size_t idx) {
+        const krompir::memory::AllocScope scope(krompir::memory::Subsystem::scanner);
+        auto& part = partial[idx];
+
+        ChunkScanner scanner(index, part.scores, idx == 0 ? nullptr : &part.unsettled);
+        krompir::utils::for_each_line(chunks[idx], scanner);
+
+        if (idx > 0)
+            part.unsettled_text = scanner.unsettled(chunks[idx]);
+        part.in_suspected = scanner.in_suspected();
+        part.lines = scanner.lines();
+    };
+
+    {
+        std::vector<std::jthread> workers;
+        workers.reserve(chunks.size());
+
+        for (std::size_t idx = 1; idx < chunks.size(); ++idx)
+            workers.emplace_back(run, idx);
+
+        if (!chunks.empty())
+            run(0);
+    }
+
+    auto merge = [&](const Scores& from) {
+        for (const auto& [mod, suspect] : from) {
+            auto [iter, inserted] = scores.try_emplace(mod, suspect);
+            if (inserted)
+                continue;
+
+            iter->second.score += suspect.score;
+            iter->second.frames += suspect.frames;
+            iter->second.mixins += suspect.mixins;
+            iter->second.mentions += suspect.mentions;
+        }
+    };
+
+    std::size_t total = 0;
+    bool in_suspected = false;
+
+    for (std::size_t idx = 0; idx < chunks.size(); ++idx) {
+        auto& part = partial[idx];
+        total += part.lines;
+
+        if (in_suspected) {
+            part.unsettled.clear();
+
+            ChunkScanner scanner(index, part.unsettled, nullptr, true);
+            krompir::utils::for_each_line(part.unsettled_text, scanner);
+
+            if (part.unsettled_text.size() == chunks[idx].size())
+                part.in_suspected = scanner.in_suspected();
+        }
+
+        merge(part.unsettled);
+        merge(part.scores);
+        in_suspected = part.in_suspected;
+    }
+
+    return total;
+}
+
+/**
+ * Rank the accumulated suspects, most likely culprit first.
+ */
+std::vector<Suspect>
+rank(Scores& scores)
+{
+    std::vector<Suspect> suspects;
+    suspects.reserve(scores.size());
+
+    for (auto& [mod, suspect] : scores)
+        suspects.push_back(std::move(suspect));
+
+    std::sort(suspects.begin(), suspects.end(), [](const auto& lhs, const auto& rhs) {
+        if (lhs.score > rhs.score)
+            return true;
+        if (lhs.score < rhs.score)
+            return false;
+        return lhs.mod < rhs.mod;
+    });
+
+    return suspects;
+}
+
+} // namespace
+
+namespace krompir {
+namespace analyze {
+
+void
+ClassIndex::add(std::string key, std::string mod)
+{
+    entries_.insert_or_assign(std::move(key), std::move(mod));
+}
+
+std::optional<std::string_view>
+ClassIndex::find(std::string_view key) const
+{
+    if (auto iter = entries_.find(key); iter != entries_.end())
+        return iter->second;
+    return {};
+}
+
+std::optional<std::string_view>
+ClassIndex::find_class(std::string_view class_name) const
+{
+    if (entries_.empty())
+        return {};
+
+    // Inner classes belong to their outer class
+    class_name = class_name.substr(0, class_name.find('$'));
+
+    while (!class_name.empty()) {
+        if (auto mod = find(class_name))
+            return mod;
+
+        const auto dot = class_name.rfind('.');
+        if (dot == std::string_view::npos)
+            break;
+
+        class_name = class_name.substr(0, dot);
+    }
+
+    return {};
+}
+
+ClassIndex
+ClassIndex::load(const std::filesystem::path& path)
+{
+    const utils::MappedFile file(path);
+    ClassIndex index;
+
+    utils::for_each_line(file.view(), [&](std::string_view line) {
+        line = utils::trim(line);
+        if (line.empty() || line.starts_with('#'))
+            return;
+
+        const auto sep = line.find_first_of(" \t");
+        if (sep == std::string_view::npos)
+            return;
+
+        index.add(
+            std::string(line.substr(0, sep)), std::string(utils::trim(line.substr(sep)))
+        );
+    });
+
+    return index;
+}
+
+Analysis
+analyze_log(std::string_view text, const ClassIndex& index, unsigned threads)
+{
+    const memory::AllocScope scope(memory::Subsystem::scanner);
+
+    Scores scores;
+    Analysis result;
+
+    result.lines = scan(text, index, threads, scores);
+    result.bytes = text.size();
+    result.suspects = rank(scores);
+
+    return result;
+}
+
+Analysis
+analyze_files(
+    const std::vector<std::filesystem::path>& paths,
+    const ClassIndex& index,
+    unsigned threads
+)
+{
+    static auto& files_total =
+        metrics::counter("krompir_analyze_files_total", "Logs and crash reports read");
+    static auto& bytes_total =
+        metrics::counter("krompir_analyze_bytes_total", "Bytes of logs analyzed");
+    static auto& lines_total =
+        metrics::counter("krompir_analyze_lines_total", "Lines of logs analyzed");
+    static auto& duration = metrics::histogram(
+        "krompir_analyze_duration_nanoseconds", "Time to analyze a set of logs"
+    );
+
+    const memory::AllocScope scope(memory::Subsystem::scanner);
+    const auto start = std::chrono::steady_clock::now();
+
+    Scores scores;
+    Analysis result;
+
+    for (const auto& path : paths) {
+        const utils::MappedFile file(path);
+
+        result.lines += scan(file.view(), index, threads, scores);
+        result.bytes += file.size();
+    }
+
+    result.suspects = rank(scores);
+
+    files_total.add(paths.size());
+    bytes_total.add(result.bytes);
+    lines_total.add(result.lines);
+    duration.record(std::chrono::steady_clock::now() - start);
+
+    log_i(
+        analyze,
+        "Analyzed {} lines ({} bytes) from {} files in {}, {} suspects",
+        result.lines,
+        result.bytes,
+        paths.size(),
+        std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start
+        ),
+        result.suspects.size()
+    );
+
+    return result;
+}
+
+} // namespace analyze
+} // namespace krompir
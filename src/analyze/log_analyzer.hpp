@@ -0,0 +1,120 @@
+/**
+ * @file log_analyzer.hpp
+ * @brief Find the mods responsible for a crash from logs and crash reports.
+ * @copyright MIT
+ */
+#pragma once
+
+#include "utils/strings.hpp"
+
+#include <cstddef>
+#include <filesystem>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace krompir {
+namespace analyze {
+
+/**
+ * Maps Java class names, JAR file names and mixin configs back to mod IDs.
+ *
+ * Class names are matched on their longest package prefix, so an entry for
+ * `com.simibubi.create` will claim `com.simibubi.create.content.Foo`.
+ */
+class ClassIndex {
+    std::unordered_map<std::string, std::string, utils::StringHash, std::equal_to<>>
+        entries_;
+
+public:
+    /**
+     * Add a class, package, JAR file name or mixin config to the index.
+     *
+     * @param key The name to match, e.g. `com.example.mod` or `example.jar`.
+     * @param mod The ID of the mod that owns it.
+     */
+    void add(std::string key, std::string mod);
+
+    /**
+     * Find the mod owning exactly `key`.
+     */
+    [[nodiscard]] std::optional<std::string_view> find(std::string_view key) const;
+
+    /**
+     * Find the mod owning a fully qualified class name, by longest package prefix.
+     */
+    [[nodiscard]] std::optional<std::string_view>
+    find_class(std::string_view class_name) const;
+
+    /**
+     * Get the number of entries in the index.
+     */
+    [[nodiscard]] std::size_t
+    size() const noexcept
+    {
+        return entries_.size();
+    }
+
+    /**
+     * Load an index from a text file.
+     *
+     * Every non-empty line holds a key and a mod ID separated by whitespace,
+     * and lines starting with `#` are ignored.
+     *
+     * @throws std::system_error if the file cannot be read.
+     */
+    static ClassIndex load(const std::filesystem::path& path);
+};
+
+/**
+ * A mod suspected of causing a crash, along with the evidence against it.
+ */
+struct Suspect {
+    std::string mod;
+    double score = 0;
+
+    std::size_t frames = 0;   ///< Stack frames in the mod's code
+    std::size_t mixins = 0;   ///< Mixins applied by the mod on the failing path
+    std::size_t mentions = 0; ///< Error lines and crash report "suspected mods"
+};
+
+/**
+ * The outcome of analyzing one or more logs.
+ */
+struct Analysis {
+    /// Suspects, most likely culprit first.
+    std::vector<Suspect> suspects;
+
+    std::size_t bytes = 0;
+    std::size_t lines = 0;
+};
+
+/**
+ * Analyze a log or crash report held in memory.
+ *
+ * @param text The contents of the log.
+ * @param index Index used to map class names back to mods.
+ * @param threads Number of worker threads, or 0 to pick one per core.
+ */
+Analysis
+analyze_log(std::string_view text, const ClassIndex& index, unsigned threads = 0);
+
+/**
+ * Memory map and analyze a set of logs and crash reports.
+ *
+ * Evidence is accumulated over all files, so a crash report and the
+ * `latest.log` of the same session can be analyzed together.
+ *
+ * @throws std::system_error if a file cannot be mapped.
+ */
+Analysis analyze_files(
+    const std::vector<std::filesystem::path>& paths,
+    const ClassIndex& index,
+    unsigned threads = 0
+);
+
+} // namespace analyze
+} // namespace krompir
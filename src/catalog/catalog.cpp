@@ -0,0 +1,1163 @@
+#include "catalog.hpp"
+
+#include "logging.hpp"
+
+#include <fmt/core.h>
+#include <zlib.h>
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <numeric>
+#include <span>
+#include <system_error>
+#include <tuple>
+#include <type_traits>
+#include <unordered_set>
+#include <utility>
+
+namespace {
+
+using krompir::catalog::Catalog;
+using krompir::catalog::CatalogError;
+using krompir::catalog::CatalogProject;
+using krompir::catalog::Dictionary;
+using Column = Catalog::Column;
+
+/// A string column of projects
+using StringField = std::string CatalogProject::*;
+
+/// A set column of projects
+using SetField = std::vector<std::string> CatalogProject::*;
+
+static_assert(
+    std::endian::native == std::endian::little, "snapshots are read in place"
+);
+
+/// Identifies snapshots, the last character is the format version
+constexpr std::string_view MAGIC = "KRCATLG2";
+
+/// Size of the header at the start of a snapshot
+constexpr std::size_t HEADER_SIZE = 48;
+
+/**
+ * Get the index of a column.
+ */
+constexpr std::size_t
+index(Column column)
+{
+    return static_cast<std::size_t>(column);
+}
+
+/**
+ * Get the index of a set column, among set columns.
+ */
+constexpr std::size_t
+set_index(Column column)
+{
+    return index(column) - index(Column::loaders);
+}
+
+/**
+ * Add a dictionary ID to the summary of a block.
+ */
+void
+add_id(std::vector<std::uint64_t>& summary, std::uint16_t id)
+{
+    constexpr std::size_t bits = 64;
+
+    if (summary.size() <= id / bits)
+        summary.resize(id / bits + 1);
+    summary[id / bits] |= std::uint64_t{1} << (id % bits);
+}
+
+/**
+ * Check if the summary of a block has a dictionary ID.
+ */
+bool
+has_id(const std::vector<std::uint64_t>& summary, std::uint16_t id)
+{
+    constexpr std::size_t bits = 64;
+
+    return id / bits < summary.size()
+           && (summary[id / bits] & (std::uint64_t{1} << (id % bits))) != 0;
+}
+
+// Bits and hashes per project in the ID filter of a block, about 1% false positives
+constexpr std::size_t ID_FILTER_BITS = 10;
+constexpr std::size_t ID_FILTER_HASHES = 4;
+
+/**
+ * Call a function with every bit that a project ID sets in an ID filter.
+ */
+template <typename Func>
+void
+for_each_filter_bit(std::string_view id, std::size_t bits, Func&& func)
+{
+    constexpr unsigned half = 32;
+
+    // Double hashing, both halves come from one stable hash
+    const auto hash = krompir::utils::fnv1a(id);
+    const auto step = hash >> half | 1u;
+
+    for (std::size_t idx = 0; idx < ID_FILTER_HASHES; ++idx)
+        func(static_cast<std::size_t>((hash + idx * step) % bits));
+}
+
+/**
+ * Make the ID filter of a block, a bloom filter of the IDs of its projects.
+ */
+std::vector<std::uint64_t>
+make_id_filter(std::span<const CatalogProject> projects)
+{
+    constexpr std::size_t bits = 64;
+
+    std::vector<std::uint64_t> filter(
+        (projects.size() * ID_FILTER_BITS + bits - 1) / bits
+    );
+
+    for (const auto& project : projects) {
+        for_each_filter_bit(project.id, filter.size() * bits, [&](std::size_t bit) {
+            filter[bit / bits] |= std::uint64_t{1} << (bit % bits);
+        });
+    }
+
+    return filter;
+}
+
+/**
+ * Check if a project may be in a block, according to its ID filter.
+ */
+bool
+may_contain(const std::vector<std::uint64_t>& filter, std::string_view id)
+{
+    constexpr std::size_t bits = 64;
+
+    if (filter.empty())
+        return false;
+
+    bool found = true;
+    for_each_filter_bit(id, filter.size() * bits, [&](std::size_t bit) {
+        found = found && (filter[bit / bits] >> (bit % bits) & 1u) != 0;
+    });
+
+    return found;
+}
+
+/**
+ * Appends little endian values to a buffer.
+ */
+class ByteWriter {
+    std::string& out_;
+
+public:
+    explicit ByteWriter(std::string& out) : out_(out) {}
+
+    template <typename T>
+    void
+    put(T value)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+
+        std::array<char, sizeof(T)> bytes{};
+        std::memcpy(bytes.data(), &value, sizeof(T));
+        out_.append(bytes.data(), bytes.size());
+    }
+
+    void
+    put_bytes(std::string_view bytes)
+    {
+        out_.append(bytes);
+    }
+};
+
+/**
+ * Reads little endian values from a buffer.
+ */
+class ByteReader {
+    std::string_view data_;
+    std::size_t pos_ = 0;
+
+public:
+    explicit ByteReader(std::string_view data, std::size_t pos = 0) :
+        data_(data), pos_(pos)
+    {}
+
+    template <typename T>
+    T
+    get()
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+
+        T value;
+        std::memcpy(&value, bytes(sizeof(T)).data(), sizeof(T));
+        return value;
+    }
+
+    std::string_view
+    bytes(std::size_t size)
+    {
+        if (size > data_.size() - std::min(pos_, data_.size()))
+            throw CatalogError("truncated catalog data");
+
+        const auto bytes = data_.substr(pos_, size);
+        pos_ += size;
+        return bytes;
+    }
+};
+
+/**
+ * Compress a column.
+ */
+std::string
+compress(std::string_view raw)
+{
+    auto size = compressBound(static_cast<uLong>(raw.size()));
+    std::string compressed(size, '\0');
+
+    // Speed matters more than size, most of the size is in text anyway
+    const int ret = compress2(
+        reinterpret_cast<Bytef*>(compressed.data()),
+        &size,
+        reinterpret_cast<const Bytef*>(raw.data()),
+        static_cast<uLong>(raw.size()),
+        Z_BEST_SPEED
+    );
+    if (ret != Z_OK)
+        throw CatalogError("failed to compress a catalog column");
+
+    compressed.resize(size);
+    return compressed;
+}
+
+/**
+ * A column being encoded.
+ */
+struct EncodedColumn {
+    std::string data; ///< Compressed
+    std::uint32_t raw_size = 0;
+};
+
+/**
+ * A block ready to be written.
+ */
+struct EncodedBlock {
+    std::uint32_t rows = 0;
+    std::uint64_t max_downloads = 0;
+    std::array<EncodedColumn, Catalog::COLUMNS> columns;
+    std::array<std::vector<std::uint64_t>, Catalog::SET_COLUMNS> summaries;
+    std::vector<std::uint64_t> id_filter;
+};
+
+/**
+ * Check that a size fits a 32-bit field.
+ */
+std::uint32_t
+size32(std::size_t size)
+{
+    if (size > std::numeric_limits<std::uint32_t>::max())
+        throw CatalogError("catalog column too large");
+    return static_cast<std::uint32_t>(size);
+}
+
+/**
+ * Encode some projects into a block.
+ */
+EncodedBlock
+encode_block(
+    std::span<const CatalogProject> projects,
+    std::array<Dictionary, Catalog::SET_COLUMNS>& dictionaries
+)
+{
+    EncodedBlock block;
+    block.rows = size32(projects.size());
+    block.id_filter = make_id_filter(projects);
+
+    const auto finish = [&](Column column, const std::string& raw) {
+        auto& encoded = block.columns.at(index(column));
+        encoded.data = compress(raw);
+        encoded.raw_size = size32(raw.size());
+    };
+
+    // Strings are all lengths, then all bytes
+    const auto strings = [&](Column column, StringField field) {
+        std::string raw;
+        ByteWriter out(raw);
+
+        for (const auto& project : projects)
+            out.put(size32((project.*field).size()));
+        for (const auto& project : projects)
+            out.put_bytes(project.*field);
+
+        finish(column, raw);
+    };
+
+    // Sets are all counts, then all dictionary IDs
+    const auto sets = [&](Column column, SetField field) {
+        auto& dictionary = dictionaries.at(set_index(column));
+        auto& summary = block.summaries.at(set_index(column));
+
+        std::string raw;
+        ByteWriter out(raw);
+
+        for (const auto& project : projects) {
+            if ((project.*field).size() > std::numeric_limits<std::uint16_t>::max())
+                throw CatalogError(fmt::format("too many values in {}", project.id));
+            out.put(static_cast<std::uint16_t>((project.*field).size()));
+        }
+
+        for (const auto& project : projects) {
+            for (const auto& value : project.*field) {
+                const auto id = dictionary.intern(value);
+                out.put(id);
+                add_id(summary, id);
+            }
+        }
+
+        finish(column, raw);
+    };
+
+    strings(Column::id, &CatalogProject::id);
+    strings(Column::slug, &CatalogProject::slug);
+    strings(Column::title, &CatalogProject::title);
+    strings(Column::summary, &CatalogProject::summary);
+
+    std::string raw;
+    ByteWriter out(raw);
+
+    for (const auto& project : projects)
+        out.put(static_cast<std::uint8_t>(project.source));
+    finish(Column::source, raw);
+
+    raw.clear();
+    for (const auto& project : projects) {
+        out.put(project.downloads);
+        block.max_downloads = std::max(block.max_downloads, project.downloads);
+    }
+    finish(Column::downloads, raw);
+
+    raw.clear();
+    for (const auto& project : projects)
+        out.put(project.updated);
+    finish(Column::updated, raw);
+
+    sets(Column::loaders, &CatalogProject::loaders);
+    sets(Column::game_versions, &CatalogProject::game_versions);
+    sets(Column::categories, &CatalogProject::categories);
+
+    return block;
+}
+
+/**
+ * Take a block of a snapshot as it is.
+ */
+EncodedBlock
+copy_block(const Catalog& catalog, std::size_t idx)
+{
+    const auto& info = catalog.blocks()[idx];
+
+    EncodedBlock block;
+    block.rows = info.rows;
+    block.max_downloads = info.max_downloads;
+    block.summaries = info.summaries;
+    block.id_filter = info.id_filter;
+
+    for (std::size_t column = 0; column < Catalog::COLUMNS; ++column) {
+        auto& encoded = block.columns.at(column);
+        encoded.data = catalog.compressed(idx, static_cast<Column>(column));
+        encoded.raw_size = info.columns.at(column).raw_size;
+    }
+
+    return block;
+}
+
+/**
+ * Write a snapshot, replacing any file atomically.
+ */
+void
+write_snapshot(
+    const std::filesystem::path& path,
+    const std::vector<EncodedBlock>& blocks,
+    const std::array<Dictionary, Catalog::SET_COLUMNS>& dictionaries,
+    std::size_t block_rows
+)
+{
+    auto temp = path;
+    temp += ".tmp";
+
+    std::ofstream file(temp, std::ofstream::out | std::ofstream::binary);
+    file.write(std::string(HEADER_SIZE, '\0').data(), HEADER_SIZE);
+
+    // Column data, remembering where it went
+    std::uint64_t offset = HEADER_SIZE;
+    std::vector<std::array<std::uint64_t, Catalog::COLUMNS>> offsets(blocks.size());
+
+    for (std::size_t idx = 0; idx < blocks.size(); ++idx) {
+        for (std::size_t column = 0; column < Catalog::COLUMNS; ++column) {
+            const auto& data = blocks[idx].columns.at(column).data;
+
+            offsets[idx].at(column) = offset;
+            file.write(data.data(), static_cast<std::streamsize>(data.size()));
+            offset += data.size();
+        }
+    }
+
+    std::string tail;
+    ByteWriter out(tail);
+
+    const auto dictionaries_offset = offset;
+    for (const auto& dictionary : dictionaries) {
+        out.put(size32(dictionary.values().size()));
+
+        for (const auto& value : dictionary.values()) {
+            if (value.size() > std::numeric_limits<std::uint16_t>::max())
+                throw CatalogError("catalog dictionary value too long");
+
+            out.put(static_cast<std::uint16_t>(value.size()));
+            out.put_bytes(value);
+        }
+    }
+
+    const auto directory_offset = offset + tail.size();
+    std::uint64_t projects = 0;
+
+    for (std::size_t idx = 0; idx < blocks.size(); ++idx) {
+        const auto& block = blocks[idx];
+        projects += block.rows;
+
+        out.put(block.rows);
+        out.put(std::uint32_t{0});
+        out.put(block.max_downloads);
+
+        for (std::size_t column = 0; column < Catalog::COLUMNS; ++column) {
+            out.put(offsets[idx].at(column));
+            out.put(size32(block.columns.at(column).data.size()));
+            out.put(block.columns.at(column).raw_size);
+        }
+
+        // Copied blocks may predate values added since, their bits are 0
+        for (std::size_t set = 0; set < Catalog::SET_COLUMNS; ++set) {
+            const auto values = dictionaries.at(set).values().size();
+            const auto words = (values + 63) / 64; // NOLINT(*-magic-numbers)
+            auto summary = block.summaries.at(set);
+            summary.resize(words);
+
+            out.put(size32(words));
+            for (const auto word : summary)
+                out.put(word);
+        }
+
+        out.put(size32(block.id_filter.size()));
+        for (const auto word : block.id_filter)
+            out.put(word);
+    }
+
+    file.write(tail.data(), static_cast<std::streamsize>(tail.size()));
+
+    std::string header;
+    ByteWriter head(header);
+    head.put_bytes(MAGIC);
+    head.put(size32(block_rows));
+    head.put(std::uint32_t{0});
+    head.put(projects);
+    head.put(dictionaries_offset);
+    head.put(directory_offset);
+    head.put(size32(blocks.size()));
+    head.put(std::uint32_t{0});
+
+    file.seekp(0);
+    file.write(header.data(), static_cast<std::streamsize>(header.size()));
+
+    file.close();
+    if (!file)
+        throw std::system_error(
+            std::make_error_code(std::errc::io_error),
+            "failed to write " + temp.string()
+        );
+
+    std::filesystem::rename(temp, path);
+}
+
+/**
+ * Split a strings column into its values.
+ */
+std::vector<std::string_view>
+decode_strings(std::string_view raw, std::uint32_t rows)
+{
+    ByteReader lengths(raw);
+    ByteReader bytes(raw, std::size_t{rows} * sizeof(std::uint32_t));
+
+    std::vector<std::string_view> values(rows);
+    for (auto& value : values)
+        value = bytes.bytes(lengths.get<std::uint32_t>());
+
+    return values;
+}
+
+/**
+ * Read the values of a fixed size column.
+ */
+template <typename T>
+std::vector<T>
+decode_values(std::string_view raw, std::uint32_t rows)
+{
+    ByteReader reader(raw);
+
+    std::vector<T> values(rows);
+    for (auto& value : values)
+        value = reader.get<T>();
+
+    return values;
+}
+
+/**
+ * Call a function with the dictionary IDs of every row of a set column.
+ */
+template <typename Func>
+void
+for_each_set(std::string_view raw, std::uint32_t rows, Func&& func)
+{
+    ByteReader reader(raw);
+    const auto counts = reader.bytes(std::size_t{rows} * sizeof(std::uint16_t));
+    auto ids = raw.substr(counts.size());
+
+    // Bounds are checked as rows go, queries walk these for every block
+    for (std::uint32_t row = 0; row < rows; ++row) {
+        std::uint16_t count = 0;
+        std::memcpy(&count, counts.data() + row * sizeof(count), sizeof(count));
+
+        const auto size = count * sizeof(std::uint16_t);
+        if (size > ids.size())
+            throw CatalogError("truncated catalog data");
+
+        func(row, ids.substr(0, size));
+        ids.remove_prefix(size);
+    }
+}
+
+/**
+ * Check if the IDs of a row of a set column contain one.
+ */
+bool
+contains_id(std::string_view ids, std::uint16_t id)
+{
+    for (std::size_t pos = 0; pos < ids.size(); pos += sizeof(std::uint16_t)) {
+        std::uint16_t value = 0;
+        std::memcpy(&value, ids.data() + pos, sizeof(value));
+
+        if (value == id)
+            return true;
+    }
+
+    return false;
+}
+
+/**
+ * Lower case an ASCII character, for text search.
+ */
+constexpr char
+lower(char chr)
+{
+    return chr >= 'A' && chr <= 'Z' ? static_cast<char>(chr - 'A' + 'a') : chr;
+}
+
+/**
+ * Lower case a string, for text search.
+ */
+std::string
+lower(std::string_view str)
+{
+    std::string lowered(str);
+    std::transform(lowered.begin(), lowered.end(), lowered.begin(), [](char chr) {
+        return lower(chr);
+    });
+    return lowered;
+}
+
+/**
+ * Check if a string contains a lower cased needle, ignoring ASCII case.
+ */
+bool
+contains_text(std::string_view haystack, std::string_view needle)
+{
+    const auto iter = std::search(
+        haystack.begin(),
+        haystack.end(),
+        needle.begin(),
+        needle.end(),
+        [](char lhs, char rhs) { return lower(lhs) == rhs; }
+    );
+    return iter != haystack.end();
+}
+
+/**
+ * A project matched by a query.
+ */
+struct Match {
+    std::uint64_t downloads;
+    std::uint32_t block;
+    std::uint32_t row;
+};
+
+} // namespace
+
+namespace krompir {
+namespace catalog {
+
+std::string_view
+source_name(ProjectSource source)
+{
+    switch (source) {
+        case ProjectSource::modrinth:
+            return "modrinth";
+        case ProjectSource::curseforge:
+            return "curseforge";
+    }
+
+    return "unknown";
+}
+
+std::uint16_t
+Dictionary::intern(std::string_view value)
+{
+    if (const auto id = find(value))
+        return *id;
+
+    if (values_.size() > std::numeric_limits<std::uint16_t>::max())
+        throw CatalogError("too many different values in a catalog column");
+
+    const auto id = static_cast<std::uint16_t>(values_.size());
+    values_.emplace_back(value);
+    ids_.emplace(values_.back(), id);
+
+    return id;
+}
+
+std::optional<std::uint16_t>
+Dictionary::find(std::string_view value) const
+{
+    const auto iter = ids_.find(value);
+    if (iter == ids_.end())
+        return std::nullopt;
+    return iter->second;
+}
+
+void
+write_catalog(
+    const std::vector<CatalogProject>& projects,
+    const std::filesystem::path& path,
+    std::size_t block_rows
+)
+{
+    const auto start = std::chrono::steady_clock::now();
+
+    std::array<Dictionary, Catalog::SET_COLUMNS> dictionaries;
+    std::vector<EncodedBlock> blocks;
+
+    const std::span all(projects);
+    for (std::size_t first = 0; first < all.size(); first += block_rows) {
+        const auto rows = std::min(block_rows, all.size() - first);
+        blocks.push_back(encode_block(all.subspan(first, rows), dictionaries));
+    }
+
+    write_snapshot(path, blocks, dictionaries, block_rows);
+
+    log_i(
+        catalog,
+        "Wrote {} projects in {} blocks to {} in {}",
+        projects.size(),
+        blocks.size(),
+        path,
+        std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start
+        )
+    );
+}
+
+Catalog::Catalog(const std::filesystem::path& path, std::size_t cache_bytes) :
+    file_(path, utils::MappedFile::Access::random), cache_bytes_(cache_bytes)
+{
+    const auto data = file_.view();
+    if (data.size() < HEADER_SIZE || !data.starts_with(MAGIC))
+        throw CatalogError(fmt::format("{} is not a catalog snapshot", path.string()));
+
+    ByteReader header(data, MAGIC.size());
+    block_rows_ = header.get<std::uint32_t>();
+    header.get<std::uint32_t>();
+    projects_ = header.get<std::uint64_t>();
+
+    ByteReader dictionaries(data, header.get<std::uint64_t>());
+    ByteReader directory(data, header.get<std::uint64_t>());
+    blocks_.resize(header.get<std::uint32_t>());
+
+    for (auto& dictionary : dictionaries_) {
+        const auto count = dictionaries.get<std::uint32_t>();
+
+        for (std::uint32_t idx = 0; idx < count; ++idx)
+            dictionary.intern(dictionaries.bytes(dictionaries.get<std::uint16_t>()));
+    }
+
+    for (auto& block : blocks_) {
+        block.rows = directory.get<std::uint32_t>();
+        directory.get<std::uint32_t>();
+        block.max_downloads = directory.get<std::uint64_t>();
+
+        for (auto& column : block.columns) {
+            column.offset = directory.get<std::uint64_t>();
+            column.size = directory.get<std::uint32_t>();
+            column.raw_size = directory.get<std::uint32_t>();
+
+            if (column.offset > data.size()
+                || column.size > data.size() - column.offset)
+                throw CatalogError("catalog column out of bounds");
+        }
+
+        for (auto& summary : block.summaries) {
+            summary.resize(directory.get<std::uint32_t>());
+            for (auto& word : summary)
+                word = directory.get<std::uint64_t>();
+        }
+
+        block.id_filter.resize(directory.get<std::uint32_t>());
+        for (auto& word : block.id_filter)
+            word = directory.get<std::uint64_t>();
+    }
+}
+
+const Dictionary&
+Catalog::dictionary(Column column) const
+{
+    return dictionaries_.at(set_index(column));
+}
+
+std::string_view
+Catalog::compressed(std::size_t block, Column column) const
+{
+    const auto& ref = blocks_.at(block).columns.at(index(column));
+    return file_.view().substr(ref.offset, ref.size);
+}
+
+std::shared_ptr<const std::string>
+Catalog::inflate(std::size_t block, Column column) const
+{
+    // Only keep what queries filter on, IDs and summaries are rarely needed
+    const bool keep = column != Column::id && column != Column::summary;
+    const auto key = block * COLUMNS + index(column);
+
+    if (keep) {
+        const std::lock_guard lock(mutex_);
+
+        const auto iter = cached_.find(key);
+        if (iter != cached_.end()) {
+            inflated_.splice(inflated_.begin(), inflated_, iter->second);
+            return iter->second->raw;
+        }
+    }
+
+    const auto data = compressed(block, column);
+    const auto& ref = blocks_.at(block).columns.at(index(column));
+    auto size = static_cast<uLongf>(ref.raw_size);
+    std::string raw(size, '\0');
+
+    const int ret = uncompress(
+        reinterpret_cast<Bytef*>(raw.data()),
+        &size,
+        reinterpret_cast<const Bytef*>(data.data()),
+        static_cast<uLong>(data.size())
+    );
+    if (ret != Z_OK || size != raw.size())
+        throw CatalogError(fmt::format("corrupt catalog block {}", block));
+
+    auto inflated = std::make_shared<const std::string>(std::move(raw));
+
+    if (keep && inflated->size() <= cache_bytes_) {
+        const std::lock_guard lock(mutex_);
+
+        // Another thread may have inflated it too
+        if (cached_.contains(key))
+            return inflated;
+
+        inflated_.push_front({key, inflated});
+        cached_.emplace(key, inflated_.begin());
+        cached_bytes_ += inflated->size();
+
+        while (cached_bytes_ > cache_bytes_) {
+            const auto& oldest = inflated_.back();
+            cached_bytes_ -= oldest.raw->size();
+            cached_.erase(oldest.key);
+            inflated_.pop_back();
+        }
+    }
+
+    return inflated;
+}
+
+std::vector<CatalogProject>
+Catalog::decode(std::size_t block, const std::vector<std::uint32_t>& rows) const
+{
+    const auto count = blocks_.at(block).rows;
+
+    std::vector<std::uint32_t> all;
+    if (rows.empty()) {
+        all.resize(count);
+        std::iota(all.begin(), all.end(), 0);
+    }
+    const auto& wanted = rows.empty() ? all : rows;
+
+    std::vector<CatalogProject> projects(wanted.size());
+
+    // Set columns are walked in row order
+    std::vector<std::size_t> order(wanted.size());
+    std::iota(order.begin(), order.end(), 0);
+    if (!std::is_sorted(wanted.begin(), wanted.end())) {
+        std::stable_sort(order.begin(), order.end(), [&](auto lhs, auto rhs) {
+            return wanted[lhs] < wanted[rhs];
+        });
+    }
+
+    const auto strings = [&](Column column, StringField field) {
+        const auto raw = inflate(block, column);
+        const auto values = decode_strings(*raw, count);
+
+        for (std::size_t idx = 0; idx < wanted.size(); ++idx)
+            projects[idx].*field = values.at(wanted[idx]);
+    };
+
+    const auto sets = [&](Column column, SetField field) {
+        const auto raw = inflate(block, column);
+        const auto& dictionary = this->dictionary(column);
+
+        std::size_t next = 0;
+        for_each_set(*raw, count, [&](std::uint32_t row, std::string_view ids) {
+            for (; next < order.size() && wanted[order[next]] == row; ++next) {
+                auto& values = projects[order[next]].*field;
+
+                for (std::size_t pos = 0; pos < ids.size();
+                     pos += sizeof(std::uint16_t)) {
+                    std::uint16_t id = 0;
+                    std::memcpy(&id, ids.data() + pos, sizeof(id));
+                    values.push_back(dictionary[id]);
+                }
+            }
+        });
+    };
+
+    strings(Column::id, &CatalogProject::id);
+    strings(Column::slug, &CatalogProject::slug);
+    strings(Column::title, &CatalogProject::title);
+    strings(Column::summary, &CatalogProject::summary);
+
+    const auto sources =
+        decode_values<std::uint8_t>(*inflate(block, Column::source), count);
+    const auto downloads =
+        decode_values<std::uint64_t>(*inflate(block, Column::downloads), count);
+    const auto updated =
+        decode_values<std::int64_t>(*inflate(block, Column::updated), count);
+
+    for (std::size_t idx = 0; idx < wanted.size(); ++idx) {
+        projects[idx].source = static_cast<ProjectSource>(sources.at(wanted[idx]));
+        projects[idx].downloads = downloads.at(wanted[idx]);
+        projects[idx].updated = updated.at(wanted[idx]);
+    }
+
+    sets(Column::loaders, &CatalogProject::loaders);
+    sets(Column::game_versions, &CatalogProject::game_versions);
+    sets(Column::categories, &CatalogProject::categories);
+
+    return projects;
+}
+
+QueryResult
+Catalog::query(const CatalogQuery& query) const
+{
+    QueryResult result;
+
+    // Values that are not in a dictionary match nothing
+    std::vector<std::pair<Column, std::uint16_t>> set_filters;
+
+    const auto filter = [&](Column column, const std::string& value) {
+        if (value.empty())
+            return true;
+
+        const auto id = dictionary(column).find(value);
+        if (id)
+            set_filters.emplace_back(column, *id);
+        return id.has_value();
+    };
+
+    if (!filter(Column::loaders, query.loader)
+        || !filter(Column::game_versions, query.game_version)
+        || !filter(Column::categories, query.category)) {
+        result.blocks_skipped = blocks_.size();
+        return result;
+    }
+
+    const auto text = lower(query.text);
+    std::vector<Match> matches;
+    std::vector<std::uint32_t> candidates;
+
+    for (std::size_t block = 0; block < blocks_.size(); ++block) {
+        const auto& info = blocks_[block];
+
+        const bool skipped =
+            info.max_downloads < query.min_downloads
+            || std::any_of(set_filters.begin(), set_filters.end(), [&](auto& set) {
+                   const auto& [column, id] = set;
+                   return !has_id(info.summaries.at(set_index(column)), id);
+               });
+
+        if (skipped) {
+            ++result.blocks_skipped;
+            continue;
+        }
+
+        candidates.resize(info.rows);
+        std::iota(candidates.begin(), candidates.end(), 0);
+
+        const auto keep = [&](auto&& pred) {
+            candidates.erase(
+                std::remove_if(
+                    candidates.begin(),
+                    candidates.end(),
+                    [&](std::uint32_t row) { return !pred(row); }
+                ),
+                candidates.end()
+            );
+        };
+
+        const auto downloads_raw = inflate(block, Column::downloads);
+        const auto downloads = decode_values<std::uint64_t>(*downloads_raw, info.rows);
+
+        if (query.min_downloads > 0)
+            keep([&](auto row) { return downloads[row] >= query.min_downloads; });
+
+        if (query.source && !candidates.empty()) {
+            const auto sources_raw = inflate(block, Column::source);
+            const auto sources = decode_values<std::uint8_t>(*sources_raw, info.rows);
+            const auto wanted = static_cast<std::uint8_t>(*query.source);
+            keep([&](std::uint32_t row) { return sources[row] == wanted; });
+        }
+
+        for (const auto& [column, id] : set_filters) {
+            if (candidates.empty())
+                break;
+
+            std::vector<bool> found(info.rows);
+            for_each_set(*inflate(block, column), info.rows, [&](auto row, auto ids) {
+                found[row] = contains_id(ids, id);
+            });
+
+            keep([&](std::uint32_t row) { return found[row]; });
+        }
+
+        if (!text.empty() && !candidates.empty()) {
+            const auto slugs_raw = inflate(block, Column::slug);
+            const auto titles_raw = inflate(block, Column::title);
+            const auto slugs = decode_strings(*slugs_raw, info.rows);
+            const auto titles = decode_strings(*titles_raw, info.rows);
+
+            keep([&](std::uint32_t row) {
+                return contains_text(slugs[row], text)
+                       || contains_text(titles[row], text);
+            });
+        }
+
+        for (const auto row : candidates) {
+            matches.push_back(
+                {downloads[row], static_cast<std::uint32_t>(block), row}
+            );
+        }
+    }
+
+    result.matches = matches.size();
+
+    // Only the returned projects are decoded, block by block
+    const auto limit = std::min(query.limit, matches.size());
+    std::partial_sort(
+        matches.begin(),
+        matches.begin() + static_cast<std::ptrdiff_t>(limit),
+        matches.end(),
+        [](const Match& lhs, const Match& rhs) {
+            return std::tie(rhs.downloads, lhs.block, lhs.row)
+                   < std::tie(lhs.downloads, rhs.block, rhs.row);
+        }
+    );
+    matches.resize(limit);
+
+    std::vector<std::size_t> order(limit);
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](std::size_t lhs, std::size_t rhs) {
+        return std::tie(matches[lhs].block, matches[lhs].row)
+               < std::tie(matches[rhs].block, matches[rhs].row);
+    });
+
+    result.projects.resize(limit);
+
+    for (std::size_t first = 0; first < limit;) {
+        const auto block = matches[order[first]].block;
+
+        auto last = first;
+        std::vector<std::uint32_t> rows;
+        while (last < limit && matches[order[last]].block == block)
+            rows.push_back(matches[order[last++]].row);
+
+        auto projects = decode(block, rows);
+        for (std::size_t idx = first; idx < last; ++idx)
+            result.projects[order[idx]] = std::move(projects[idx - first]);
+
+        first = last;
+    }
+
+    return result;
+}
+
+RefreshStats
+refresh_catalog(
+    const Catalog& from, const CatalogDump& delta, const std::filesystem::path& path
+)
+{
+    const auto start = std::chrono::steady_clock::now();
+
+    RefreshStats stats;
+
+    std::array<Dictionary, Catalog::SET_COLUMNS> dictionaries{
+        from.dictionary(Column::loaders),
+        from.dictionary(Column::game_versions),
+        from.dictionary(Column::categories),
+    };
+
+    // Later changes to the same project win
+    std::unordered_map<std::string_view, const CatalogProject*> changed;
+    for (const auto& project : delta.projects)
+        changed.insert_or_assign(project.id, &project);
+
+    const std::unordered_set<std::string_view> deleted(
+        delta.deleted.begin(), delta.deleted.end()
+    );
+
+    std::vector<std::string_view> delta_ids;
+    delta_ids.reserve(changed.size() + deleted.size());
+    for (const auto& [id, project] : changed)
+        delta_ids.push_back(id);
+    delta_ids.insert(delta_ids.end(), deleted.begin(), deleted.end());
+
+    std::vector<EncodedBlock> blocks;
+    std::unordered_set<std::string_view> applied;
+
+    // The projects of the last block, if it was rewritten
+    std::vector<CatalogProject> last_rows;
+    std::optional<std::size_t> last_copied;
+
+    for (std::size_t idx = 0; idx < from.blocks().size(); ++idx) {
+        const auto& info = from.blocks()[idx];
+
+        // Only blocks that may hold a changed project have their IDs inflated
+        bool touched = std::any_of(delta_ids.begin(), delta_ids.end(), [&](auto id) {
+            return may_contain(info.id_filter, id);
+        });
+
+        if (touched) {
+            ++stats.blocks_checked;
+
+            const auto ids_raw = from.inflate(idx, Column::id);
+            const auto ids = decode_strings(*ids_raw, info.rows);
+
+            touched = std::any_of(ids.begin(), ids.end(), [&](auto id) {
+                return changed.contains(id) || deleted.contains(id);
+            });
+        }
+
+        if (!touched) {
+            blocks.push_back(copy_block(from, idx));
+            last_copied = idx;
+            ++stats.blocks_copied;
+            continue;
+        }
+
+        std::vector<CatalogProject> rows;
+        for (auto& project : from.decode(idx)) {
+            if (deleted.contains(project.id)) {
+                ++stats.removed;
+                continue;
+            }
+
+            const auto iter = changed.find(project.id);
+            if (iter != changed.end()) {
+                applied.insert(iter->first);
+                rows.push_back(*iter->second);
+                ++stats.updated;
+                continue;
+            }
+
+            rows.push_back(std::move(project));
+        }
+
+        if (rows.empty())
+            continue;
+
+        blocks.push_back(encode_block(rows, dictionaries));
+        last_rows = std::move(rows);
+        last_copied.reset();
+        ++stats.blocks_rewritten;
+    }
+
+    // New projects fill up the last block, then go into new ones
+    std::vector<CatalogProject> added;
+    for (const auto& project : delta.projects) {
+        const auto iter = changed.find(project.id);
+        if (iter->second == &project && !applied.contains(project.id)
+            && !deleted.contains(project.id))
+            added.push_back(project);
+    }
+    stats.added = added.size();
+
+    if (!added.empty() && !blocks.empty() && blocks.back().rows < from.block_rows()) {
+        if (last_copied) {
+            last_rows = from.decode(*last_copied);
+            --stats.blocks_copied;
+        }
+        else {
+            --stats.blocks_rewritten;
+        }
+
+        blocks.pop_back();
+        added.insert(
+            added.begin(),
+            std::make_move_iterator(last_rows.begin()),
+            std::make_move_iterator(last_rows.end())
+        );
+    }
+
+    const std::span all(added);
+    for (std::size_t first = 0; first < all.size(); first += from.block_rows()) {
+        const auto rows = std::min(from.block_rows(), all.size() - first);
+
+        blocks.push_back(encode_block(all.subspan(first, rows), dictionaries));
+        ++stats.blocks_rewritten;
+    }
+
+    write_snapshot(path, blocks, dictionaries, from.block_rows());
+
+    log_i(
+        catalog,
+        "Refreshed {}: {} added, {} updated, {} removed, {} of {} blocks rewritten "
+        "in {}",
+        path,
+        stats.added,
+        stats.updated,
+        stats.removed,
+        stats.blocks_rewritten,
+        blocks.size(),
+        std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start
+        )
+    );
+
+    return stats;
+}
+
+} // namespace catalog
+} // namespace krompir
@@ -0,0 +1,367 @@
+/**
+ * @file catalog.hpp
+ * @brief An offline snapshot of the Modrinth and CurseForge project catalogs.
+ * @copyright MIT
+ *
+ * A snapshot is built from a dump of the catalog, and stores projects in
+ * blocks of rows. Each column of a block is compressed on its own, so queries
+ * only inflate the columns they filter on. Loaders, game versions and
+ * categories are dictionary encoded, and every block records which of them it
+ * contains, so most blocks are skipped without being read at all.
+ *
+ * Dumps are JSON lines, one project per line:
+ *
+ * @code
+ * {"id": "AANobbMI", "slug": "sodium", "title": "Sodium", "summary": "...",
+ *  "source": "modrinth", "downloads": 51000000, "updated": 1700000000,
+ *  "loaders": ["fabric", "quilt"], "game_versions": ["1.20.1"],
+ *  "categories": ["optimization"]}
+ * @endcode
+ *
+ * A delta is a dump of changed projects, where `{"id": "...", "deleted": true}`
+ * removes one.
+ */
+#pragma once
+
+#include "utils/mapped_file.hpp"
+#include "utils/strings.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace krompir {
+namespace catalog {
+
+/**
+ * Where a project is published.
+ */
+enum class ProjectSource : std::uint8_t { modrinth, curseforge };
+
+/**
+ * Get the name of a source, as written in dumps.
+ */
+std::string_view source_name(ProjectSource source);
+
+/**
+ * A project of the catalog.
+ */
+struct CatalogProject {
+    std::string id;
+    std::string slug;
+    std::string title;
+    std::string summary;
+    ProjectSource source = ProjectSource::modrinth;
+    std::uint64_t downloads = 0;
+    std::int64_t updated = 0; ///< Unix time, in seconds
+    std::vector<std::string> loaders;
+    std::vector<std::string> game_versions;
+    std::vector<std::string> categories;
+};
+
+/**
+ * Thrown when a dump or snapshot is malformed.
+ */
+class CatalogError : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
+
+/**
+ * A dump of the catalog, or of the changes to it.
+ */
+struct CatalogDump {
+    std::vector<CatalogProject> projects;
+    std::vector<std::string> deleted; ///< IDs, only in deltas
+};
+
+/**
+ * Read a dump.
+ *
+ * @throws std::system_error if the file can not be read.
+ * @throws CatalogError if a line is malformed.
+ */
+CatalogDump read_dump(const std::filesystem::path& path);
+
+/**
+ * Rows per block of a snapshot.
+ */
+constexpr std::size_t DEFAULT_BLOCK_ROWS = 1024;
+
+/**
+ * Write a snapshot.
+ *
+ * The snapshot is replaced atomically.
+ *
+ * @throws std::system_error if the file can not be written.
+ * @throws CatalogError if there are too many different loaders, game
+ *         versions or categories.
+ */
+void write_catalog(
+    const std::vector<CatalogProject>& projects,
+    const std::filesystem::path& path,
+    std::size_t block_rows = DEFAULT_BLOCK_ROWS
+);
+
+/**
+ * Find projects in a snapshot.
+ */
+struct CatalogQuery {
+    std::string loader;       ///< Empty for any
+    std::string game_version; ///< Empty for any
+    std::string category;     ///< Empty for any
+    std::string text;         ///< In the slug or title, ignoring case
+    std::optional<ProjectSource> source;
+    std::uint64_t min_downloads = 0;
+    std::size_t limit = 50; ///< Most downloaded first
+};
+
+/**
+ * The projects found by a query.
+ */
+struct QueryResult {
+    std::vector<CatalogProject> projects; ///< At most `CatalogQuery::limit`
+    std::size_t matches = 0;              ///< All projects that matched
+    std::size_t blocks_skipped = 0;       ///< Blocks not inflated at all
+};
+
+/**
+ * A values dictionary, for one column of a snapshot.
+ */
+class Dictionary {
+    std::vector<std::string> values_;
+    std::unordered_map<std::string, std::uint16_t, utils::StringHash, std::equal_to<>>
+        ids_;
+
+public:
+    /**
+     * Get the ID of a value, adding it if needed.
+     *
+     * @throws CatalogError if the dictionary is full.
+     */
+    std::uint16_t intern(std::string_view value);
+
+    /**
+     * Get the ID of a value, if it is in the dictionary.
+     */
+    [[nodiscard]] std::optional<std::uint16_t> find(std::string_view value) const;
+
+    [[nodiscard]] const std::string&
+    operator[](std::uint16_t id) const
+    {
+        return values_.at(id);
+    }
+
+    [[nodiscard]] const std::vector<std::string>&
+    values() const noexcept
+    {
+        return values_;
+    }
+};
+
+/**
+ * A memory mapped snapshot.
+ *
+ * Inflated filter columns are kept up to a budget, least recently used first
+ * out, so repeated queries do not inflate them again. Safe to query from many
+ * threads.
+ */
+class Catalog {
+public:
+    /**
+     * The columns of a block.
+     */
+    enum class Column : std::uint8_t {
+        id,
+        slug,
+        title,
+        summary,
+        source,
+        downloads,
+        updated,
+        loaders,
+        game_versions,
+        categories,
+    };
+
+    /// The number of columns
+    static constexpr std::size_t COLUMNS = 10;
+
+    /// The number of dictionary encoded columns, starting at `Column::loaders`
+    static constexpr std::size_t SET_COLUMNS = 3;
+
+    /// Bytes of inflated columns kept by default
+    static constexpr std::size_t CACHE_BYTES = std::size_t{64} << 20U;
+
+    /**
+     * Where a compressed column is in the snapshot.
+     */
+    struct ColumnRef {
+        std::uint64_t offset;
+        std::uint32_t size;
+        std::uint32_t raw_size;
+    };
+
+    /**
+     * What is known about a block without inflating it.
+     */
+    struct BlockInfo {
+        std::uint32_t rows;
+        std::uint64_t max_downloads;
+        std::array<ColumnRef, COLUMNS> columns;
+
+        /// Bitsets of the dictionary IDs used in the block
+        std::array<std::vector<std::uint64_t>, SET_COLUMNS> summaries;
+
+        /// Bloom filter of the project IDs in the block
+        std::vector<std::uint64_t> id_filter;
+    };
+
+private:
+    utils::MappedFile file_;
+    std::uint64_t projects_ = 0;
+    std::size_t block_rows_ = 0;
+    std::array<Dictionary, SET_COLUMNS> dictionaries_;
+    std::vector<BlockInfo> blocks_;
+
+    /**
+     * An inflated column kept for later queries.
+     */
+    struct Inflated {
+        std::size_t key; ///< `block * COLUMNS + column`
+        std::shared_ptr<const std::string> raw;
+    };
+
+    std::size_t cache_bytes_;
+
+    mutable std::mutex mutex_;
+    mutable std::list<Inflated> inflated_; ///< Most recently used first
+    mutable std::unordered_map<std::size_t, std::list<Inflated>::iterator> cached_;
+    mutable std::size_t cached_bytes_ = 0;
+
+public:
+    /**
+     * Open a snapshot.
+     *
+     * @param path The snapshot.
+     * @param cache_bytes How many bytes of inflated columns to keep.
+     *
+     * @throws std::system_error if the file can not be mapped.
+     * @throws CatalogError if the file is not a snapshot.
+     */
+    explicit Catalog(
+        const std::filesystem::path& path, std::size_t cache_bytes = CACHE_BYTES
+    );
+
+    /**
+     * Get the number of projects.
+     */
+    [[nodiscard]] std::uint64_t
+    size() const noexcept
+    {
+        return projects_;
+    }
+
+    [[nodiscard]] std::size_t
+    block_rows() const noexcept
+    {
+        return block_rows_;
+    }
+
+    /**
+     * Get the number of bytes of inflated columns kept.
+     */
+    [[nodiscard]] std::size_t
+    cached_bytes() const
+    {
+        const std::lock_guard lock(mutex_);
+        return cached_bytes_;
+    }
+
+    [[nodiscard]] const std::vector<BlockInfo>&
+    blocks() const noexcept
+    {
+        return blocks_;
+    }
+
+    /**
+     * Get the dictionary of a set column.
+     */
+    [[nodiscard]] const Dictionary& dictionary(Column column) const;
+
+    /**
+     * Get the compressed bytes of a column.
+     */
+    [[nodiscard]] std::string_view compressed(std::size_t block, Column column) const;
+
+    /**
+     * Get the inflated bytes of a column.
+     *
+     * @throws CatalogError if the column is corrupt.
+     */
+    [[nodiscard]] std::shared_ptr<const std::string>
+    inflate(std::size_t block, Column column) const;
+
+    /**
+     * Decode some rows of a block, or all of them if `rows` is empty.
+     *
+     * Rows may be in any order, and projects are returned in the same order.
+     *
+     * @throws CatalogError if the block is corrupt.
+     */
+    [[nodiscard]] std::vector<CatalogProject>
+    decode(std::size_t block, const std::vector<std::uint32_t>& rows = {}) const;
+
+    /**
+     * Find projects.
+     *
+     * @throws CatalogError if the snapshot is corrupt.
+     */
+    [[nodiscard]] QueryResult query(const CatalogQuery& query) const;
+};
+
+/**
+ * What refreshing a snapshot did.
+ */
+struct RefreshStats {
+    std::size_t added = 0;
+    std::size_t updated = 0;
+    std::size_t removed = 0;
+    std::size_t blocks_checked = 0;   ///< IDs inflated, as their filter matched
+    std::size_t blocks_copied = 0;    ///< Written without decoding them
+    std::size_t blocks_rewritten = 0; ///< Changed, or new
+};
+
+/**
+ * Apply a delta to a snapshot, and write the result.
+ *
+ * Blocks without changed projects are copied as they are, dictionaries only
+ * grow. The ID filter of each block rules out most blocks without inflating
+ * anything, so apart from copying, the cost depends on the size of the delta
+ * and not the catalog.
+ *
+ * @param from The snapshot to refresh.
+ * @param delta The changes.
+ * @param path Where to write the refreshed snapshot. It may be that of `from`,
+ *             except on Windows where `from` keeps its file open.
+ *
+ * @throws std::system_error if the file can not be written.
+ * @throws CatalogError if the snapshot is corrupt.
+ */
+RefreshStats refresh_catalog(
+    const Catalog& from, const CatalogDump& delta, const std::filesystem::path& path
+);
+
+} // namespace catalog
+} // namespace krompir
@@ -0,0 +1,138 @@
+#include "catalog.hpp"
+
+#include "configs/document.hpp"
+#include "utils/mapped_file.hpp"
+#include "utils/strings.hpp"
+
+#include <fmt/core.h>
+
+#include <charconv>
+#include <string>
+#include <string_view>
+
+namespace {
+
+using krompir::catalog::CatalogError;
+using krompir::catalog::CatalogProject;
+using krompir::catalog::ProjectSource;
+using krompir::configs::ConfigDocument;
+using krompir::configs::ConfigFormat;
+
+/**
+ * Get a string value of a project, or nothing if it is not set.
+ */
+std::string
+get_string(const ConfigDocument& document, std::string_view key)
+{
+    const auto* entry = document.find(key);
+    return entry == nullptr ? std::string() : document.string(*entry);
+}
+
+/**
+ * Get a number value of a project, or 0 if it is not set.
+ */
+template <typename T>
+T
+get_number(const ConfigDocument& document, std::string_view key)
+{
+    const auto* entry = document.find(key);
+    if (entry == nullptr)
+        return 0;
+
+    const auto value = document.value(*entry);
+    T number = 0;
+
+    const auto [end, err] =
+        std::from_chars(value.data(), value.data() + value.size(), number);
+    if (err != std::errc() || end != value.data() + value.size())
+        throw CatalogError(fmt::format("{} is not a number", key));
+
+    return number;
+}
+
+/**
+ * Get the values of an array of strings.
+ */
+std::vector<std::string>
+get_strings(const ConfigDocument& document, std::string_view key)
+{
+    std::vector<std::string> values;
+
+    while (const auto* entry =
+               document.find(fmt::format("{}[{}]", key, values.size()))) {
+        values.push_back(document.string(*entry));
+    }
+
+    return values;
+}
+
+/**
+ * Read the project of a line.
+ */
+CatalogProject
+parse_project(const ConfigDocument& document)
+{
+    CatalogProject project;
+    project.id = get_string(document, "id");
+    project.slug = get_string(document, "slug");
+    project.title = get_string(document, "title");
+    project.summary = get_string(document, "summary");
+
+    if (project.id.empty())
+        throw CatalogError("missing id");
+
+    const auto source = get_string(document, "source");
+    if (source == "curseforge")
+        project.source = ProjectSource::curseforge;
+    else if (!source.empty() && source != "modrinth")
+        throw CatalogError(fmt::format("unknown source {}", source));
+
+    project.downloads = get_number<std::uint64_t>(document, "downloads");
+    project.updated = get_number<std::int64_t>(document, "updated");
+    project.loaders = get_strings(document, "loaders");
+    project.game_versions = get_strings(document, "game_versions");
+    project.categories = get_strings(document, "categories");
+
+    return project;
+}
+
+} // namespace
+
+namespace krompir {
+namespace catalog {
+
+CatalogDump
+read_dump(const std::filesystem::path& path)
+{
+    const utils::MappedFile file(path);
+
+    CatalogDump dump;
+    std::size_t line_number = 0;
+
+    utils::for_each_line(file.view(), [&](std::string_view line) {
+        ++line_number;
+        if (utils::trim(line).empty())
+            return;
+
+        try {
+            const ConfigDocument document(ConfigFormat::json, std::string(line));
+
+            const auto* deleted = document.find("deleted");
+            if (deleted != nullptr && document.value(*deleted) == "true") {
+                dump.deleted.push_back(get_string(document, "id"));
+                return;
+            }
+
+            dump.projects.push_back(parse_project(document));
+        } catch (const std::runtime_error& err) {
+            throw CatalogError(
+                fmt::format("{}:{}: {}", path.string(), line_number, err.what())
+            );
+        }
+    });
+
+    return dump;
+}
+
+} // namespace catalog
+} // namespace krompir
@@ -0,0 +1,424 @@
+#include "bulk_edit.hpp"
+
+#include "logging.hpp"
+#include "metrics/metrics.hpp"
+
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <system_error>
+#include <thread>
+#include <utility>
+
+namespace {
+
+using krompir::configs::ConfigFormat;
+
+/**
+ * A config file, and the edits that apply to it.
+ */
+struct ConfigFile {
+    std::filesystem::path path;
+    std::vector<std::size_t> edits;
+};
+
+/**
+ * Read a whole file.
+ *
+ * @throws std::system_error if the file can not be read.
+ */
+std::string
+read_file(const std::filesystem::path& path)
+{
+    std::ifstream file(path, std::ifstream::in | std::ifstream::binary);
+    if (!file)
+        throw std::system_error(
+            std::make_error_code(std::errc::io_error), "failed to open " + path.string()
+        );
+
+    std::ostringstream text;
+    text << file.rdbuf();
+    return std::move(text).str();
+}
+
+/**
+ * Find the config files of some packs that are matched by a profile.
+ */
+std::vector<ConfigFile>
+find_files(
+    const std::vector<std::filesystem::path>& packs,
+    const krompir::configs::EditProfile& profile,
+    std::size_t& total
+)
+{
+    std::vector<ConfigFile> files;
+
+    for (const auto& pack : packs) {
+        const auto dir = krompir::configs::config_dir(pack);
+
+        for (const auto& entry : std::filesystem::recursive_directory_iterator(dir)) {
+            const auto format = krompir::configs::detect_format(entry.path());
+            if (!entry.is_regular_file() || format == ConfigFormat::unknown)
+                continue;
+
+            ++total;
+
+            const auto relative = entry.path().lexically_relative(dir).generic_string();
+            ConfigFile file{entry.path(), {}};
+
+            for (std::size_t idx = 0; idx < profile.edits.size(); ++idx) {
+                if (krompir::utils::glob_match(profile.edits[idx].files, relative))
+                    file.edits.push_back(idx);
+            }
+
+            if (!file.edits.empty())
+                files.push_back(std::move(file));
+        }
+    }
+
+    return files;
+}
+
+} // namespace
+
+namespace krompir {
+namespace configs {
+
+EditProfile
+EditProfile::parse(std::string_view text)
+{
+    EditProfile profile;
+    std::size_t line_number = 0;
+
+    utils::for_each_line(text, [&](std::string_view line) {
+        ++line_number;
+
+        line = utils::trim(line);
+        if (line.empty() || line.front() == '#')
+            return;
+
+        const auto files = line.substr(0, line.find_first_of(" \t"));
+        const auto rest = line.substr(files.size());
+
+        const auto equals = rest.find('=');
+        const auto key = utils::trim(rest.substr(0, equals));
+
+        if (equals == std::string_view::npos || key.empty())
+            throw ConfigError(
+                fmt::format("line {}: expected '<files> <key> = <value>'", line_number)
+            );
+
+        profile.edits.push_back(
+            {std::string(files),
+             std::string(key),
+             std::string(utils::trim(rest.substr(equals + 1)))}
+        );
+    });
+
+    return profile;
+}
+
+EditProfile
+EditProfile::load(const std::filesystem::path& path)
+{
+    return parse(read_file(path));
+}
+
+std::shared_ptr<const ConfigDocument>
+ConfigCache::document_(ConfigFormat format, std::string text, CacheStats& stats)
+{
+    const auto hash = utils::fnv1a(text) ^ static_cast<std::uint64_t>(format);
+    const auto same = [&](const std::shared_ptr<const ConfigDocument>& document) {
+        return document && document->format() == format && document->text() == text;
+    };
+
+    std::promise<std::shared_ptr<const ConfigDocument>> promise;
+    std::shared_future<std::shared_ptr<const ConfigDocument>> parsing;
+
+    {
+        const std::lock_guard lock(mutex_);
+
+        const auto iter = contents_.find(hash);
+        if (iter != contents_.end()) {
+            auto document = iter->second.lock();
+
+            if (same(document)) {
+                ++stats.shared;
+                return document;
+            }
+        }
+
+        auto [pending, inserted] =
+            parsing_.try_emplace(hash, promise.get_future().share());
+        if (!inserted)
+            parsing = pending->second;
+    }
+
+    if (parsing.valid()) {
+        // Wait for the other thread, unless its text only has the same hash
+        std::shared_ptr<const ConfigDocument> document;
+        try {
+            document = parsing.get();
+        } catch (const ConfigError&) {
+            // Parsed again below, to throw the error for this file
+        }
+
+        if (same(document)) {
+            ++stats.shared;
+            return document;
+        }
+
+        auto own = std::make_shared<const ConfigDocument>(format, std::move(text));
+        ++stats.parsed;
+        return own;
+    }
+
+    try {
+        auto document = std::make_shared<const ConfigDocument>(format, std::move(text));
+        ++stats.parsed;
+
+        {
+            const std::lock_guard lock(mutex_);
+            contents_.insert_or_assign(hash, document);
+            parsing_.erase(hash);
+        }
+
+        promise.set_value(document);
+        return document;
+    } catch (...) {
+        {
+            const std::lock_guard lock(mutex_);
+            parsing_.erase(hash);
+        }
+
+        promise.set_exception(std::current_exception());
+        throw;
+    }
+}
+
+std::shared_ptr<const ConfigDocument>
+ConfigCache::load(const std::filesystem::path& path, CacheStats& stats)
+{
+    const auto time = std::filesystem::last_write_time(path);
+    const auto size = std::filesystem::file_size(path);
+    const auto key = path.string();
+
+    {
+        const std::lock_guard lock(mutex_);
+
+        const auto iter = files_.find(key);
+        if (iter != files_.end() && iter->second.time == time
+            && iter->second.size == size) {
+            ++stats.unchanged;
+            return iter->second.document;
+        }
+    }
+
+    auto document = document_(detect_format(path), read_file(path), stats);
+
+    const std::lock_guard lock(mutex_);
+    files_.insert_or_assign(key, CachedFile{time, size, document});
+
+    return document;
+}
+
+void
+ConfigCache::write(
+    const std::filesystem::path& path, std::shared_ptr<const ConfigDocument> document
+)
+{
+    // Write next to the file and rename, so a crash never leaves half a config
+    auto temp = path;
+    temp += ".krompir-tmp";
+
+    {
+        std::ofstream file(temp, std::ofstream::out | std::ofstream::binary);
+        const auto& text = document->text();
+        file.write(text.data(), static_cast<std::streamsize>(text.size()));
+
+        file.close();
+        if (!file)
+            throw std::system_error(
+                std::make_error_code(std::errc::io_error),
+                "failed to write " + temp.string()
+            );
+    }
+
+    std::filesystem::rename(temp, path);
+
+    const auto time = std::filesystem::last_write_time(path);
+    const auto size = std::filesystem::file_size(path);
+    const auto hash = utils::fnv1a(document->text())
+                      ^ static_cast<std::uint64_t>(document->format());
+
+    const std::lock_guard lock(mutex_);
+    contents_.insert_or_assign(hash, document);
+    files_.insert_or_assign(path.string(), CachedFile{time, size, std::move(document)});
+}
+
+std::size_t
+ConfigCache::size() const
+{
+    const std::lock_guard lock(mutex_);
+    return files_.size();
+}
+
+void
+ConfigCache::clear()
+{
+    const std::lock_guard lock(mutex_);
+    files_.clear();
+    contents_.clear();
+}
+
+std::filesystem::path
+config_dir(const std::filesystem::path& pack)
+{
+    auto dir = pack / "config";
+    return std::filesystem::is_directory(dir) ? dir : pack;
+}
+
+EditReport
+apply_profile(
+    const std::vector<std::filesystem::path>& packs,
+    const EditProfile& profile,
+    ConfigCache& cache,
+    const EditOptions& options
+)
+{
+    static auto& files_written = metrics::counter(
+        "krompir_configs_files_written_total", "Config files changed by profiles"
+    );
+
+    const auto start = std::chrono::steady_clock::now();
+
+    EditReport report;
+    const auto files = find_files(packs, profile, report.files);
+    report.files_matched = files.size();
+
+    auto threads = options.threads;
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = static_cast<unsigned>(std::min<std::size_t>(threads, files.size()));
+
+    std::vector<std::atomic<bool>> used(profile.edits.size());
+    std::atomic<std::size_t> next{0};
+    std::mutex mutex;
+
+    auto work = [&] {
+        EditReport partial;
+
+        for (auto idx = next++; idx < files.size(); idx = next++) {
+            const auto& file = files[idx];
+
+            try {
+                const auto document = cache.load(file.path, partial.cache);
+
+                // Go backwards, so that later edits of the same value win
+                std::vector<std::pair<const ConfigEntry*, std::string>> changes;
+
+                for (auto edit = file.edits.rbegin(); edit != file.edits.rend();
+                     ++edit) {
+                    const auto& [glob, key, value] = profile.edits[*edit];
+
+                    const auto* entry = document->find(key);
+                    if (entry == nullptr)
+                        continue;
+
+                    used[*edit].store(true, std::memory_order_relaxed);
+
+                    const bool seen = std::any_of(
+                        changes.begin(),
+                        changes.end(),
+                        [&](const auto& change) { return change.first == entry; }
+                    );
+
+                    auto formatted = document->format_value(*entry, value);
+                    if (seen || formatted == document->value(*entry))
+                        continue;
+
+                    changes.emplace_back(entry, std::move(formatted));
+                }
+
+                if (changes.empty())
+                    continue;
+
+                std::size_t spliced = 0;
+                auto text = document->with_values(std::move(changes), &spliced);
+
+                ++partial.files_changed;
+                partial.values_changed += spliced;
+
+                // Parsing the result again makes sure the edits left it valid
+                auto updated = std::make_shared<const ConfigDocument>(
+                    document->format(), std::move(text)
+                );
+
+                if (!options.dry_run) {
+                    cache.write(file.path, std::move(updated));
+                    files_written.add();
+                }
+            } catch (const std::system_error& err) {
+                partial.failures.push_back({file.path, err.what()});
+            } catch (const ConfigError& err) {
+                partial.failures.push_back({file.path, err.what()});
+            }
+        }
+
+        const std::lock_guard lock(mutex);
+
+        report.files_changed += partial.files_changed;
+        report.values_changed += partial.values_changed;
+        report.cache.unchanged += partial.cache.unchanged;
+        report.cache.shared += partial.cache.shared;
+        report.cache.parsed += partial.cache.parsed;
+
+        std::move(
+            partial.failures.begin(),
+            partial.failures.end(),
+            std::back_inserter(report.failures)
+        );
+    };
+
+    {
+        std::vector<std::jthread> workers;
+        workers.reserve(threads);
+
+        for (unsigned idx = 1; idx < threads; ++idx)
+            workers.emplace_back(work);
+
+        work();
+    }
+
+    std::sort(report.failures.begin(), report.failures.end(), [](auto& lhs, auto& rhs) {
+        return lhs.file < rhs.file;
+    });
+
+    for (std::size_t idx = 0; idx < used.size(); ++idx) {
+        if (!used[idx].load(std::memory_order_relaxed))
+            report.unused_edits.push_back(idx);
+    }
+
+    log_i(
+        configs,
+        "Applied {} edits to {} of {} config files in {}, {} changed, {} parsed",
+        profile.edits.size(),
+        report.files_matched,
+        report.files,
+        std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start
+        ),
+        report.files_changed,
+        report.cache.parsed
+    );
+
+    return report;
+}
+
+} // namespace configs
+} // namespace krompir
@@ -0,0 +1,193 @@
+/**
+ * @file bulk_edit.hpp
+ * @brief Apply the same config changes across the config files of many packs.
+ * @copyright MIT
+ *
+ * A profile is a list of edits, one per line:
+ *
+ * @code
+ * # <files, relative to config/>  <key> = <value>
+ * jei/jei-client.toml            advanced.cheatItemsEnabled = false
+ * **.cfg                         general.enableUpdateChecker = false
+ * @endcode
+ *
+ * Only files matching an edit are parsed, parsing is spread over threads, and
+ * parsed files are cached by content so that re-applying a profile mostly
+ * costs a `stat` per file. Files are only written if a value changed.
+ */
+#pragma once
+
+#include "configs/document.hpp"
+#include "utils/strings.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace krompir {
+namespace configs {
+
+/**
+ * Set a value in every matching config file.
+ */
+struct ConfigEdit {
+    std::string files; ///< Glob, relative to the config directory
+    std::string key;   ///< Dotted key, as in `ConfigEntry::key`
+    std::string value; ///< Quoted for strings as needed, otherwise written as-is
+};
+
+/**
+ * A list of edits, applied in order, so later edits win.
+ */
+struct EditProfile {
+    std::vector<ConfigEdit> edits;
+
+    /**
+     * Parse a profile.
+     *
+     * @throws ConfigError if a line is malformed.
+     */
+    static EditProfile parse(std::string_view text);
+
+    /**
+     * Load a profile from a file.
+     *
+     * @throws std::system_error if the file can not be read.
+     * @throws ConfigError if a line is malformed.
+     */
+    static EditProfile load(const std::filesystem::path& path);
+};
+
+/**
+ * How much work the cache saved.
+ */
+struct CacheStats {
+    std::size_t unchanged = 0; ///< Files reused without reading them
+    std::size_t shared = 0;    ///< Files read, but with a known content hash
+    std::size_t parsed = 0;    ///< Files read and parsed
+};
+
+/**
+ * Parsed config files, by path and by content hash.
+ *
+ * Files whose size and modification time did not change are not read again,
+ * and identical files (common between packs) are only parsed once, even when
+ * they are loaded at the same time. Safe to use from many threads.
+ */
+class ConfigCache {
+    struct CachedFile {
+        std::filesystem::file_time_type time;
+        std::uintmax_t size;
+        std::shared_ptr<const ConfigDocument> document;
+    };
+
+    mutable std::mutex mutex_;
+    std::unordered_map<std::string, CachedFile, utils::StringHash, std::equal_to<>>
+        files_;
+    std::unordered_map<std::uint64_t, std::weak_ptr<const ConfigDocument>> contents_;
+    std::unordered_map<
+        std::uint64_t,
+        std::shared_future<std::shared_ptr<const ConfigDocument>>>
+        parsing_; ///< Contents being parsed by another thread
+
+    /**
+     * Get the document of some contents, parsing it if needed.
+     */
+    std::shared_ptr<const ConfigDocument>
+    document_(ConfigFormat format, std::string text, CacheStats& stats);
+
+public:
+    /**
+     * Get the parsed contents of a file.
+     *
+     * @throws std::system_error if the file can not be read.
+     * @throws ConfigError if the file is malformed.
+     */
+    std::shared_ptr<const ConfigDocument>
+    load(const std::filesystem::path& path, CacheStats& stats);
+
+    /**
+     * Write a file, and remember its new contents.
+     *
+     * The file is replaced atomically.
+     *
+     * @throws std::system_error if the file can not be written.
+     */
+    void write(
+        const std::filesystem::path& path,
+        std::shared_ptr<const ConfigDocument> document
+    );
+
+    /**
+     * Get the number of cached files.
+     */
+    [[nodiscard]] std::size_t size() const;
+
+    /**
+     * Forget every file.
+     */
+    void clear();
+};
+
+/**
+ * A config file that could not be edited.
+ */
+struct EditFailure {
+    std::filesystem::path file;
+    std::string error;
+};
+
+/**
+ * What applying a profile did.
+ */
+struct EditReport {
+    std::size_t files = 0;         ///< Config files found
+    std::size_t files_matched = 0; ///< Files matched by at least one edit
+    std::size_t files_changed = 0; ///< Files written, or that would have been
+    std::size_t values_changed = 0;
+    CacheStats cache;
+    std::vector<EditFailure> failures;
+    std::vector<std::size_t> unused_edits; ///< Edits that matched no key anywhere
+};
+
+/**
+ * Options for applying a profile.
+ */
+struct EditOptions {
+    bool dry_run = false; ///< Do not write anything
+    unsigned threads = 0; ///< 0 to use every core
+};
+
+/**
+ * Get the directory holding the config files of a pack.
+ *
+ * That is `config/` inside the pack, or the directory itself if it has none.
+ */
+std::filesystem::path config_dir(const std::filesystem::path& pack);
+
+/**
+ * Apply a profile to the config files of some packs.
+ *
+ * @param packs Pack (or instance) directories.
+ * @param profile The edits to apply.
+ * @param cache Parsed files, kept between calls.
+ * @param options How to apply the edits.
+ *
+ * @throws std::filesystem::filesystem_error if a pack can not be listed.
+ */
+EditReport apply_profile(
+    const std::vector<std::filesystem::path>& packs,
+    const EditProfile& profile,
+    ConfigCache& cache,
+    const EditOptions& options = {}
+);
+
+} // namespace configs
+} // namespace krompir
@@ -0,0 +1,349 @@
+#include "document.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <utility>
+
+namespace {
+
+using krompir::configs::ConfigEntry;
+
+/**
+ * Check if a value is already quoted.
+ */
+constexpr bool
+is_quoted(std::string_view value)
+{
+    return value.size() >= 2 && (value.front() == '"' || value.front() == '\'')
+           && value.back() == value.front();
+}
+
+/**
+ * Quote and escape a string, for TOML and JSON strings.
+ */
+std::string
+quote_string(std::string_view value, std::string_view quote)
+{
+    // Literal strings can not escape, fall back to basic strings
+    if (quote.front() == '\'' && value.find_first_of("'\n\\") != std::string_view::npos)
+        quote = quote.size() == 1 ? "\"" : "\"\"\"";
+
+    const bool escapes = quote.front() == '"';
+
+    std::string str(quote);
+    for (const char chr : value) {
+        if (!escapes) {
+            str += chr;
+            continue;
+        }
+
+        switch (chr) {
+            case '"':
+            case '\\':
+                str += '\\';
+                str += chr;
+                break;
+            case '\n':
+                str += "\\n";
+                break;
+            case '\r':
+                str += "\\r";
+                break;
+            case '\t':
+                str += "\\t";
+                break;
+            default:
+                str += chr;
+        }
+    }
+
+    str += quote;
+    return str;
+}
+
+/**
+ * Parse the hex digits of a `\u` or `\U` escape.
+ *
+ * @returns false if `digits` is not all hex digits.
+ */
+bool
+parse_hex(std::string_view digits, char32_t& code)
+{
+    code = 0;
+
+    for (const char chr : digits) {
+        char32_t digit = 0;
+        if (chr >= '0' && chr <= '9')
+            digit = static_cast<char32_t>(chr - '0');
+        else if (chr >= 'a' && chr <= 'f')
+            digit = static_cast<char32_t>(chr - 'a' + 10);
+        else if (chr >= 'A' && chr <= 'F')
+            digit = static_cast<char32_t>(chr - 'A' + 10);
+        else
+            return false;
+
+        code = code << 4u | digit;
+    }
+
+    return true;
+}
+
+/**
+ * Append a code point as UTF-8, or U+FFFD if it is not a valid one.
+ */
+void
+append_utf8(std::string& str, char32_t code)
+{
+    constexpr char32_t REPLACEMENT = 0xfffd;
+    if (code > 0x10ffff || (code >= 0xd800 && code <= 0xdfff))
+        code = REPLACEMENT;
+
+    const auto byte = [](char32_t bits) { return static_cast<char>(bits); };
+
+    if (code < 0x80) {
+        str += byte(code);
+    }
+    else if (code < 0x800) {
+        str += byte(0xc0 | code >> 6u);
+        str += byte(0x80 | (code & 0x3fu));
+    }
+    else if (code < 0x10000) {
+        str += byte(0xe0 | code >> 12u);
+        str += byte(0x80 | (code >> 6u & 0x3fu));
+        str += byte(0x80 | (code & 0x3fu));
+    }
+    else {
+        str += byte(0xf0 | code >> 18u);
+        str += byte(0x80 | (code >> 12u & 0x3fu));
+        str += byte(0x80 | (code >> 6u & 0x3fu));
+        str += byte(0x80 | (code & 0x3fu));
+    }
+}
+
+/**
+ * Resolve a `\uXXXX` or `\UXXXXXXXX` escape starting at `body[pos]`, the `u`,
+ * joining UTF-16 surrogate pairs written as two escapes.
+ *
+ * @returns The position of the last character of the escape, or `pos` if it is
+ *          malformed.
+ */
+std::size_t
+unescape_unicode(std::string_view body, std::size_t pos, std::string& str)
+{
+    const std::size_t digits = body[pos] == 'U' ? 8 : 4;
+
+    char32_t code = 0;
+    if (body.size() - pos - 1 < digits
+        || !parse_hex(body.substr(pos + 1, digits), code)) {
+        return pos;
+    }
+
+    auto end = pos + digits;
+
+    char32_t low = 0;
+    if (code >= 0xd800 && code <= 0xdbff && body.substr(end + 1, 2) == "\\u"
+        && body.size() - end - 3 >= 4 && parse_hex(body.substr(end + 3, 4), low)
+        && low >= 0xdc00 && low <= 0xdfff) {
+        code = 0x10000 + ((code - 0xd800) << 10u) + (low - 0xdc00);
+        end += 6;
+    }
+
+    append_utf8(str, code);
+    return end;
+}
+
+} // namespace
+
+namespace krompir {
+namespace configs {
+
+ConfigFormat
+detect_format(const std::filesystem::path& path)
+{
+    auto extension = path.extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](char chr) {
+        return static_cast<char>(std::tolower(static_cast<unsigned char>(chr)));
+    });
+
+    if (extension == ".toml")
+        return ConfigFormat::toml;
+    if (extension == ".json" || extension == ".json5")
+        return ConfigFormat::json;
+    if (extension == ".cfg")
+        return ConfigFormat::cfg;
+    if (extension == ".properties")
+        return ConfigFormat::properties;
+
+    return ConfigFormat::unknown;
+}
+
+std::string_view
+format_name(ConfigFormat format)
+{
+    switch (format) {
+        case ConfigFormat::unknown:
+            return "unknown";
+        case ConfigFormat::toml:
+            return "TOML";
+        case ConfigFormat::json:
+            return "JSON";
+        case ConfigFormat::cfg:
+            return "Forge cfg";
+        case ConfigFormat::properties:
+            return "properties";
+    }
+
+    return "unknown";
+}
+
+ConfigDocument::ConfigDocument(ConfigFormat format, std::string text) :
+    format_(format), text_(std::move(text))
+{
+    switch (format_) {
+        case ConfigFormat::toml:
+            entries_ = detail::parse_toml(text_);
+            break;
+        case ConfigFormat::json:
+            entries_ = detail::parse_json(text_);
+            break;
+        case ConfigFormat::cfg:
+            entries_ = detail::parse_cfg(text_);
+            break;
+        case ConfigFormat::properties:
+            entries_ = detail::parse_properties(text_);
+            break;
+        case ConfigFormat::unknown:
+            throw ConfigError("unknown config format");
+    }
+
+    index_.reserve(entries_.size());
+    for (std::size_t idx = 0; idx < entries_.size(); ++idx)
+        index_.try_emplace(entries_[idx].key, idx);
+}
+
+const ConfigEntry*
+ConfigDocument::find(std::string_view key) const
+{
+    const auto iter = index_.find(key);
+    return iter == index_.end() ? nullptr : &entries_[iter->second];
+}
+
+std::string_view
+ConfigDocument::value(const ConfigEntry& entry) const
+{
+    return std::string_view(text_).substr(entry.offset, entry.length);
+}
+
+std::string
+ConfigDocument::string(const ConfigEntry& entry) const
+{
+    const auto value = this->value(entry);
+    if (entry.kind != ValueKind::string)
+        return std::string(value);
+
+    const auto quote = entry.quote.size();
+    auto body = value.substr(quote, value.size() - 2 * quote);
+
+    // TOML trims a newline right after the quotes of multiline strings
+    if (quote == 3 && body.starts_with('\n'))
+        body.remove_prefix(1);
+
+    // Only JSON5 escapes in single quoted strings
+    if (format_ == ConfigFormat::toml && entry.quote.front() == '\'')
+        return std::string(body);
+
+    std::string str;
+    str.reserve(body.size());
+
+    for (std::size_t pos = 0; pos < body.size(); ++pos) {
+        if (body[pos] != '\\' || pos + 1 == body.size()) {
+            str += body[pos];
+            continue;
+        }
+
+        switch (const char chr = body[++pos]) {
+            case 'n':
+                str += '\n';
+                break;
+            case 'r':
+                str += '\r';
+                break;
+            case 't':
+                str += '\t';
+                break;
+            case 'b':
+                str += '\b';
+                break;
+            case 'f':
+                str += '\f';
+                break;
+            case 'u':
+            case 'U':
+                if (const auto end = unescape_unicode(body, pos, str); end != pos)
+                    pos = end;
+                else
+                    str += chr;
+                break;
+            default:
+                str += chr;
+        }
+    }
+
+    return str;
+}
+
+std::string
+ConfigDocument::format_value(const ConfigEntry& entry, std::string_view value) const
+{
+    if (entry.kind != ValueKind::string || is_quoted(value))
+        return std::string(value);
+
+    return quote_string(value, entry.quote);
+}
+
+std::string
+ConfigDocument::with_values(
+    std::vector<std::pair<const ConfigEntry*, std::string>> edits, std::size_t* applied
+) const
+{
+    // Drop edits overlapping an earlier one, then splice in order
+    std::vector<std::pair<const ConfigEntry*, std::string>> accepted;
+    accepted.reserve(edits.size());
+
+    for (auto& edit : edits) {
+        const auto* entry = edit.first;
+
+        const bool overlaps =
+            std::any_of(accepted.begin(), accepted.end(), [&](const auto& other) {
+                return entry == other.first
+                       || (entry->offset < other.first->offset + other.first->length
+                           && other.first->offset < entry->offset + entry->length);
+            });
+
+        if (!overlaps)
+            accepted.push_back(std::move(edit));
+    }
+
+    std::sort(accepted.begin(), accepted.end(), [](const auto& lhs, const auto& rhs) {
+        return lhs.first->offset < rhs.first->offset;
+    });
+
+    if (applied != nullptr)
+        *applied = accepted.size();
+
+    std::string text;
+    text.reserve(text_.size());
+
+    std::size_t pos = 0;
+    for (const auto& [entry, value] : accepted) {
+        text.append(text_, pos, entry->offset - pos);
+        text.append(value);
+        pos = entry->offset + entry->length;
+    }
+    text.append(text_, pos);
+
+    return text;
+}
+
+} // namespace configs
+} // namespace krompir
@@ -0,0 +1,170 @@
+/**
+ * @file document.hpp
+ * @brief Format-preserving views of mod config files.
+ * @copyright MIT
+ *
+ * Instead of building a tree of values that would have to be printed back,
+ * a document keeps the original text and indexes where every value is. Edits
+ * splice new values into the text, so comments, ordering and whitespace are
+ * left exactly as the mod (or the pack author) wrote them.
+ */
+#pragma once
+
+#include "utils/strings.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace krompir {
+namespace configs {
+
+/**
+ * The config file formats we understand.
+ */
+enum class ConfigFormat : std::uint8_t {
+    unknown,
+    toml,       ///< Forge/NeoForge and Fabric mods using night-config
+    json,       ///< JSON and JSON5, with comments and trailing commas
+    cfg,        ///< Legacy Forge `Configuration` files
+    properties, ///< Java properties
+};
+
+/**
+ * Guess the format of a config file from its extension.
+ */
+ConfigFormat detect_format(const std::filesystem::path& path);
+
+/**
+ * Get the name of a format.
+ */
+std::string_view format_name(ConfigFormat format);
+
+/**
+ * How a value is written.
+ */
+enum class ValueKind : std::uint8_t {
+    scalar,    ///< Numbers, booleans and unquoted strings
+    string,    ///< A quoted string
+    container, ///< An array, table or list
+};
+
+/**
+ * Where a value is in the text of a document.
+ */
+struct ConfigEntry {
+    std::string key;       ///< Dotted path, with `[n]` for array elements
+    std::size_t offset;    ///< Of the value, including any quotes
+    std::size_t length;    ///< Of the value, including any quotes
+    ValueKind kind;        ///< How the value is written
+    std::string_view quote; ///< The quotes of a string value
+};
+
+/**
+ * Thrown when a config file can not be parsed.
+ */
+class ConfigError : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
+
+/**
+ * A parsed config file.
+ */
+class ConfigDocument {
+    ConfigFormat format_;
+    std::string text_;
+    std::vector<ConfigEntry> entries_;
+    std::unordered_map<std::string, std::size_t, utils::StringHash, std::equal_to<>>
+        index_;
+
+public:
+    /**
+     * Parse a config file.
+     *
+     * @throws ConfigError if the text is malformed.
+     */
+    ConfigDocument(ConfigFormat format, std::string text);
+
+    [[nodiscard]] ConfigFormat
+    format() const noexcept
+    {
+        return format_;
+    }
+
+    [[nodiscard]] const std::string&
+    text() const noexcept
+    {
+        return text_;
+    }
+
+    [[nodiscard]] const std::vector<ConfigEntry>&
+    entries() const noexcept
+    {
+        return entries_;
+    }
+
+    /**
+     * Find the entry of a key.
+     *
+     * @returns nullptr if the key is not in the document.
+     */
+    [[nodiscard]] const ConfigEntry* find(std::string_view key) const;
+
+    /**
+     * Get the text of a value, as written.
+     */
+    [[nodiscard]] std::string_view value(const ConfigEntry& entry) const;
+
+    /**
+     * Get a value without its quotes, and with escapes resolved.
+     *
+     * Values that are not strings are returned as written.
+     */
+    [[nodiscard]] std::string string(const ConfigEntry& entry) const;
+
+    /**
+     * Write a value the way the document writes the value of an entry.
+     *
+     * Plain text given for a quoted string is escaped and quoted the same way,
+     * anything else is used as-is.
+     */
+    [[nodiscard]] std::string format_value(
+        const ConfigEntry& entry, std::string_view value
+    ) const;
+
+    /**
+     * Get the text of the document with some values replaced.
+     *
+     * @param edits Entries of this document and their new, formatted, values.
+     *              Overlapping edits are resolved in favour of the first one.
+     * @param applied If not null, set to the number of edits spliced in.
+     */
+    [[nodiscard]] std::string with_values(
+        std::vector<std::pair<const ConfigEntry*, std::string>> edits,
+        std::size_t* applied = nullptr
+    ) const;
+};
+
+namespace detail {
+
+/**
+ * Index the values of a config file, by format.
+ *
+ * @throws ConfigError if the text is malformed.
+ */
+std::vector<ConfigEntry> parse_toml(std::string_view text);
+std::vector<ConfigEntry> parse_json(std::string_view text);
+std::vector<ConfigEntry> parse_cfg(std::string_view text);
+std::vector<ConfigEntry> parse_properties(std::string_view text);
+
+} // namespace detail
+
+} // namespace configs
+} // namespace krompir
@@ -0,0 +1,729 @@
+#include "document.hpp"
+
+#include "utils/strings.hpp"
+
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <cctype>
+#include <unordered_map>
+
+namespace {
+
+using krompir::configs::ConfigEntry;
+using krompir::configs::ConfigError;
+using krompir::configs::ValueKind;
+
+namespace utils = krompir::utils;
+
+// The quotes of string values, referred to by entries
+constexpr std::string_view BASIC = "\"";
+constexpr std::string_view LITERAL = "'";
+constexpr std::string_view MULTILINE_BASIC = "\"\"\"";
+constexpr std::string_view MULTILINE_LITERAL = "'''";
+
+/**
+ * Get the 1-based line of an offset, for error messages.
+ */
+std::size_t
+line_of(std::string_view text, std::size_t offset)
+{
+    const auto end = text.begin() + static_cast<std::ptrdiff_t>(offset);
+    return static_cast<std::size_t>(std::count(text.begin(), end, '\n')) + 1;
+}
+
+/**
+ * Join a key to the path of its parent.
+ */
+std::string
+join_key(std::string_view parent, std::string_view key)
+{
+    if (parent.empty())
+        return std::string(key);
+
+    std::string path;
+    path.reserve(parent.size() + 1 + key.size());
+    path.append(parent).append(".").append(key);
+    return path;
+}
+
+/**
+ * Get the key of an array element.
+ */
+std::string
+element_key(std::string_view parent, std::size_t index)
+{
+    return fmt::format("{}[{}]", parent, index);
+}
+
+/**
+ * A position in the text of a config file.
+ */
+class Cursor {
+protected:
+    std::string_view text_;
+    std::size_t pos_ = 0;
+
+    explicit Cursor(std::string_view text) : text_(text) {}
+
+    [[noreturn]] void
+    fail_(std::string_view what) const
+    {
+        throw ConfigError(fmt::format("line {}: {}", line_of(text_, pos_), what));
+    }
+
+    [[nodiscard]] bool
+    at_end_() const
+    {
+        return pos_ >= text_.size();
+    }
+
+    [[nodiscard]] char
+    peek_(std::size_t ahead = 0) const
+    {
+        return pos_ + ahead < text_.size() ? text_[pos_ + ahead] : '\0';
+    }
+
+    [[nodiscard]] bool
+    starts_with_(std::string_view str) const
+    {
+        return text_.substr(pos_).starts_with(str);
+    }
+
+    void
+    expect_(char chr)
+    {
+        if (peek_() != chr)
+            fail_(fmt::format("expected '{}'", chr));
+        ++pos_;
+    }
+
+    /**
+     * Skip spaces and tabs.
+     */
+    void
+    skip_blank_()
+    {
+        while (peek_() == ' ' || peek_() == '\t')
+            ++pos_;
+    }
+
+    /**
+     * Skip to the next line.
+     */
+    void
+    skip_line_()
+    {
+        const auto newline = text_.find('\n', pos_);
+        pos_ = newline == std::string_view::npos ? text_.size() : newline + 1;
+    }
+
+    /**
+     * Skip a string starting at the cursor, with the given quotes.
+     *
+     * @param escapes If backslashes escape the next character.
+     * @param multiline If the string may span lines.
+     */
+    void
+    skip_string_(std::string_view quote, bool escapes, bool multiline)
+    {
+        pos_ += quote.size();
+
+        while (!at_end_()) {
+            if (escapes && peek_() == '\\') {
+                pos_ += 2;
+            }
+            else if (starts_with_(quote)) {
+                pos_ += quote.size();
+                return;
+            }
+            else if (!multiline && peek_() == '\n') {
+                break;
+            }
+            else {
+                ++pos_;
+            }
+        }
+
+        fail_("unterminated string");
+    }
+
+    /**
+     * Read a quoted key or name, without its quotes.
+     */
+    std::string
+    quoted_(char quote, bool escapes)
+    {
+        std::string str;
+        ++pos_;
+
+        while (!at_end_() && peek_() != quote && peek_() != '\n') {
+            if (escapes && peek_() == '\\')
+                ++pos_;
+            str += peek_();
+            ++pos_;
+        }
+
+        expect_(quote);
+        return str;
+    }
+};
+
+/**
+ * Indexes TOML, as written by night-config and by hand.
+ */
+class TomlParser : Cursor {
+    std::vector<ConfigEntry> entries_;
+    std::string table_;
+    std::unordered_map<std::string, std::size_t> array_tables_;
+
+    /**
+     * Skip to the next line, allowing only a comment on the rest of this one.
+     */
+    void
+    end_line_()
+    {
+        skip_blank_();
+
+        if (peek_() == '\r')
+            ++pos_;
+        if (!at_end_() && peek_() != '\n' && peek_() != '#')
+            fail_("expected the end of the line");
+
+        skip_line_();
+    }
+
+    /**
+     * Read a possibly dotted and quoted key.
+     */
+    std::string
+    key_()
+    {
+        std::string key;
+
+        while (true) {
+            skip_blank_();
+
+            if (peek_() == '"') {
+                key += quoted_('"', true);
+            }
+            else if (peek_() == '\'') {
+                key += quoted_('\'', false);
+            }
+            else {
+                const auto start = pos_;
+                while (std::isalnum(static_cast<unsigned char>(peek_())) != 0
+                       || peek_() == '_' || peek_() == '-')
+                    ++pos_;
+
+                if (pos_ == start)
+                    fail_("expected a key");
+                key.append(text_.substr(start, pos_ - start));
+            }
+
+            skip_blank_();
+            if (peek_() != '.')
+                return key;
+
+            key += '.';
+            ++pos_;
+        }
+    }
+
+    /**
+     * Skip over a string starting at the cursor.
+     *
+     * @returns The quotes of the string, or an empty view if there is none.
+     */
+    std::string_view
+    skip_any_string_()
+    {
+        if (starts_with_(MULTILINE_BASIC)) {
+            skip_string_(MULTILINE_BASIC, true, true);
+
+            // Up to two quotes may be part of the string
+            for (int extra = 0; extra < 2 && peek_() == '"'; ++extra)
+                ++pos_;
+            return MULTILINE_BASIC;
+        }
+        if (starts_with_(MULTILINE_LITERAL)) {
+            skip_string_(MULTILINE_LITERAL, false, true);
+
+            for (int extra = 0; extra < 2 && peek_() == '\''; ++extra)
+                ++pos_;
+            return MULTILINE_LITERAL;
+        }
+        if (peek_() == '"') {
+            skip_string_(BASIC, true, false);
+            return BASIC;
+        }
+        if (peek_() == '\'') {
+            skip_string_(LITERAL, false, false);
+            return LITERAL;
+        }
+
+        return {};
+    }
+
+    /**
+     * Skip whitespace, newlines and comments between elements of an array.
+     */
+    void
+    skip_space_()
+    {
+        while (!at_end_()) {
+            if (utils::is_space(peek_()))
+                ++pos_;
+            else if (peek_() == '#')
+                skip_line_();
+            else
+                return;
+        }
+    }
+
+    /**
+     * Parse the members or elements of an inline table or array, after its
+     * opening bracket.
+     */
+    template <typename Member>
+    void
+    members_(char close, Member&& member)
+    {
+        ++pos_;
+
+        while (true) {
+            skip_space_();
+            if (at_end_())
+                fail_("unterminated array or table");
+            if (peek_() == close)
+                break;
+
+            member();
+
+            skip_space_();
+            if (peek_() == ',')
+                ++pos_;
+            else if (peek_() != close)
+                fail_(fmt::format("expected ',' or '{}'", close));
+        }
+
+        ++pos_;
+    }
+
+    /**
+     * Index the value at the cursor, and everything in it.
+     *
+     * @param nested If the value is in an array or inline table, where it ends
+     *        at the next separator.
+     */
+    void
+    value_(const std::string& key, bool nested = false)
+    {
+        const auto start = pos_;
+        auto kind = ValueKind::container;
+
+        const auto quote = skip_any_string_();
+
+        if (!quote.empty()) {
+            kind = ValueKind::string;
+        }
+        else if (peek_() == '[') {
+            std::size_t index = 0;
+            members_(']', [&] { value_(element_key(key, index++), true); });
+        }
+        else if (peek_() == '{') {
+            members_('}', [&] {
+                const auto name = key_();
+                expect_('=');
+                skip_blank_();
+                value_(join_key(key, name), true);
+            });
+        }
+        else {
+            kind = ValueKind::scalar;
+
+            const auto separator = [&] {
+                return peek_() == ',' || peek_() == ']' || peek_() == '}';
+            };
+            while (!at_end_() && peek_() != '#' && peek_() != '\n'
+                   && !(nested && separator()))
+                ++pos_;
+
+            // Leave the trailing whitespace where it was
+            pos_ = start + utils::trim_right(text_.substr(start, pos_ - start)).size();
+            if (pos_ == start)
+                fail_("expected a value");
+        }
+
+        entries_.push_back({key, start, pos_ - start, kind, quote});
+    }
+
+public:
+    explicit TomlParser(std::string_view text) : Cursor(text) {}
+
+    std::vector<ConfigEntry>
+    parse() &&
+    {
+        while (true) {
+            while (utils::is_space(peek_()))
+                ++pos_;
+            if (at_end_())
+                break;
+
+            if (peek_() == '#') {
+                skip_line_();
+            }
+            else if (starts_with_("[[")) {
+                pos_ += 2;
+                auto name = key_();
+                expect_(']');
+                expect_(']');
+
+                const auto index = array_tables_[name]++;
+                table_ = element_key(name, index);
+                end_line_();
+            }
+            else if (peek_() == '[') {
+                ++pos_;
+                table_ = key_();
+                expect_(']');
+                end_line_();
+            }
+            else {
+                const auto key = join_key(table_, key_());
+                expect_('=');
+                skip_blank_();
+                value_(key);
+                end_line_();
+            }
+        }
+
+        return std::move(entries_);
+    }
+};
+
+/**
+ * Indexes JSON, and the JSON5 extensions mods tend to use.
+ */
+class JsonParser : Cursor {
+    std::vector<ConfigEntry> entries_;
+
+    /**
+     * Skip whitespace and comments.
+     */
+    void
+    skip_space_()
+    {
+        while (!at_end_()) {
+            if (utils::is_space(peek_())) {
+                ++pos_;
+            }
+            else if (starts_with_("//")) {
+                skip_line_();
+            }
+            else if (starts_with_("/*")) {
+                const auto end = text_.find("*/", pos_ + 2);
+                if (end == std::string_view::npos)
+                    fail_("unterminated comment");
+                pos_ = end + 2;
+            }
+            else {
+                return;
+            }
+        }
+    }
+
+    /**
+     * Read a member name, quoted or not.
+     */
+    std::string
+    key_()
+    {
+        if (peek_() == '"' || peek_() == '\'')
+            return quoted_(peek_(), true);
+
+        const auto start = pos_;
+        while (std::isalnum(static_cast<unsigned char>(peek_())) != 0 || peek_() == '_'
+               || peek_() == '$')
+            ++pos_;
+
+        if (pos_ == start)
+            fail_("expected a member name");
+        return std::string(text_.substr(start, pos_ - start));
+    }
+
+    /**
+     * Parse the members or elements of a container, after its opening bracket.
+     */
+    template <typename Member>
+    void
+    members_(char close, Member&& member)
+    {
+        ++pos_;
+
+        while (true) {
+            skip_space_();
+            if (peek_() == close)
+                break;
+
+            member();
+
+            skip_space_();
+            if (peek_() == ',')
+                ++pos_;
+            else if (peek_() != close)
+                fail_(fmt::format("expected ',' or '{}'", close));
+        }
+
+        ++pos_;
+    }
+
+    /**
+     * Index the value at the cursor, and everything in it.
+     */
+    void
+    value_(const std::string& key)
+    {
+        skip_space_();
+
+        const auto start = pos_;
+        auto kind = ValueKind::container;
+        std::string_view quote;
+
+        if (peek_() == '{') {
+            members_('}', [&] {
+                auto name = key_();
+                skip_space_();
+                expect_(':');
+                value_(join_key(key, name));
+            });
+        }
+        else if (peek_() == '[') {
+            std::size_t index = 0;
+            members_(']', [&] { value_(element_key(key, index++)); });
+        }
+        else if (peek_() == '"' || peek_() == '\'') {
+            quote = peek_() == '"' ? BASIC : LITERAL;
+            kind = ValueKind::string;
+            skip_string_(quote, true, false);
+        }
+        else {
+            kind = ValueKind::scalar;
+            while (!at_end_() && !utils::is_space(peek_()) && peek_() != ','
+                   && peek_() != ']' && peek_() != '}' && peek_() != '/')
+                ++pos_;
+
+            if (pos_ == start)
+                fail_("expected a value");
+        }
+
+        // The root is not a value that can be set
+        if (!key.empty())
+            entries_.push_back({key, start, pos_ - start, kind, quote});
+    }
+
+public:
+    explicit JsonParser(std::string_view text) : Cursor(text) {}
+
+    std::vector<ConfigEntry>
+    parse() &&
+    {
+        value_({});
+        skip_space_();
+
+        if (!at_end_())
+            fail_("unexpected text after the document");
+
+        return std::move(entries_);
+    }
+};
+
+/**
+ * Remove the quotes around a legacy Forge config name.
+ */
+std::string_view
+unquote(std::string_view name)
+{
+    if (name.size() >= 2 && name.front() == '"' && name.back() == '"')
+        return name.substr(1, name.size() - 2);
+    return name;
+}
+
+} // namespace
+
+namespace krompir {
+namespace configs {
+namespace detail {
+
+std::vector<ConfigEntry>
+parse_toml(std::string_view text)
+{
+    return TomlParser(text).parse();
+}
+
+std::vector<ConfigEntry>
+parse_json(std::string_view text)
+{
+    return JsonParser(text).parse();
+}
+
+std::vector<ConfigEntry>
+parse_cfg(std::string_view text)
+{
+    std::vector<ConfigEntry> entries;
+    std::vector<std::string> categories;
+
+    std::size_t line_number = 0;
+    std::string list_key;
+    std::size_t list_start = 0;
+    bool in_list = false;
+
+    const auto offset = [&](std::string_view part) {
+        return static_cast<std::size_t>(part.data() - text.data());
+    };
+
+    const auto fail = [&](std::string_view what) {
+        throw ConfigError(fmt::format("line {}: {}", line_number, what));
+    };
+
+    utils::for_each_line(text, [&](std::string_view line) {
+        ++line_number;
+        const auto trimmed = utils::trim(line);
+
+        // Lists hold one value per line, up to a closing '>'
+        if (in_list) {
+            if (trimmed.starts_with('>')) {
+                entries.push_back(
+                    {list_key,
+                     list_start,
+                     offset(trimmed) - list_start,
+                     ValueKind::container,
+                     {}}
+                );
+                in_list = false;
+            }
+            return;
+        }
+
+        if (trimmed.empty() || trimmed.front() == '#')
+            return;
+
+        if (trimmed == "}") {
+            if (categories.empty())
+                fail("unexpected '}'");
+
+            categories.pop_back();
+            return;
+        }
+
+        const auto parent = categories.empty() ? std::string_view() : categories.back();
+
+        if (trimmed.back() == '{') {
+            const auto name = utils::trim(trimmed.substr(0, trimmed.size() - 1));
+            categories.push_back(join_key(parent, unquote(name)));
+            return;
+        }
+
+        // Properties start with their type, like `B:name=true` or `S:name <`
+        auto body = trimmed;
+        if (body.size() > 2 && body[1] == ':')
+            body.remove_prefix(2);
+
+        std::size_t separator = 0;
+        if (body.front() == '"') {
+            separator = body.find('"', 1);
+            if (separator == std::string_view::npos)
+                fail("unterminated name");
+            ++separator;
+        }
+        separator = body.find_first_of("=<", separator);
+
+        if (separator == std::string_view::npos)
+            fail("expected '=' or '<'");
+
+        const auto name = unquote(utils::trim(body.substr(0, separator)));
+        auto key = join_key(parent, name);
+
+        if (body[separator] == '<') {
+            list_key = std::move(key);
+            list_start = offset(body) + separator + 1;
+            in_list = true;
+            return;
+        }
+
+        const auto rest = body.substr(separator + 1);
+        const auto value = utils::trim(rest);
+        const auto start = value.empty() ? offset(rest) + rest.size() : offset(value);
+
+        entries.push_back({std::move(key), start, value.size(), ValueKind::scalar, {}});
+    });
+
+    if (in_list)
+        fail("unterminated list");
+    if (!categories.empty())
+        fail("unterminated category");
+
+    return entries;
+}
+
+std::vector<ConfigEntry>
+parse_properties(std::string_view text)
+{
+    std::vector<ConfigEntry> entries;
+    std::size_t pos = 0;
+
+    const auto line_end = [&](std::size_t from) {
+        const auto newline = text.find('\n', from);
+        return newline == std::string_view::npos ? text.size() : newline;
+    };
+
+    while (pos < text.size()) {
+        auto end = line_end(pos);
+
+        while (pos < end && utils::is_space(text[pos]))
+            ++pos;
+
+        if (pos == end || text[pos] == '#' || text[pos] == '!') {
+            pos = end + 1;
+            continue;
+        }
+
+        // The key ends at the first unescaped separator or whitespace
+        std::string key;
+        while (pos < end && text[pos] != '=' && text[pos] != ':'
+               && !utils::is_space(text[pos])) {
+            if (text[pos] == '\\' && pos + 1 < end)
+                ++pos;
+            key += text[pos++];
+        }
+
+        while (pos < end && (text[pos] == ' ' || text[pos] == '\t'))
+            ++pos;
+        if (pos < end && (text[pos] == '=' || text[pos] == ':'))
+            ++pos;
+        while (pos < end && (text[pos] == ' ' || text[pos] == '\t'))
+            ++pos;
+
+        // Values continue on the next line after an odd number of backslashes
+        const auto start = pos;
+        while (true) {
+            const auto line = utils::trim_right(text.substr(start, end - start));
+            const auto slashes = line.size() - line.find_last_not_of('\\') - 1;
+
+            if (end >= text.size() || slashes % 2 == 0 || line.empty())
+                break;
+            end = line_end(end + 1);
+        }
+
+        const auto value = utils::trim_right(text.substr(start, end - start));
+        entries.push_back({std::move(key), start, value.size(), ValueKind::scalar, {}});
+
+        pos = end + 1;
+    }
+
+    return entries;
+}
+
+} // namespace detail
+} // namespace configs
+} // namespace krompir
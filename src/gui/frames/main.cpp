@@ -1,6 +1,7 @@
 #include "main.hpp"
 
 #include "gui/icons.hpp"
+#include "gui/pages/pages.hpp"
 #include "utils/utils.hpp"
 
 #include <wx/artprov.h>
@@ -72,13 +73,19 @@ MainFrame::MainFrame(const wxString& title) : wxFrame(nullptr, wxID_ANY, title)
     book->SetName("Test Book");
     book->SetImages(images);
 
+    book->AddPage(new LogAnalyzerPage(book), "Log Analyzer", true, 2);
     book->AddPage(new wxNotebookPage(book, wxID_ANY), "Page 1", false, 0);
     book->AddPage(new wxNotebookPage(book, wxID_ANY), "Page 2", false, 1);
     book->AddPage(new wxNotebookPage(book, wxID_ANY), "Page 3", false, 2);
+    book->AddPage(new MetricsPage(book), "Metrics", false, 0);
 
-    new wxStaticText(book->GetPage(0), wxID_ANY, "This is some text");
-    new wxStaticText(book->GetPage(1), wxID_ANY, "This is some other text");
-    new wxStaticText(book->GetPage(2), wxID_ANY, "This is more text");
+#if TRACK_ALLOCATIONS()
+    book->AddPage(new AllocationsPage(book), "Allocations", false, 0);
+#endif
+
+    new wxStaticText(book->GetPage(1), wxID_ANY, "This is some text");
+    new wxStaticText(book->GetPage(2), wxID_ANY, "This is some other text");
+    new wxStaticText(book->GetPage(3), wxID_ANY, "This is more text");
 }
 
 /*****************************************************************************
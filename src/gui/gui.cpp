@@ -3,6 +3,7 @@
 #include "common.hpp"
 #include "frames/frames.hpp"
 #include "logging.hpp"
+#include "memory/alloc_tracker.hpp"
 #include "utils/utils.hpp"
 
 #include <wx/wxprec.h>
@@ -52,6 +53,18 @@ public:
         return true;
     }
 
+    /**
+     * Run the main loop.
+     *
+     * Everything allocated by the event handlers is attributed to the GUI.
+     */
+    int
+    OnRun() override
+    {
+        const memory::AllocScope scope(memory::Subsystem::gui);
+        return wxApp::OnRun();
+    }
+
     /**
      * Called on app exit, for us to do cleanup and return exit status.
      *
@@ -60,6 +73,9 @@ public:
     int
     OnExit() override
     {
+        if constexpr (memory::tracking_enabled())
+            memory::log_alloc_snapshot(memory::alloc_snapshot());
+
         // Make sure everything got logged
         logging::process();
 
@@ -0,0 +1,143 @@
+#include "allocations.hpp"
+
+#include <wx/sizer.h>
+
+#include <fmt/core.h>
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace {
+
+/// How often the counters are refreshed, in milliseconds
+constexpr int REFRESH_INTERVAL = 1000;
+
+/**
+ * Format a byte count with a binary unit.
+ */
+std::string
+format_bytes(double bytes)
+{
+    constexpr double KIB = 1024.0;
+    constexpr std::array UNITS = {"B", "KiB", "MiB", "GiB", "TiB"};
+
+    std::size_t unit = 0;
+    while ((bytes >= KIB || bytes <= -KIB) && unit + 1 < UNITS.size()) {
+        bytes /= KIB;
+        ++unit;
+    }
+
+    return unit == 0 ? fmt::format("{:.0f} B", bytes)
+                     : fmt::format("{:.1f} {}", bytes, UNITS.at(unit));
+}
+
+} // namespace
+
+namespace krompir {
+namespace gui {
+
+AllocationsPage::AllocationsPage(wxWindow* parent) :
+    wxPanel(parent, wxID_ANY), last_(memory::alloc_snapshot()), timer_(this)
+{
+    auto* log_button = new wxButton(this, wxID_ANY, "&Log snapshot");
+
+    summary_ = new wxStaticText(this, wxID_ANY, "Counting allocations since startup.");
+
+    subsystems_ = new wxListCtrl(
+        this,
+        wxID_ANY,
+        wxDefaultPosition,
+        wxDefaultSize,
+        wxLC_REPORT | wxLC_SINGLE_SEL // NOLINT(hicpp-signed-bitwise)
+    );
+    subsystems_->AppendColumn("Subsystem", wxLIST_FORMAT_LEFT, FromDIP(160));
+    subsystems_->AppendColumn("Live", wxLIST_FORMAT_RIGHT, FromDIP(100));
+    subsystems_->AppendColumn("Peak", wxLIST_FORMAT_RIGHT, FromDIP(100));
+    subsystems_->AppendColumn("Allocations", wxLIST_FORMAT_RIGHT, FromDIP(100));
+    subsystems_->AppendColumn("Allocations/s", wxLIST_FORMAT_RIGHT, FromDIP(100));
+    subsystems_->AppendColumn("Allocated/s", wxLIST_FORMAT_RIGHT, FromDIP(100));
+
+    for (std::size_t i = 0; i < memory::SUBSYSTEMS; ++i) {
+        const auto name = memory::subsystem_name(static_cast<memory::Subsystem>(i));
+        subsystems_->InsertItem(static_cast<long>(i), std::string(name));
+    }
+    subsystems_->InsertItem(static_cast<long>(memory::SUBSYSTEMS), "total");
+
+    // Layout
+    auto* sizer = new wxBoxSizer(wxVERTICAL);
+    sizer->Add(log_button, wxSizerFlags().Border());
+    sizer->Add(summary_, wxSizerFlags().Border(wxLEFT | wxRIGHT));
+    sizer->Add(subsystems_, wxSizerFlags(1).Expand().Border());
+    SetSizer(sizer);
+
+    // Events
+    log_button->Bind(wxEVT_BUTTON, &AllocationsPage::on_log_snapshot_, this);
+    Bind(wxEVT_TIMER, &AllocationsPage::on_timer_, this);
+
+    refresh_();
+    timer_.Start(REFRESH_INTERVAL);
+}
+
+void
+AllocationsPage::refresh_()
+{
+    const auto snapshot = memory::alloc_snapshot();
+    const auto seconds =
+        std::chrono::duration<double>(snapshot.time - last_.time).count();
+
+    const auto rate = [&](std::uint64_t current, std::uint64_t previous) {
+        return seconds > 0 ? static_cast<double>(current - previous) / seconds : 0.0;
+    };
+
+    const auto show = [&](long row, const auto& now, const auto& before) {
+        subsystems_->SetItem(row, 1, format_bytes(static_cast<double>(now.live_bytes)));
+        subsystems_->SetItem(row, 2, format_bytes(static_cast<double>(now.peak_bytes)));
+        subsystems_->SetItem(row, 3, fmt::format("{}", now.allocations));
+        subsystems_->SetItem(
+            row, 4, fmt::format("{:.0f}", rate(now.allocations, before.allocations))
+        );
+        subsystems_->SetItem(
+            row,
+            5,
+            format_bytes(rate(now.bytes_allocated, before.bytes_allocated)) + "/s"
+        );
+    };
+
+    subsystems_->Freeze();
+
+    for (std::size_t i = 0; i < memory::SUBSYSTEMS; ++i)
+        show(static_cast<long>(i), snapshot.subsystems.at(i), last_.subsystems.at(i));
+    show(static_cast<long>(memory::SUBSYSTEMS), snapshot.total, last_.total);
+
+    subsystems_->Thaw();
+
+    last_ = snapshot;
+}
+
+/*****************************************************************************
+ *    event handlers (these functions should _not_ be virtual or static)     *
+ *****************************************************************************/
+
+void
+AllocationsPage::on_timer_(wxTimerEvent& event)
+{
+    UNUSED(event);
+
+    // No need to refresh while hidden
+    if (IsShownOnScreen())
+        refresh_();
+}
+
+void
+AllocationsPage::on_log_snapshot_(wxCommandEvent& event)
+{
+    UNUSED(event);
+
+    memory::log_alloc_snapshot(memory::alloc_snapshot());
+}
+
+} // namespace gui
+} // namespace krompir
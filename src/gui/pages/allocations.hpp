@@ -0,0 +1,57 @@
+#pragma once
+
+#include "common.hpp"
+#include "memory/alloc_tracker.hpp"
+
+#include <wx/wxprec.h>
+
+#ifndef WX_PRECOMP
+#  include <wx/wx.h>
+#endif
+
+#include <wx/listctrl.h>
+#include <wx/timer.h>
+
+namespace krompir {
+namespace gui {
+
+/**
+ * A debug page showing where heap memory goes, per subsystem.
+ *
+ * Only shown in builds with `krompir_TRACK_ALLOCATIONS`, the counters are
+ * refreshed every second.
+ */
+class AllocationsPage : public wxPanel {
+    memory::AllocSnapshot last_;
+
+    wxStaticText* summary_;
+    wxListCtrl* subsystems_;
+    wxTimer timer_;
+
+    /**
+     * Take a new snapshot and show it, with the rates since the last one.
+     */
+    void refresh_();
+
+public:
+    /**
+     * Create a new allocations page.
+     */
+    explicit AllocationsPage(wxWindow* parent);
+
+private:
+    /*  event handlers (these functions should _not_ be virtual or static)   */
+
+    /**
+     * Called every second to refresh the counters.
+     */
+    void on_timer_(wxTimerEvent& event);
+
+    /**
+     * Called when the "Log snapshot" button is pressed.
+     */
+    void on_log_snapshot_(wxCommandEvent& event);
+};
+
+} // namespace gui
+} // namespace krompir
@@ -0,0 +1,198 @@
+#include "log_analyzer.hpp"
+
+#include <wx/filedlg.h>
+#include <wx/sizer.h>
+
+#include <fmt/core.h>
+
+#include <filesystem>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+namespace krompir {
+namespace gui {
+
+LogAnalyzerPage::LogAnalyzerPage(wxWindow* parent) : wxPanel(parent, wxID_ANY)
+{
+    auto* open_button = new wxButton(this, wxID_ANY, "&Open logs...");
+    auto* index_button = new wxButton(this, wxID_ANY, "Load class &index...");
+
+    summary_ = new wxStaticText(
+        this, wxID_ANY, "Open a latest.log, debug.log or crash report to analyze."
+    );
+
+    suspects_ = new wxListCtrl(
+        this,
+        wxID_ANY,
+        wxDefaultPosition,
+        wxDefaultSize,
+        wxLC_REPORT | wxLC_SINGLE_SEL // NOLINT(hicpp-signed-bitwise)
+    );
+    suspects_->AppendColumn("Mod", wxLIST_FORMAT_LEFT, FromDIP(240));
+    suspects_->AppendColumn("Score", wxLIST_FORMAT_RIGHT);
+    suspects_->AppendColumn("Frames", wxLIST_FORMAT_RIGHT);
+    suspects_->AppendColumn("Mixins", wxLIST_FORMAT_RIGHT);
+    suspects_->AppendColumn("Mentions", wxLIST_FORMAT_RIGHT);
+
+    // Layout
+    auto* buttons = new wxBoxSizer(wxHORIZONTAL);
+    buttons->Add(open_button);
+    buttons->AddSpacer(FromDIP(8));
+    buttons->Add(index_button);
+
+    auto* sizer = new wxBoxSizer(wxVERTICAL);
+    sizer->Add(buttons, wxSizerFlags().Border());
+    sizer->Add(summary_, wxSizerFlags().Border(wxLEFT | wxRIGHT));
+    sizer->Add(suspects_, wxSizerFlags(1).Expand().Border());
+    SetSizer(sizer);
+
+    // Events
+    open_button->Bind(wxEVT_BUTTON, &LogAnalyzerPage::on_open_logs_, this);
+    index_button->Bind(wxEVT_BUTTON, &LogAnalyzerPage::on_load_index_, this);
+}
+
+void
+LogAnalyzerPage::analyze_(const wxArrayString& paths)
+{
+    std::vector<std::filesystem::path> files;
+    files.reserve(paths.size());
+
+    for (const auto& path : paths)
+        files.emplace_back(path.utf8_string());
+
+    // The page stays disabled while analyzing, so the index is not replaced
+    // and the last worker is done
+    if (worker_.joinable())
+        worker_.join();
+
+    Disable();
+    summary_->SetLabel(fmt::format("Analyzing {} files...", files.size()));
+    Layout();
+
+    worker_ = std::jthread([this, files = std::move(files)] {
+        try {
+            auto result = analyze::analyze_files(files, index_);
+            CallAfter([this, result = std::move(result), count = files.size()] {
+                show_(result, count);
+            });
+        } catch (const std::system_error& err) {
+            log_e(gui, "Failed to analyze logs: {}", err.what());
+            CallAfter([this, message = std::string(err.what())] {
+                show_error_(message);
+            });
+        }
+
+        logging::release_thread_writer();
+    });
+}
+
+void
+LogAnalyzerPage::show_(const analyze::Analysis& result, std::size_t files)
+{
+    Enable();
+
+    summary_->SetLabel(fmt::format(
+        "Scanned {} lines ({:.1f} MiB) from {} files, {} suspects.",
+        result.lines,
+        static_cast<double>(result.bytes) / (1u << 20u),
+        files,
+        result.suspects.size()
+    ));
+
+    suspects_->Freeze();
+    suspects_->DeleteAllItems();
+
+    for (const auto& suspect : result.suspects) {
+        const long row = suspects_->InsertItem(suspects_->GetItemCount(), suspect.mod);
+
+        suspects_->SetItem(row, 1, fmt::format("{:.1f}", suspect.score));
+        suspects_->SetItem(row, 2, fmt::format("{}", suspect.frames));
+        suspects_->SetItem(row, 3, fmt::format("{}", suspect.mixins));
+        suspects_->SetItem(row, 4, fmt::format("{}", suspect.mentions));
+    }
+
+    suspects_->Thaw();
+    Layout();
+}
+
+void
+LogAnalyzerPage::show_error_(const std::string& message)
+{
+    Enable();
+
+    summary_->SetLabel("Open a latest.log, debug.log or crash report to analyze.");
+    Layout();
+
+    wxMessageBox(
+        message,
+        "Failed to analyze logs",
+        wxOK | wxICON_ERROR, // NOLINT(hicpp-signed-bitwise)
+        this
+    );
+}
+
+/*****************************************************************************
+ *    event handlers (these functions should _not_ be virtual or static)     *
+ *****************************************************************************/
+
+void
+LogAnalyzerPage::on_open_logs_(wxCommandEvent& event)
+{
+    UNUSED(event);
+
+    wxFileDialog dialog(
+        this,
+        "Open logs and crash reports",
+        wxEmptyString,
+        wxEmptyString,
+        "Logs and crash reports (*.log;*.txt)|*.log;*.txt|All files|*",
+        wxFD_OPEN | wxFD_FILE_MUST_EXIST | wxFD_MULTIPLE // NOLINT(hicpp-signed-bitwise)
+    );
+
+    if (dialog.ShowModal() != wxID_OK)
+        return;
+
+    wxArrayString paths;
+    dialog.GetPaths(paths);
+
+    analyze_(paths);
+}
+
+void
+LogAnalyzerPage::on_load_index_(wxCommandEvent& event)
+{
+    UNUSED(event);
+
+    wxFileDialog dialog(
+        this,
+        "Load class index",
+        wxEmptyString,
+        wxEmptyString,
+        "All files|*",
+        wxFD_OPEN | wxFD_FILE_MUST_EXIST // NOLINT(hicpp-signed-bitwise)
+    );
+
+    if (dialog.ShowModal() != wxID_OK)
+        return;
+
+    try {
+        index_ = analyze::ClassIndex::load(dialog.GetPath().utf8_string());
+    } catch (const std::system_error& err) {
+        log_e(gui, "Failed to load class index: {}", err.what());
+        wxMessageBox(
+            err.what(),
+            "Failed to load class index",
+            wxOK | wxICON_ERROR, // NOLINT(hicpp-signed-bitwise)
+            this
+        );
+        return;
+    }
+
+    summary_->SetLabel(fmt::format("Loaded {} class index entries.", index_.size()));
+    Layout();
+}
+
+} // namespace gui
+} // namespace krompir
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "analyze/log_analyzer.hpp"
+#include "common.hpp"
+
+#include <wx/wxprec.h>
+
+#ifndef WX_PRECOMP
+#  include <wx/wx.h>
+#endif
+
+#include <wx/listctrl.h>
+
+#include <cstddef>
+#include <string>
+#include <thread>
+
+namespace krompir {
+namespace gui {
+
+/**
+ * A page for finding the mods responsible for a crash.
+ *
+ * Logs and crash reports are picked with a file dialog, and the suspects are
+ * listed most likely first. Logs are analyzed on a worker thread, with the
+ * page disabled until the results are shown.
+ */
+class LogAnalyzerPage : public wxPanel {
+    analyze::ClassIndex index_;
+
+    wxStaticText* summary_;
+    wxListCtrl* suspects_;
+
+    std::jthread worker_; ///< Analyzing logs, last so it is joined first
+
+    /**
+     * Start analyzing the given files, showing the results once done.
+     */
+    void analyze_(const wxArrayString& paths);
+
+    /**
+     * Show the results of an analysis.
+     */
+    void show_(const analyze::Analysis& result, std::size_t files);
+
+    /**
+     * Show why logs could not be analyzed.
+     */
+    void show_error_(const std::string& message);
+
+public:
+    /**
+     * Create a new log analyzer page.
+     */
+    explicit LogAnalyzerPage(wxWindow* parent);
+
+private:
+    /*  event handlers (these functions should _not_ be virtual or static)   */
+
+    /**
+     * Called when the "Open logs" button is pressed.
+     */
+    void on_open_logs_(wxCommandEvent& event);
+
+    /**
+     * Called when the "Load class index" button is pressed.
+     */
+    void on_load_index_(wxCommandEvent& event);
+};
+
+} // namespace gui
+} // namespace krompir
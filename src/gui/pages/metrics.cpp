@@ -0,0 +1,125 @@
+#include "metrics.hpp"
+
+#include <wx/sizer.h>
+
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <utility>
+
+namespace {
+
+/// How often the metrics are refreshed, in milliseconds
+constexpr int REFRESH_INTERVAL = 1000;
+
+enum Column : int { NAME, TYPE, VALUE, RATE, P50, P99, MAX };
+
+} // namespace
+
+namespace krompir {
+namespace gui {
+
+MetricsPage::MetricsPage(wxWindow* parent) :
+    wxPanel(parent, wxID_ANY), timer_(this)
+{
+    metrics_ = new wxListCtrl(
+        this,
+        wxID_ANY,
+        wxDefaultPosition,
+        wxDefaultSize,
+        wxLC_REPORT | wxLC_SINGLE_SEL // NOLINT(hicpp-signed-bitwise)
+    );
+    metrics_->AppendColumn("Metric", wxLIST_FORMAT_LEFT, FromDIP(280));
+    metrics_->AppendColumn("Type", wxLIST_FORMAT_LEFT, FromDIP(80));
+    metrics_->AppendColumn("Value", wxLIST_FORMAT_RIGHT, FromDIP(100));
+    metrics_->AppendColumn("Rate/s", wxLIST_FORMAT_RIGHT, FromDIP(80));
+    metrics_->AppendColumn("p50", wxLIST_FORMAT_RIGHT, FromDIP(80));
+    metrics_->AppendColumn("p99", wxLIST_FORMAT_RIGHT, FromDIP(80));
+    metrics_->AppendColumn("Max", wxLIST_FORMAT_RIGHT, FromDIP(80));
+
+    // Layout
+    auto* sizer = new wxBoxSizer(wxVERTICAL);
+    sizer->Add(metrics_, wxSizerFlags(1).Expand().Border());
+    SetSizer(sizer);
+
+    // Events
+    Bind(wxEVT_TIMER, &MetricsPage::on_timer_, this);
+
+    refresh_();
+    timer_.Start(REFRESH_INTERVAL);
+}
+
+void
+MetricsPage::refresh_()
+{
+    auto snapshot = metrics::Registry::global().snapshot();
+    const auto seconds =
+        std::chrono::duration<double>(snapshot.time - last_.time).count();
+
+    metrics_->Freeze();
+
+    // Metrics are only ever added, and sorted by name
+    while (metrics_->GetItemCount() < static_cast<int>(snapshot.metrics.size()))
+        metrics_->InsertItem(metrics_->GetItemCount(), wxEmptyString);
+
+    for (std::size_t idx = 0; idx < snapshot.metrics.size(); ++idx) {
+        const auto& metric = snapshot.metrics[idx];
+        const auto row = static_cast<long>(idx);
+
+        const auto type = metrics::metric_type_name(metric.type);
+
+        metrics_->SetItem(row, NAME, metric.name);
+        metrics_->SetItem(row, TYPE, std::string(type));
+        metrics_->SetItem(row, RATE, wxEmptyString);
+
+        if (metric.type == metrics::MetricType::histogram) {
+            const auto& histogram = metric.histogram;
+
+            metrics_->SetItem(row, VALUE, fmt::format("{}", histogram.count));
+            metrics_->SetItem(row, P50, fmt::format("{}", histogram.quantile(0.5)));
+            metrics_->SetItem(row, P99, fmt::format("{}", histogram.quantile(0.99)));
+            metrics_->SetItem(row, MAX, fmt::format("{}", histogram.max));
+            continue;
+        }
+
+        metrics_->SetItem(row, VALUE, fmt::format("{}", metric.value));
+
+        if (metric.type != metrics::MetricType::counter || seconds <= 0)
+            continue;
+
+        const auto previous = std::find_if(
+            last_.metrics.begin(),
+            last_.metrics.end(),
+            [&](const auto& other) { return other.name == metric.name; }
+        );
+
+        if (previous != last_.metrics.end()) {
+            const auto delta = static_cast<double>(metric.value - previous->value);
+            metrics_->SetItem(row, RATE, fmt::format("{:.1f}", delta / seconds));
+        }
+    }
+
+    metrics_->Thaw();
+
+    last_ = std::move(snapshot);
+}
+
+/*****************************************************************************
+ *    event handlers (these functions should _not_ be virtual or static)     *
+ *****************************************************************************/
+
+void
+MetricsPage::on_timer_(wxTimerEvent& event)
+{
+    UNUSED(event);
+
+    // No need to refresh while hidden
+    if (IsShownOnScreen())
+        refresh_();
+}
+
+} // namespace gui
+} // namespace krompir
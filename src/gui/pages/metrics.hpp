@@ -0,0 +1,50 @@
+#pragma once
+
+#include "common.hpp"
+#include "metrics/metrics.hpp"
+
+#include <wx/wxprec.h>
+
+#ifndef WX_PRECOMP
+#  include <wx/wx.h>
+#endif
+
+#include <wx/listctrl.h>
+#include <wx/timer.h>
+
+namespace krompir {
+namespace gui {
+
+/**
+ * A page listing every metric, refreshed every second.
+ *
+ * Counters show their rate since the last refresh, histograms their quantiles.
+ */
+class MetricsPage : public wxPanel {
+    metrics::MetricsSnapshot last_;
+
+    wxListCtrl* metrics_;
+    wxTimer timer_;
+
+    /**
+     * Take a new snapshot and show it.
+     */
+    void refresh_();
+
+public:
+    /**
+     * Create a new metrics page.
+     */
+    explicit MetricsPage(wxWindow* parent);
+
+private:
+    /*  event handlers (these functions should _not_ be virtual or static)   */
+
+    /**
+     * Called every second to refresh the metrics.
+     */
+    void on_timer_(wxTimerEvent& event);
+};
+
+} // namespace gui
+} // namespace krompir
@@ -0,0 +1,5 @@
+#pragma once
+
+#include "allocations.hpp"
+#include "log_analyzer.hpp"
+#include "metrics.hpp"
@@ -1,9 +1,112 @@
 #include "logging.hpp"
 
+#include "metrics/metrics.hpp"
+
+#include <algorithm>
+#include <cstdint>
 #include <ios>
+#include <optional>
 
 namespace {
 
+/**
+ * Get the gauges tracking the writers of threads.
+ */
+krompir::metrics::Gauge&
+writers_gauge()
+{
+    static auto& gauge = krompir::metrics::gauge(
+        "krompir_log_writers", "Threads with an open log writer"
+    );
+    return gauge;
+}
+
+krompir::metrics::Gauge&
+queues_gauge()
+{
+    static auto& gauge = krompir::metrics::gauge(
+        "krompir_log_queues", "Log queues left after the last consume"
+    );
+    return gauge;
+}
+
+krompir::metrics::Gauge&
+queues_consumed_gauge()
+{
+    static auto& gauge = krompir::metrics::gauge(
+        "krompir_log_queues_consumed", "Log queues the last consume went through"
+    );
+    return gauge;
+}
+
+/**
+ * Owns the writer of a thread, and releases it when the thread exits.
+ */
+class ThreadWriter {
+    std::optional<binlog::SessionWriter> writer_;
+
+public:
+    ThreadWriter() = default;
+
+    ThreadWriter(const ThreadWriter&) = delete;
+    ThreadWriter& operator=(const ThreadWriter&) = delete;
+    ThreadWriter(ThreadWriter&&) = delete;
+    ThreadWriter& operator=(ThreadWriter&&) = delete;
+
+    ~ThreadWriter()
+    {
+        release();
+    }
+
+    binlog::SessionWriter&
+    open()
+    {
+        using krompir::logging::detail::thread_writer;
+        using krompir::memory::Subsystem;
+
+        if (!writer_) {
+            const krompir::memory::AllocScope scope(Subsystem::logging);
+
+            writer_.emplace(
+                binlog::default_session(),
+                KROMPIR_LOG_QUEUE_SIZE,                   // queue capacity
+                0,                                        // writer id
+                krompir::logging::this_thread_id_string() // writer name
+            );
+
+            writers_gauge().add(1);
+        }
+
+        thread_writer = &*writer_;
+        return *writer_;
+    }
+
+    void
+    release()
+    {
+        using krompir::logging::detail::thread_writer;
+
+        if (!writer_)
+            return;
+
+        // Closes the queue, the consumer frees it once it is empty
+        thread_writer = nullptr;
+        writer_.reset();
+
+        writers_gauge().add(-1);
+    }
+};
+
+/**
+ * Get the owner of the writer of this thread.
+ */
+ThreadWriter&
+this_thread_writer()
+{
+    thread_local ThreadWriter writer;
+    return writer;
+}
+
 /**
  * Convert a binlog severity to a color code.
  *
@@ -60,8 +163,23 @@ ColoredTextOutputStream::write(const char* data, std::streamsize size)
 MultiOutputStream&
 MultiOutputStream::write(const char* data, std::streamsize size)
 {
+    static auto& bytes =
+        metrics::counter("krompir_log_bytes_total", "Bytes of binary log written");
+    static auto& latency = metrics::histogram(
+        "krompir_log_write_nanoseconds", "Time to write, index and print a log buffer"
+    );
+
+    const metrics::ScopedTimer timer(latency);
+    bytes.add(static_cast<std::uint64_t>(size));
+
     binary_.write(data, size);
 
+    try {
+        index_.write(data, size);
+    } catch (const std::runtime_error& ex) {
+        std::cerr << "Failed to index buffer: " << ex.what() << "\n";
+    }
+
     try {
         filter_.writeAllowed(data, static_cast<size_t>(size), text_);
     } catch (const std::runtime_error& ex) {
@@ -71,7 +189,39 @@ MultiOutputStream::write(const char* data, std::streamsize size)
     return *this;
 }
 
+binlog::SessionWriter&
+open_thread_writer()
+{
+    return this_thread_writer().open();
+}
+
+void
+consumed(const binlog::Session::ConsumeResult& result)
+{
+    // Closed queues are removed once drained, so whatever is left is held
+    queues_consumed_gauge().set(static_cast<std::int64_t>(result.channelsPolled));
+    queues_gauge().set(
+        static_cast<std::int64_t>(result.channelsPolled - result.channelsRemoved)
+    );
+}
+
 } // namespace detail
 
+void
+release_thread_writer()
+{
+    this_thread_writer().release();
+}
+
+QueueCounts
+queue_counts()
+{
+    const auto get = [](const metrics::Gauge& gauge) {
+        return static_cast<std::size_t>(std::max<std::int64_t>(0, gauge.value()));
+    };
+
+    return {get(writers_gauge()), get(queues_gauge()), get(queues_consumed_gauge())};
+}
+
 } // namespace logging
 } // namespace krompir
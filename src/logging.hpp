@@ -10,6 +10,8 @@
 #pragma once
 
 #include "config.h"
+#include "logging_index.hpp"
+#include "memory/alloc_tracker.hpp"
 
 // Binlog itself
 #include <binlog/binlog.hpp>
@@ -34,6 +36,7 @@
 #include <binlog/adapt_stdvariant.hpp>
 #include <binlog/default_session.hpp>
 
+#include <cstddef>
 #include <fstream>
 #include <ios>
 #include <iostream>
@@ -82,13 +85,14 @@ public:
 };
 
 /**
- * Write complete binlog output to `binary`,
+ * Write complete binlog output to `binary` and index it,
  * and also write error and above events to `text` - as text.
  *
  * https://binlog.org/UserGuide.html#multiple-output
  */
 class MultiOutputStream {
     std::ostream& binary_;
+    BlogIndexWriter index_;
     ColoredTextOutputStream text_;
     binlog::EventFilter filter_;
 
@@ -96,8 +100,14 @@ public:
     /**
      * Create a new MultiOutputStream.
      */
-    MultiOutputStream(std::ostream& binary, std::ostream& text) :
+    MultiOutputStream(
+        std::ostream& binary,
+        std::ostream& index,
+        std::ostream& meta,
+        std::ostream& text
+    ) :
         binary_(binary),
+        index_(index, meta),
         text_(text, "%S %C [%d] %n %m (%G:%L)\n"),
         filter_([](const binlog::EventSource& source) {
             return source.severity >= LOG_CONSOLE_SEVERITY;
@@ -125,39 +135,98 @@ this_thread_id_string()
     return str.str();
 }
 
+namespace detail {
+
+/// The open writer of this thread, if any
+inline thread_local binlog::SessionWriter* thread_writer = nullptr;
+
+/**
+ * Open a writer for this thread.
+ */
+binlog::SessionWriter& open_thread_writer();
+
+/**
+ * Record the queues a consume went through.
+ */
+void consumed(const binlog::Session::ConsumeResult& result);
+
+} // namespace detail
+
 /**
  * Get a thread-local writer for logging.
  *
- * This writer is used by basic log macros.
+ * This writer is used by basic log macros. It is opened on first use with a
+ * small queue, and binlog moves it to a new queue whenever one fills up
+ * before it is consumed, so threads that barely log barely use memory.
  *
- * The implementation uses a function local static,
- * avoid using the returned reference in the context
- * of global destructors.
+ * The writer is released when its thread exits, or by
+ * `release_thread_writer()`. Avoid logging from thread local or global
+ * destructors.
  *
- * Taken from binlog, licensed under Apache2.
+ * Adapted from binlog, licensed under Apache2.
  */
 inline binlog::SessionWriter&
 thread_local_writer()
 {
-    static thread_local binlog::SessionWriter writer(
-        binlog::default_session(),
-        KROMPIR_LOG_QUEUE_SIZE, // queue capacity
-        0,                      // writer id
-        this_thread_id_string() // writer name
-    );
-    return writer;
+    auto* writer = detail::thread_writer;
+    return writer != nullptr ? *writer : detail::open_thread_writer();
+}
+
+/**
+ * Release the writer of this thread.
+ *
+ * Threads that sleep for long should call this before doing so. Its queue is
+ * freed once the events in it are consumed, and the next log reopens it.
+ */
+void release_thread_writer();
+
+/**
+ * How many writers and queues threads hold.
+ *
+ * binlog creates queues on the threads that log and frees them while
+ * consuming, so they are only counted by `consume()`. It does not tell how big
+ * they are: a queue holds at least `KROMPIR_LOG_QUEUE_SIZE` bytes, and those
+ * replacing a full one are bigger.
+ */
+struct QueueCounts {
+    std::size_t writers = 0;         ///< Threads with an open writer
+    std::size_t queues = 0;          ///< Queues left after the last consume
+    std::size_t queues_consumed = 0; ///< Queues the last consume went through
+};
+
+/**
+ * Count the writers and queues of threads.
+ */
+QueueCounts queue_counts();
+
+/**
+ * Consume the events of every writer, and count their queues.
+ */
+template <typename OutputStream>
+void
+consume(OutputStream& out)
+{
+    detail::consumed(binlog::default_session().consume(out));
 }
 
 inline void
 process()
 {
+    const memory::AllocScope scope(memory::Subsystem::logging);
+
     // TODO(egelja): put the log file in an intelligent location
     static std::ofstream log_file(
         "krompir.blog", std::ofstream::out | std::ofstream::binary
     );
-    static detail::MultiOutputStream output(log_file, std::cerr);
+    static std::ofstream index_file(
+        blog_index_path("krompir.blog"), std::ofstream::out | std::ofstream::binary
+    );
+    static std::ofstream meta_file(
+        blog_meta_path("krompir.blog"), std::ofstream::out | std::ofstream::binary
+    );
+    static detail::MultiOutputStream output(log_file, index_file, meta_file, std::cerr);
 
-    binlog::consume(output);
+    consume(output);
 }
 
 } // namespace logging
@@ -0,0 +1,412 @@
+#include "logging_index.hpp"
+
+#include <binlog/EntryStream.hpp>
+#include <binlog/PrettyPrinter.hpp>
+#include <binlog/Range.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace {
+
+using krompir::logging::BlogBlock;
+
+/// Identifies an index file, and its version
+constexpr std::array<char, 8> INDEX_MAGIC = {'K', 'B', 'L', 'O', 'G', 'I', 'X', '1'};
+
+// Every binlog entry starts with its size, then its tag
+constexpr std::size_t ENTRY_SIZE_SIZE = sizeof(std::uint32_t);
+constexpr std::size_t ENTRY_TAG_SIZE = sizeof(std::uint64_t);
+
+/**
+ * Check if a tag belongs to a special (non-event) entry.
+ *
+ * Event tags are source IDs, special entries use the top of the range.
+ */
+constexpr bool
+is_special_tag(std::uint64_t tag)
+{
+    return (tag >> 63u) != 0;
+}
+
+/**
+ * Get the size of the entry at the start of `data`, including its size prefix.
+ *
+ * @returns 0 if the data does not hold a complete entry.
+ */
+std::size_t
+entry_size(const char* data, std::size_t size)
+{
+    if (size < ENTRY_SIZE_SIZE + ENTRY_TAG_SIZE)
+        return 0;
+
+    std::uint32_t payload = 0;
+    std::memcpy(&payload, data, sizeof(payload));
+
+    if (payload < ENTRY_TAG_SIZE || payload > size - ENTRY_SIZE_SIZE)
+        return 0;
+    return ENTRY_SIZE_SIZE + payload;
+}
+
+/**
+ * Get the tag of a complete entry.
+ */
+std::uint64_t
+entry_tag(const char* data)
+{
+    std::uint64_t tag = 0;
+    std::memcpy(&tag, data + ENTRY_SIZE_SIZE, sizeof(tag)); // NOLINT
+    return tag;
+}
+
+/**
+ * Feed a buffer of entries to an event stream, calling `func` for every event.
+ */
+template <typename Func>
+void
+for_each_event(
+    binlog::EventStream& stream, const char* data, std::size_t size, Func&& func
+)
+{
+    const binlog::Range range{data, data + size}; // NOLINT(*-pointer-arithmetic)
+    binlog::RangeEntryStream entries(range);
+
+    while (const binlog::Event* event = stream.nextEvent(entries))
+        func(*event);
+}
+
+} // namespace
+
+namespace krompir {
+namespace logging {
+
+std::uint64_t
+blog_category_bit(std::string_view category)
+{
+    // FNV-1a, so that indexes are portable between builds
+    constexpr std::uint64_t FNV_OFFSET = 0xcbf29ce484222325;
+    constexpr std::uint64_t FNV_PRIME = 0x100000001b3;
+
+    std::uint64_t hash = FNV_OFFSET;
+    for (const char chr : category) {
+        hash ^= static_cast<unsigned char>(chr);
+        hash *= FNV_PRIME;
+    }
+
+    return std::uint64_t{1} << (hash % 64);
+}
+
+std::int64_t
+blog_clock_to_ns(const binlog::ClockSync& sync, std::uint64_t clock)
+{
+    constexpr std::int64_t NS_PER_SEC = 1'000'000'000;
+
+    if (sync.clockFrequency == 0)
+        return static_cast<std::int64_t>(clock);
+
+    // Split up to avoid overflowing on long sessions
+    const auto delta = static_cast<std::int64_t>(clock - sync.clockValue);
+    const auto frequency = static_cast<std::int64_t>(sync.clockFrequency);
+
+    return static_cast<std::int64_t>(sync.nsSinceEpoch) + delta / frequency * NS_PER_SEC
+           + delta % frequency * NS_PER_SEC / frequency;
+}
+
+std::filesystem::path
+blog_index_path(const std::filesystem::path& blog)
+{
+    auto path = blog;
+    path += ".idx";
+    return path;
+}
+
+std::filesystem::path
+blog_meta_path(const std::filesystem::path& blog)
+{
+    auto path = blog;
+    path += ".meta";
+    return path;
+}
+
+namespace detail {
+
+BlogIndexWriter::BlogIndexWriter(std::ostream& index, std::ostream& meta) :
+    index_(index), meta_(meta)
+{
+    index_.write(INDEX_MAGIC.data(), INDEX_MAGIC.size());
+    index_.flush();
+}
+
+void
+BlogIndexWriter::scan_meta_(const char* data, std::size_t size)
+{
+    // NOLINTBEGIN(*-pointer-arithmetic)
+    for (std::size_t pos = 0; pos < size;) {
+        const auto length = entry_size(data + pos, size - pos);
+        if (length == 0)
+            break;
+
+        const auto tag = entry_tag(data + pos);
+
+        if (tag == binlog::WriterProp::Tag) {
+            // Writers are only needed at the start of blocks
+            last_writer_.assign(data + pos, length);
+        }
+        else if (is_special_tag(tag)) {
+            auto [iter, inserted] =
+                meta_entries_.try_emplace(std::string(data + pos, length), meta_size_);
+
+            if (inserted) {
+                meta_.write(iter->first.data(), static_cast<std::streamsize>(length));
+                meta_size_ += length;
+            }
+        }
+
+        pos += length;
+    }
+    // NOLINTEND(*-pointer-arithmetic)
+}
+
+void
+BlogIndexWriter::scan_events_(const char* data, std::size_t size)
+{
+    for_each_event(event_stream_, data, size, [&](const binlog::Event& event) {
+        const auto time_ns =
+            blog_clock_to_ns(event_stream_.clockSync(), event.clockValue);
+
+        if (block_.events == 0) {
+            block_.first_ns = time_ns;
+            block_.last_ns = time_ns;
+        }
+        else {
+            block_.first_ns = std::min(block_.first_ns, time_ns);
+            block_.last_ns = std::max(block_.last_ns, time_ns);
+        }
+
+        block_.severities |= static_cast<std::uint16_t>(event.source->severity);
+        block_.categories |= blog_category_bit(event.source->category);
+        ++block_.events;
+    });
+}
+
+void
+BlogIndexWriter::start_block_()
+{
+    // Blocks may start in the middle of a writer's batch, so keep its
+    // properties around to decode them on their own
+    if (!last_writer_.empty() && last_writer_ != block_writer_) {
+        writer_ = meta_size_;
+        block_writer_ = last_writer_;
+
+        meta_.write(
+            block_writer_.data(), static_cast<std::streamsize>(block_writer_.size())
+        );
+        meta_size_ += block_writer_.size();
+    }
+
+    block_ = BlogBlock{};
+    block_.offset = blog_size_;
+    block_.meta_size = meta_size_;
+    block_.writer = writer_;
+
+    ++blocks_;
+}
+
+BlogIndexWriter&
+BlogIndexWriter::write(const char* data, std::streamsize size)
+{
+    if (size <= 0)
+        return *this;
+
+    const auto length = static_cast<std::size_t>(size);
+
+    if (blocks_ == 0 || block_.size >= BLOG_BLOCK_SIZE)
+        start_block_();
+
+    block_.size += length;
+    blog_size_ += length;
+
+    scan_meta_(data, length);
+    scan_events_(data, length);
+
+    // Rewrite the record of the current block
+    const auto record = static_cast<std::streamoff>(
+        INDEX_MAGIC.size() + (blocks_ - 1) * sizeof(BlogBlock)
+    );
+
+    index_.seekp(record);
+    index_.write(
+        reinterpret_cast<const char*>(&block_), // NOLINT(*-reinterpret-cast)
+        sizeof(BlogBlock)
+    );
+
+    meta_.flush();
+    index_.flush();
+
+    return *this;
+}
+
+} // namespace detail
+
+bool
+BlogQuery::may_match(const BlogBlock& block) const
+{
+    if (block.events == 0)
+        return false;
+
+    if (from_ns && block.last_ns < *from_ns)
+        return false;
+    if (to_ns && block.first_ns > *to_ns)
+        return false;
+
+    // Severities are single bits in increasing order
+    const auto min_bit = static_cast<std::uint16_t>(min_severity);
+    if ((block.severities & ~(min_bit - 1u)) == 0)
+        return false;
+
+    if (!categories.empty()) {
+        std::uint64_t bits = 0;
+        for (const auto& category : categories)
+            bits |= blog_category_bit(category);
+
+        if ((block.categories & bits) == 0)
+            return false;
+    }
+
+    return true;
+}
+
+bool
+BlogQuery::matches(const binlog::Event& event, std::int64_t time_ns) const
+{
+    if (from_ns && time_ns < *from_ns)
+        return false;
+    if (to_ns && time_ns > *to_ns)
+        return false;
+
+    if (event.source->severity < min_severity)
+        return false;
+
+    return categories.empty()
+           || std::find(categories.begin(), categories.end(), event.source->category)
+                  != categories.end();
+}
+
+std::vector<BlogBlock>
+read_blog_index(const std::filesystem::path& blog)
+{
+    const auto path = blog_index_path(blog);
+
+    std::ifstream file(path, std::ifstream::in | std::ifstream::binary);
+    if (!file)
+        throw std::runtime_error("failed to open " + path.string());
+
+    std::array<char, INDEX_MAGIC.size()> magic{};
+    file.read(magic.data(), magic.size());
+
+    if (!file || magic != INDEX_MAGIC)
+        throw std::runtime_error(path.string() + " is not a binary log index");
+
+    std::vector<BlogBlock> blocks;
+    BlogBlock block;
+
+    // NOLINTNEXTLINE(*-reinterpret-cast)
+    while (file.read(reinterpret_cast<char*>(&block), sizeof(block)))
+        blocks.push_back(block);
+
+    return blocks;
+}
+
+BlogQueryResult
+query_blog(
+    const std::filesystem::path& blog, const BlogQuery& query, std::ostream& out
+)
+{
+    const auto blocks = read_blog_index(blog);
+
+    BlogQueryResult result;
+    result.blocks = blocks.size();
+
+    std::vector<BlogBlock> selected;
+    std::copy_if(
+        blocks.begin(),
+        blocks.end(),
+        std::back_inserter(selected),
+        [&](const BlogBlock& block) { return query.may_match(block); }
+    );
+
+    if (selected.empty())
+        return result;
+
+    std::ifstream log(blog, std::ifstream::in | std::ifstream::binary);
+    std::ifstream meta(
+        blog_meta_path(blog), std::ifstream::in | std::ifstream::binary
+    );
+
+    if (!log || !meta)
+        throw std::runtime_error("failed to open " + blog.string() + " or metadata");
+
+    // Load every source, clock and writer the selected blocks may need
+    std::uint64_t meta_size = 0;
+    for (const auto& block : selected)
+        meta_size = std::max(meta_size, block.meta_size);
+
+    std::string meta_data(meta_size, '\0');
+    meta.read(meta_data.data(), static_cast<std::streamsize>(meta_size));
+    meta_data.resize(static_cast<std::size_t>(meta.gcount()));
+
+    binlog::EventStream stream;
+    for_each_event(stream, meta_data.data(), meta_data.size(), [](const auto&) {});
+
+    result.bytes_read += meta_data.size();
+
+    // Then decode only the selected blocks
+    const auto log_size = std::filesystem::file_size(blog);
+    binlog::PrettyPrinter printer(
+        "%S %C [%d] %n %m (%G:%L)\n", "%Y-%m-%d %H:%M:%S.%N"
+    );
+    std::string buffer;
+
+    for (const auto& block : selected) {
+        if (block.offset >= log_size)
+            continue;
+
+        // The last block may have been indexed before it was flushed
+        const auto size = std::min(block.size, log_size - block.offset);
+
+        // NOLINTBEGIN(*-pointer-arithmetic)
+        if (block.writer != BLOG_NO_WRITER && block.writer < meta_data.size()) {
+            const auto* writer = meta_data.data() + block.writer;
+            const auto length = entry_size(writer, meta_data.size() - block.writer);
+
+            for_each_event(stream, writer, length, [](const auto&) {});
+        }
+        // NOLINTEND(*-pointer-arithmetic)
+
+        buffer.resize(size);
+        log.clear();
+        log.seekg(static_cast<std::streamoff>(block.offset));
+        log.read(buffer.data(), static_cast<std::streamsize>(size));
+        buffer.resize(static_cast<std::size_t>(log.gcount()));
+
+        ++result.blocks_read;
+        result.bytes_read += buffer.size();
+
+        for_each_event(stream, buffer.data(), buffer.size(), [&](const auto& event) {
+            const auto time_ns = blog_clock_to_ns(stream.clockSync(), event.clockValue);
+            if (!query.matches(event, time_ns))
+                return;
+
+            printer.printEvent(out, event, stream.writerProp(), stream.clockSync());
+            ++result.events_matched;
+        });
+    }
+
+    return result;
+}
+
+} // namespace logging
+} // namespace krompir
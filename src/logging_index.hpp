@@ -0,0 +1,199 @@
+/**
+ * @file logging_index.hpp
+ * @brief A sparse side index for the binary log, for seeking by time and severity.
+ * @copyright MIT
+ *
+ * Binlog can only be read front to back, since events refer to sources and
+ * writers defined earlier in the stream. Next to `krompir.blog` we write:
+ *
+ *  - `krompir.blog.idx`: one fixed size record per block of roughly
+ *    `BLOG_BLOCK_SIZE` bytes of log, with its time range, the severities it
+ *    contains and a bloom filter of its categories.
+ *  - `krompir.blog.meta`: every distinct source, writer and clock entry of
+ *    the log, so that a block can be decoded without reading what precedes it.
+ *
+ * Both files are written in native byte order, like the log itself.
+ */
+#pragma once
+
+#include <binlog/Entries.hpp>
+#include <binlog/EventStream.hpp>
+#include <binlog/Severity.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <ios>
+#include <limits>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace krompir {
+namespace logging {
+
+/**
+ * Target size of an indexed block of the binary log, in bytes.
+ */
+constexpr std::uint64_t BLOG_BLOCK_SIZE = 64u << 10u;
+
+/**
+ * Marks a block that starts without an active writer.
+ */
+constexpr std::uint64_t BLOG_NO_WRITER = std::numeric_limits<std::uint64_t>::max();
+
+/**
+ * An index record describing one block of the binary log.
+ */
+struct BlogBlock {
+    std::uint64_t offset = 0;     ///< Offset of the block in the log
+    std::uint64_t size = 0;       ///< Size of the block in the log
+    std::int64_t first_ns = 0;    ///< Earliest event, nanoseconds since epoch
+    std::int64_t last_ns = 0;     ///< Latest event, nanoseconds since epoch
+    std::uint64_t categories = 0; ///< Bloom filter of event categories
+    std::uint64_t meta_size = 0;  ///< Size of the metadata file when the block began
+    std::uint64_t writer = BLOG_NO_WRITER; ///< Metadata offset of the active writer
+    std::uint32_t events = 0;              ///< Number of events in the block
+    std::uint16_t severities = 0;          ///< Bitwise or of the event severities
+    std::uint16_t reserved = 0;
+};
+
+static_assert(sizeof(BlogBlock) == 64, "index records are written as-is");
+
+/**
+ * Get the bloom filter bit of a category.
+ */
+std::uint64_t blog_category_bit(std::string_view category);
+
+/**
+ * Convert a binlog clock value to nanoseconds since the epoch.
+ */
+std::int64_t blog_clock_to_ns(const binlog::ClockSync& sync, std::uint64_t clock);
+
+/**
+ * Get the path of the index of a binary log.
+ */
+std::filesystem::path blog_index_path(const std::filesystem::path& blog);
+
+/**
+ * Get the path of the metadata file of a binary log.
+ */
+std::filesystem::path blog_meta_path(const std::filesystem::path& blog);
+
+namespace detail {
+
+/**
+ * Builds the index and metadata files as the binary log is written.
+ *
+ * The record of the block being filled is rewritten after every write, so the
+ * index is complete even if the application dies.
+ */
+class BlogIndexWriter {
+    std::ostream& index_;
+    std::ostream& meta_;
+
+    binlog::EventStream event_stream_;
+
+    std::uint64_t blog_size_ = 0;
+    std::uint64_t meta_size_ = 0;
+
+    /// Metadata entries already written, by their raw bytes
+    std::unordered_map<std::string, std::uint64_t> meta_entries_;
+
+    /// The last writer properties seen in the log
+    std::string last_writer_;
+    /// The last writer properties written to the metadata, and where
+    std::string block_writer_;
+    std::uint64_t writer_ = BLOG_NO_WRITER;
+
+    BlogBlock block_;
+    std::uint64_t blocks_ = 0;
+
+    /**
+     * Start a new block at the end of the log.
+     */
+    void start_block_();
+
+    /**
+     * Copy the metadata entries of a buffer to the metadata file.
+     */
+    void scan_meta_(const char* data, std::size_t size);
+
+    /**
+     * Add the events of a buffer to the current block.
+     */
+    void scan_events_(const char* data, std::size_t size);
+
+public:
+    /**
+     * Create a new index writer.
+     *
+     * Both streams must be binary and empty.
+     */
+    BlogIndexWriter(std::ostream& index, std::ostream& meta);
+
+    /**
+     * Index data that was just appended to the binary log.
+     */
+    BlogIndexWriter& write(const char* data, std::streamsize size);
+};
+
+} // namespace detail
+
+/**
+ * Which events to extract from a binary log.
+ */
+struct BlogQuery {
+    std::optional<std::int64_t> from_ns; ///< Earliest event, inclusive
+    std::optional<std::int64_t> to_ns;   ///< Latest event, inclusive
+    binlog::Severity min_severity = binlog::Severity::trace;
+    std::vector<std::string> categories; ///< Any category if empty
+
+    /**
+     * Check if a block might contain matching events.
+     */
+    [[nodiscard]] bool may_match(const BlogBlock& block) const;
+
+    /**
+     * Check if an event matches.
+     */
+    [[nodiscard]] bool matches(const binlog::Event& event, std::int64_t time_ns) const;
+};
+
+/**
+ * Statistics about a query.
+ */
+struct BlogQueryResult {
+    std::size_t blocks = 0;         ///< Blocks in the index
+    std::size_t blocks_read = 0;    ///< Blocks that had to be decoded
+    std::uint64_t bytes_read = 0;   ///< Bytes of log and metadata decoded
+    std::size_t events_matched = 0; ///< Events printed
+};
+
+/**
+ * Read the index of a binary log.
+ *
+ * @throws std::runtime_error if the index is missing or invalid.
+ */
+std::vector<BlogBlock> read_blog_index(const std::filesystem::path& blog);
+
+/**
+ * Print the events of an indexed binary log that match a query.
+ *
+ * Only the metadata and the blocks that may match are read from disk.
+ *
+ * @param blog The binary log, with its index and metadata files next to it.
+ * @param query The events to print.
+ * @param out Where to print the events, formatted like the console output.
+ *
+ * @throws std::runtime_error if the files are missing or invalid.
+ */
+BlogQueryResult query_blog(
+    const std::filesystem::path& blog, const BlogQuery& query, std::ostream& out
+);
+
+} // namespace logging
+} // namespace krompir
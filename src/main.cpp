@@ -1,15 +1,63 @@
+#include "analyze/log_analyzer.hpp"
+#include "catalog/catalog.hpp"
 #include "common.hpp"
+#include "configs/bulk_edit.hpp"
 #include "gui/gui.hpp"
+#include "metrics/metrics.hpp"
+#include "packs/pack_diff.hpp"
+#include "packs/verify.hpp"
+#include "world/world_scan.hpp"
 
 #include <argparse/argparse.hpp>
 #include <binlog/default_session.hpp>
 
+#include <chrono>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <optional>
+#include <string>
+#include <system_error>
+#include <vector>
 
 namespace {
 
 struct arguments_t {
     size_t verbosity;
+
+    // Log analyzer
+    std::vector<std::filesystem::path> analyze_logs;
+    std::optional<std::filesystem::path> class_index;
+    size_t top;
+
+    // World audit
+    std::optional<std::filesystem::path> scan_world;
+
+    // Config editing
+    std::optional<std::filesystem::path> config_profile;
+    std::vector<std::filesystem::path> packs;
+    bool dry_run;
+
+    // Pack diff
+    std::vector<std::filesystem::path> diff_packs;
+    std::string diff_format;
+    std::optional<std::filesystem::path> pack_cache;
+
+    // Instance verification
+    std::optional<std::filesystem::path> verify;
+    std::optional<std::filesystem::path> manifest;
+    bool write_manifest;
+    krompir::packs::ReadBackend read_backend;
+
+    // Mod catalog
+    std::optional<std::filesystem::path> catalog;
+    std::optional<std::filesystem::path> catalog_import;
+    std::optional<std::filesystem::path> catalog_delta;
+    krompir::catalog::CatalogQuery catalog_query;
+
+    // Metrics
+    std::optional<std::filesystem::path> metrics_file;
+    size_t metrics_interval;
 };
 
 arguments_t
@@ -39,6 +87,135 @@ parse_arguments(int argc, char* argv[]) // NOLINT(*-avoid-c-arrays)
         .implicit_value(true)
         .nargs(0);
 
+    program.add_argument("--analyze-log")
+        .help("rank the mods most likely to have caused a crash, without the GUI")
+        .action([&](const std::string& path) { args.analyze_logs.emplace_back(path); })
+        .append()
+        .metavar("FILE");
+
+    program.add_argument("--class-index")
+        .help("file mapping classes, JARs and mixin configs to mod IDs")
+        .action([&](const std::string& path) { args.class_index = path; })
+        .metavar("FILE");
+
+    program.add_argument("--top")
+        .help("number of suspects or projects to print with --analyze-log or --catalog")
+        .default_value(size_t{20})
+        .scan<'u', size_t>()
+        .metavar("N");
+
+    program.add_argument("--scan-world")
+        .help("count the blocks, entities and items of each mod used by a world")
+        .action([&](const std::string& path) { args.scan_world = path; })
+        .metavar("DIR");
+
+    program.add_argument("--config-profile")
+        .help("apply the config edits in this file to every --pack")
+        .action([&](const std::string& path) { args.config_profile = path; })
+        .metavar("FILE");
+
+    program.add_argument("--pack")
+        .help("pack or instance directory edited by --config-profile")
+        .action([&](const std::string& path) { args.packs.emplace_back(path); })
+        .append()
+        .metavar("DIR");
+
+    program.add_argument("--dry-run")
+        .help("report what --config-profile would change without writing anything")
+        .default_value(false)
+        .implicit_value(true)
+        .nargs(0);
+
+    program.add_argument("--diff-packs")
+        .help("write release notes for changes between two pack folders or lockfiles")
+        .nargs(2)
+        .metavar("OLD NEW");
+
+    program.add_argument("--diff-format")
+        .help("format of --diff-packs: markdown or json")
+        .default_value(std::string("markdown"))
+        .metavar("FORMAT");
+
+    program.add_argument("--pack-cache")
+        .help("file keeping file hashes between runs of --diff-packs or --verify")
+        .action([&](const std::string& path) { args.pack_cache = path; })
+        .metavar("FILE");
+
+    program.add_argument("--verify")
+        .help("check the files of an instance against its --manifest")
+        .action([&](const std::string& path) { args.verify = path; })
+        .metavar("DIR");
+
+    program.add_argument("--manifest")
+        .help("file listing the size and hash of every file of the --verify instance")
+        .action([&](const std::string& path) { args.manifest = path; })
+        .metavar("FILE");
+
+    program.add_argument("--write-manifest")
+        .help("write the --manifest of the --verify instance instead of checking it")
+        .default_value(false)
+        .implicit_value(true)
+        .nargs(0);
+
+    program.add_argument("--read-backend")
+        .help("how --verify reads files: auto, io_uring or blocking")
+        .default_value(std::string("auto"))
+        .metavar("BACKEND");
+
+    program.add_argument("--catalog")
+        .help("search this offline snapshot of the Modrinth and CurseForge catalogs")
+        .action([&](const std::string& path) { args.catalog = path; })
+        .metavar("FILE");
+
+    program.add_argument("--catalog-import")
+        .help("build the --catalog snapshot from a dump of the catalogs")
+        .action([&](const std::string& path) { args.catalog_import = path; })
+        .metavar("DUMP");
+
+    program.add_argument("--catalog-delta")
+        .help("apply a dump of changed projects to the --catalog snapshot")
+        .action([&](const std::string& path) { args.catalog_delta = path; })
+        .metavar("DUMP");
+
+    program.add_argument("--loader")
+        .help("only find projects for this loader with --catalog")
+        .action([&](const std::string& value) { args.catalog_query.loader = value; })
+        .metavar("LOADER");
+
+    program.add_argument("--game-version")
+        .help("only find projects for this game version with --catalog")
+        .action([&](const std::string& value) {
+            args.catalog_query.game_version = value;
+        })
+        .metavar("VERSION");
+
+    program.add_argument("--category")
+        .help("only find projects in this category with --catalog")
+        .action([&](const std::string& value) { args.catalog_query.category = value; })
+        .metavar("CATEGORY");
+
+    program.add_argument("--search")
+        .help("only find projects with this text in their slug or title with --catalog")
+        .action([&](const std::string& value) { args.catalog_query.text = value; })
+        .metavar("TEXT");
+
+    program.add_argument("--min-downloads")
+        .help("only find projects downloaded at least this many times with --catalog")
+        .default_value(size_t{0})
+        .scan<'u', size_t>()
+        .metavar("N");
+
+    program.add_argument("--metrics")
+        .help("periodically write metrics to this file, in the Prometheus text format")
+        .action([&](const std::string& path) { args.metrics_file = path; })
+        .metavar("FILE");
+
+    program.add_argument("--metrics-interval")
+        .help("seconds between writes of the --metrics file")
+        .default_value(size_t{10})
+        .scan<'u', size_t>()
+        .metavar("SECONDS");
+
     // Run parsing
     try {
         program.parse_args(argc, argv);
@@ -48,9 +225,415 @@ parse_arguments(int argc, char* argv[]) // NOLINT(*-avoid-c-arrays)
         exit(1); // NOLINT(concurrency-*)
     }
 
+    args.top = program.get<size_t>("--top");
+    args.dry_run = program.get<bool>("--dry-run");
+    args.write_manifest = program.get<bool>("--write-manifest");
+    args.diff_format = program.get<std::string>("--diff-format");
+    args.metrics_interval = program.get<size_t>("--metrics-interval");
+    args.catalog_query.min_downloads = program.get<size_t>("--min-downloads");
+    args.catalog_query.limit = args.top;
+
+    if (const auto packs = program.present<std::vector<std::string>>("--diff-packs"))
+        args.diff_packs.assign(packs->begin(), packs->end());
+
+    if (args.diff_format != "markdown" && args.diff_format != "json") {
+        std::cerr << "--diff-format must be markdown or json" << std::endl;
+        exit(1); // NOLINT(concurrency-*)
+    }
+
+    const auto read_backend = program.get<std::string>("--read-backend");
+    if (read_backend == "io_uring") {
+        args.read_backend = krompir::packs::ReadBackend::io_uring;
+    }
+    else if (read_backend == "blocking") {
+        args.read_backend = krompir::packs::ReadBackend::blocking;
+    }
+    else if (read_backend != "auto") {
+        std::cerr << "--read-backend must be auto, io_uring or blocking" << std::endl;
+        exit(1); // NOLINT(concurrency-*)
+    }
+
+    if (args.metrics_interval == 0) {
+        std::cerr << "--metrics-interval must be at least 1" << std::endl;
+        exit(1); // NOLINT(concurrency-*)
+    }
+
+    if (args.verify && !args.manifest) {
+        std::cerr << "--verify needs --manifest" << std::endl;
+        exit(1); // NOLINT(concurrency-*)
+    }
+
+    if ((args.catalog_import || args.catalog_delta) && !args.catalog) {
+        std::cerr << "--catalog-import and --catalog-delta need --catalog" << std::endl;
+        exit(1); // NOLINT(concurrency-*)
+    }
+
     return args;
 }
 
+/**
+ * Analyze logs from the command line and print the suspects.
+ */
+int
+run_log_analyzer(const arguments_t& args)
+{
+    krompir::analyze::ClassIndex index;
+    krompir::analyze::Analysis result;
+
+    try {
+        if (args.class_index)
+            index = krompir::analyze::ClassIndex::load(*args.class_index);
+
+        result = krompir::analyze::analyze_files(args.analyze_logs, index);
+    } catch (const std::system_error& err) {
+        std::cerr << err.what() << std::endl;
+        krompir::logging::process();
+        return 1;
+    }
+
+    fmt::print(
+        "Scanned {} lines ({:.1f} MiB) from {} files\n\n",
+        result.lines,
+        static_cast<double>(result.bytes) / (1u << 20u),
+        args.analyze_logs.size()
+    );
+
+    fmt::print(
+        "{:>4}  {:<40} {:>8} {:>7} {:>7} {:>8}\n",
+        "#",
+        "Mod",
+        "Score",
+        "Frames",
+        "Mixins",
+        "Mentions"
+    );
+
+    for (size_t idx = 0; idx < result.suspects.size() && idx < args.top; ++idx) {
+        const auto& suspect = result.suspects[idx];
+
+        fmt::print(
+            "{:>4}  {:<40} {:>8.1f} {:>7} {:>7} {:>8}\n",
+            idx + 1,
+            suspect.mod,
+            suspect.score,
+            suspect.frames,
+            suspect.mixins,
+            suspect.mentions
+        );
+    }
+
+    krompir::logging::process();
+    return 0;
+}
+
+/**
+ * Audit a world from the command line and print the namespaces it uses.
+ */
+int
+run_world_scan(const arguments_t& args)
+{
+    krompir::world::WorldUsage usage;
+
+    try {
+        usage = krompir::world::scan_world(*args.scan_world);
+    } catch (const std::filesystem::filesystem_error& err) {
+        std::cerr << err.what() << std::endl;
+        krompir::logging::process();
+        return 1;
+    }
+
+    fmt::print(
+        "Scanned {} chunks in {} regions ({:.1f} MiB), {} skipped\n\n",
+        usage.chunks,
+        usage.regions,
+        static_cast<double>(usage.bytes) / (1u << 20u),
+        usage.chunks_skipped
+    );
+
+    fmt::print(
+        "{:<32} {:>10} {:>13} {:>10} {:>10} {:>10}\n",
+        "Namespace",
+        "Blocks",
+        "Block ents",
+        "Entities",
+        "Items",
+        "Other"
+    );
+
+    using krompir::world::UsageKind;
+
+    for (const auto& [name, counts] : usage.namespaces) {
+        fmt::print(
+            "{:<32} {:>10} {:>13} {:>10} {:>10} {:>10}\n",
+            name,
+            counts[UsageKind::block],
+            counts[UsageKind::block_entity],
+            counts[UsageKind::entity],
+            counts[UsageKind::item],
+            counts[UsageKind::other]
+        );
+    }
+
+    krompir::logging::process();
+    return 0;
+}
+
+/**
+ * Apply a config profile from the command line and print what changed.
+ */
+int
+run_config_edit(const arguments_t& args)
+{
+    krompir::configs::ConfigCache cache;
+    krompir::configs::EditProfile profile;
+    krompir::configs::EditReport report;
+
+    try {
+        profile = krompir::configs::EditProfile::load(*args.config_profile);
+        report = krompir::configs::apply_profile(
+            args.packs, profile, cache, {.dry_run = args.dry_run}
+        );
+    } catch (const std::system_error& err) {
+        std::cerr << err.what() << std::endl;
+        krompir::logging::process();
+        return 1;
+    } catch (const krompir::configs::ConfigError& err) {
+        std::cerr << *args.config_profile << ": " << err.what() << std::endl;
+        krompir::logging::process();
+        return 1;
+    }
+
+    fmt::print(
+        "{} {} values in {} of {} matched files ({} config files)\n",
+        args.dry_run ? "Would change" : "Changed",
+        report.values_changed,
+        report.files_changed,
+        report.files_matched,
+        report.files
+    );
+
+    for (const auto idx : report.unused_edits) {
+        const auto& edit = profile.edits[idx];
+        fmt::print("No {} found in {}\n", edit.key, edit.files);
+    }
+
+    for (const auto& failure : report.failures)
+        std::cerr << failure.file.string() << ": " << failure.error << std::endl;
+
+    krompir::logging::process();
+    return report.failures.empty() ? 0 : 1;
+}
+
+/**
+ * Compare two versions of a pack from the command line and print the changes.
+ */
+int
+run_pack_diff(const arguments_t& args)
+{
+    krompir::packs::PackCache cache;
+    krompir::packs::PackCacheStats stats;
+
+    // A missing or stale cache only makes this slower
+    if (args.pack_cache && std::filesystem::exists(*args.pack_cache)) {
+        try {
+            std::ifstream file(*args.pack_cache);
+            cache.read(file);
+        } catch (const krompir::packs::PackError& err) {
+            log_w(packs, "Ignoring pack cache {}: {}", *args.pack_cache, err.what());
+        }
+    }
+
+    krompir::packs::PackDiff diff;
+
+    try {
+        const auto from = krompir::packs::load_pack(args.diff_packs[0], cache, stats);
+        const auto to = krompir::packs::load_pack(args.diff_packs[1], cache, stats);
+
+        diff = krompir::packs::diff_packs(from, to);
+    } catch (const std::system_error& err) {
+        std::cerr << err.what() << std::endl;
+        krompir::logging::process();
+        return 1;
+    } catch (const krompir::packs::PackError& err) {
+        std::cerr << err.what() << std::endl;
+        krompir::logging::process();
+        return 1;
+    }
+
+    if (args.diff_format == "json")
+        krompir::packs::write_json(diff, std::cout);
+    else
+        krompir::packs::write_markdown(diff, std::cout);
+
+    if (args.pack_cache) {
+        std::ofstream file(*args.pack_cache, std::ofstream::out | std::ofstream::trunc);
+        cache.write(file);
+    }
+
+    krompir::logging::process();
+    return 0;
+}
+
+/**
+ * Check an instance against its manifest from the command line, or write it.
+ */
+int
+run_verify(const arguments_t& args)
+{
+    krompir::packs::PackCache cache;
+
+    // A missing or stale cache only makes this slower
+    if (args.pack_cache && std::filesystem::exists(*args.pack_cache)) {
+        try {
+            std::ifstream file(*args.pack_cache);
+            cache.read(file);
+        } catch (const krompir::packs::PackError& err) {
+            log_w(packs, "Ignoring pack cache {}: {}", *args.pack_cache, err.what());
+        }
+    }
+
+    int status = 0;
+
+    try {
+        if (args.write_manifest) {
+            krompir::packs::HashStats stats;
+            const auto manifest = krompir::packs::build_manifest(
+                *args.verify, cache, stats, 0, args.read_backend
+            );
+
+            std::ofstream file(
+                *args.manifest, std::ofstream::out | std::ofstream::trunc
+            );
+            krompir::packs::write_manifest(manifest, file);
+
+            fmt::print(
+                "Wrote {} files to {}\n", manifest.files.size(), args.manifest->string()
+            );
+        }
+        else {
+            std::ifstream file(*args.manifest);
+            if (!file) {
+                throw std::system_error(
+                    std::make_error_code(std::errc::no_such_file_or_directory),
+                    args.manifest->string()
+                );
+            }
+
+            const auto report = krompir::packs::verify_instance(
+                *args.verify,
+                krompir::packs::read_manifest(file),
+                cache,
+                0,
+                args.read_backend
+            );
+
+            for (const auto& path : report.missing)
+                fmt::print("missing  {}\n", path);
+            for (const auto& path : report.corrupt)
+                fmt::print("corrupt  {}\n", path);
+            for (const auto& path : report.extra)
+                fmt::print("extra    {}\n", path);
+
+            fmt::print(
+                "{} intact, {} missing, {} corrupt and {} extra files\n",
+                report.intact,
+                report.missing.size(),
+                report.corrupt.size(),
+                report.extra.size()
+            );
+            status = report.ok() ? 0 : 1;
+        }
+    } catch (const std::system_error& err) {
+        std::cerr << err.what() << std::endl;
+        krompir::logging::process();
+        return 1;
+    } catch (const krompir::packs::PackError& err) {
+        std::cerr << err.what() << std::endl;
+        krompir::logging::process();
+        return 1;
+    }
+
+    if (args.pack_cache) {
+        std::ofstream file(*args.pack_cache, std::ofstream::out | std::ofstream::trunc);
+        cache.write(file);
+    }
+
+    krompir::logging::process();
+    return status;
+}
+
+/**
+ * Build, refresh or search the catalog snapshot from the command line.
+ */
+int
+run_catalog(const arguments_t& args)
+{
+    const auto& path = *args.catalog;
+
+    try {
+        if (args.catalog_import) {
+            const auto dump = krompir::catalog::read_dump(*args.catalog_import);
+            krompir::catalog::write_catalog(dump.projects, path);
+
+            fmt::print("Imported {} projects\n", dump.projects.size());
+        }
+
+        if (args.catalog_delta) {
+            auto next = path;
+            next += ".new";
+
+            // Keep the mapping of the old snapshot out of the way of the rename
+            krompir::catalog::RefreshStats stats;
+            {
+                const krompir::catalog::Catalog catalog(path);
+                stats = krompir::catalog::refresh_catalog(
+                    catalog, krompir::catalog::read_dump(*args.catalog_delta), next
+                );
+            }
+            std::filesystem::rename(next, path);
+
+            fmt::print(
+                "Added {}, updated {} and removed {} projects\n",
+                stats.added,
+                stats.updated,
+                stats.removed
+            );
+        }
+
+        if (args.catalog_import || args.catalog_delta) {
+            krompir::logging::process();
+            return 0;
+        }
+
+        const krompir::catalog::Catalog catalog(path);
+        const auto result = catalog.query(args.catalog_query);
+
+        for (const auto& project : result.projects) {
+            fmt::print(
+                "{:>12}  {:<10}  {}  {}\n",
+                project.downloads,
+                krompir::catalog::source_name(project.source),
+                project.slug,
+                project.title
+            );
+        }
+        fmt::print(
+            "{} of {} matching projects\n", result.projects.size(), result.matches
+        );
+    } catch (const std::system_error& err) {
+        std::cerr << err.what() << std::endl;
+        krompir::logging::process();
+        return 1;
+    } catch (const krompir::catalog::CatalogError& err) {
+        std::cerr << err.what() << std::endl;
+        krompir::logging::process();
+        return 1;
+    }
+
+    krompir::logging::process();
+    return 0;
+}
+
 } // namespace
 
 int
@@ -69,6 +652,30 @@ main(int argc, char* argv[])
 
     binlog::default_session().setMinSeverity(log_level);
 
+    // Export metrics until we exit
+    std::optional<krompir::metrics::PeriodicExporter> exporter;
+    if (args.metrics_file) {
+        exporter.emplace(
+            krompir::metrics::Registry::global(),
+            *args.metrics_file,
+            std::chrono::seconds(args.metrics_interval)
+        );
+    }
+
+    // Command line tools
+    if (!args.analyze_logs.empty())
+        return run_log_analyzer(args);
+    if (args.scan_world)
+        return run_world_scan(args);
+    if (args.config_profile)
+        return run_config_edit(args);
+    if (!args.diff_packs.empty())
+        return run_pack_diff(args);
+    if (args.verify)
+        return run_verify(args);
+    if (args.catalog)
+        return run_catalog(args);
+
     // Transfer control to GUI
     return krompir::gui::main(argc, argv);
 }
@@ -0,0 +1,523 @@
+#include "alloc_tracker.hpp"
+
+#include "logging.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#if TRACK_ALLOCATIONS()
+namespace {
+
+using krompir::memory::AllocStats;
+using krompir::memory::Subsystem;
+using krompir::memory::SUBSYSTEMS;
+
+/**
+ * The counters of one thread, for one subsystem.
+ *
+ * Only the owning thread updates them, so a relaxed load and store is enough
+ * and avoids a locked instruction per allocation. Snapshots read them racily,
+ * which is fine for statistics.
+ */
+struct SubsystemCounters {
+    std::atomic<std::uint64_t> allocations;
+    std::atomic<std::uint64_t> frees;
+    std::atomic<std::uint64_t> bytes_allocated;
+    std::atomic<std::uint64_t> bytes_freed;
+};
+
+/**
+ * The counters of one thread, on their own cache lines.
+ */
+struct alignas(64) ThreadCounters {
+    std::array<SubsystemCounters, SUBSYSTEMS> subsystems;
+    std::atomic<bool> in_use;
+};
+
+/// Threads beyond this share the overflow counters
+constexpr std::size_t MAX_THREADS = 256;
+
+// Zero-initialized before any allocation can happen
+constinit std::array<ThreadCounters, MAX_THREADS> thread_counters{};
+constinit ThreadCounters overflow_counters{};
+
+/// Live bytes of every subsystem, updated in batches to find the peaks
+constinit std::array<std::atomic<std::int64_t>, SUBSYSTEMS + 1> live_bytes{};
+constinit std::array<std::atomic<std::int64_t>, SUBSYSTEMS + 1> peak_bytes{};
+
+/// How far a thread's live bytes may drift before they are published
+constexpr std::int64_t LIVE_BATCH = 64 << 10;
+
+/**
+ * Add to a counter only updated by its owning thread.
+ */
+inline void
+bump(std::atomic<std::uint64_t>& counter, std::uint64_t value, bool shared)
+{
+    if (shared)
+        counter.fetch_add(value, std::memory_order_relaxed);
+    else
+        counter.store(
+            counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed
+        );
+}
+
+/**
+ * Publish a change in live bytes, and raise the peak if needed.
+ */
+void
+publish_live(std::size_t index, std::int64_t delta)
+{
+    const auto live =
+        live_bytes.at(index).fetch_add(delta, std::memory_order_relaxed) + delta;
+
+    auto& peak = peak_bytes.at(index);
+    auto previous = peak.load(std::memory_order_relaxed);
+
+    while (live > previous
+           && !peak.compare_exchange_weak(previous, live, std::memory_order_relaxed)) {
+    }
+}
+
+/**
+ * The counters of the current thread.
+ *
+ * Claims a slot on first use and gives it back when the thread exits. The
+ * counts stay in the slot, so they are never lost.
+ */
+class ThreadState {
+    ThreadCounters* counters_ = nullptr;
+    std::array<std::int64_t, SUBSYSTEMS + 1> pending_{};
+
+public:
+    constexpr ThreadState() = default;
+
+    ThreadState(const ThreadState&) = delete;
+    ThreadState& operator=(const ThreadState&) = delete;
+    ThreadState(ThreadState&&) = delete;
+    ThreadState& operator=(ThreadState&&) = delete;
+
+    ~ThreadState()
+    {
+        for (std::size_t i = 0; i < pending_.size(); ++i) {
+            if (pending_.at(i) != 0)
+                publish_live(i, pending_.at(i));
+        }
+
+        if (counters_ != nullptr && counters_ != &overflow_counters)
+            counters_->in_use.store(false, std::memory_order_release);
+
+        // Later thread_local destructors may still free memory
+        counters_ = &overflow_counters;
+        pending_ = {};
+    }
+
+    ThreadCounters&
+    counters()
+    {
+        if (counters_ != nullptr)
+            return *counters_;
+
+        counters_ = &overflow_counters;
+        for (auto& slot : thread_counters) {
+            if (!slot.in_use.exchange(true, std::memory_order_acquire)) {
+                counters_ = &slot;
+                break;
+            }
+        }
+
+        return *counters_;
+    }
+
+    [[nodiscard]] bool
+    shared() const
+    {
+        return counters_ == &overflow_counters;
+    }
+
+    void
+    add_live(Subsystem subsystem, std::int64_t delta)
+    {
+        for (const auto index : {static_cast<std::size_t>(subsystem), SUBSYSTEMS}) {
+            auto& pending = pending_.at(index);
+            pending += delta;
+
+            if (pending >= LIVE_BATCH || pending <= -LIVE_BATCH) {
+                publish_live(index, pending);
+                pending = 0;
+            }
+        }
+    }
+};
+
+thread_local ThreadState thread_state;
+constinit thread_local Subsystem current_subsystem = Subsystem::other;
+
+/**
+ * Stored in front of every tracked allocation.
+ */
+struct alignas(16) Header {
+    std::size_t size;
+    std::uint32_t offset; ///< From the start of the malloc'd block
+    Subsystem subsystem;
+};
+
+static_assert(sizeof(Header) == 16, "headers must keep malloc's alignment");
+static_assert(alignof(std::max_align_t) <= sizeof(Header));
+
+void
+record_allocation(Header& header)
+{
+    auto& counters = thread_state.counters();
+    auto& subsystem =
+        counters.subsystems.at(static_cast<std::size_t>(header.subsystem));
+    const bool shared = thread_state.shared();
+
+    bump(subsystem.allocations, 1, shared);
+    bump(subsystem.bytes_allocated, header.size, shared);
+
+    thread_state.add_live(header.subsystem, static_cast<std::int64_t>(header.size));
+}
+
+void
+record_free(const Header& header)
+{
+    auto& counters = thread_state.counters();
+    auto& subsystem =
+        counters.subsystems.at(static_cast<std::size_t>(header.subsystem));
+    const bool shared = thread_state.shared();
+
+    bump(subsystem.frees, 1, shared);
+    bump(subsystem.bytes_freed, header.size, shared);
+
+    thread_state.add_live(header.subsystem, -static_cast<std::int64_t>(header.size));
+}
+
+/**
+ * Allocate and record a block, or return null.
+ */
+void*
+tracked_malloc(std::size_t size, std::size_t alignment) noexcept
+{
+    // NOLINTBEGIN(*-pointer-arithmetic,*-reinterpret-cast,*-no-malloc,*-owning-memory)
+    alignment = std::max(alignment, sizeof(Header));
+
+    const std::size_t padding = alignment - sizeof(Header);
+    if (size > SIZE_MAX - sizeof(Header) - padding)
+        return nullptr;
+
+    auto* block = static_cast<char*>(std::malloc(size + sizeof(Header) + padding));
+    if (block == nullptr)
+        return nullptr;
+
+    const auto address = reinterpret_cast<std::uintptr_t>(block + sizeof(Header));
+    auto* data = block + sizeof(Header) + (-address & (alignment - 1));
+
+    auto* header = new (data - sizeof(Header)) Header{
+        size, static_cast<std::uint32_t>(data - block), current_subsystem
+    };
+    record_allocation(*header);
+
+    return data;
+    // NOLINTEND(*-pointer-arithmetic,*-reinterpret-cast,*-no-malloc,*-owning-memory)
+}
+
+/**
+ * Allocate and record a block, following the rules of `operator new`.
+ */
+void*
+tracked_new(std::size_t size, std::size_t alignment)
+{
+    if (size == 0)
+        size = 1;
+
+    while (true) {
+        if (void* data = tracked_malloc(size, alignment))
+            return data;
+
+        const auto handler = std::get_new_handler();
+        if (handler == nullptr)
+            throw std::bad_alloc();
+
+        handler();
+    }
+}
+
+void*
+tracked_new(
+    std::size_t size, std::size_t alignment, const std::nothrow_t& /* unused */
+) noexcept
+{
+    try {
+        return tracked_new(size, alignment);
+    } catch (const std::bad_alloc&) {
+        return nullptr;
+    }
+}
+
+void
+tracked_delete(void* data) noexcept
+{
+    // NOLINTBEGIN(*-pointer-arithmetic,*-no-malloc,*-owning-memory)
+    if (data == nullptr)
+        return;
+
+    const auto* header = static_cast<const Header*>(data) - 1;
+    record_free(*header);
+
+    std::free(static_cast<char*>(data) - header->offset);
+    // NOLINTEND(*-pointer-arithmetic,*-no-malloc,*-owning-memory)
+}
+
+} // namespace
+
+// Replacements of every global allocation function
+// NOLINTBEGIN(*-new-delete-operators,*-exception-escape)
+void*
+operator new(std::size_t size)
+{
+    return tracked_new(size, alignof(std::max_align_t));
+}
+
+void*
+operator new[](std::size_t size)
+{
+    return tracked_new(size, alignof(std::max_align_t));
+}
+
+void*
+operator new(std::size_t size, std::align_val_t align)
+{
+    return tracked_new(size, static_cast<std::size_t>(align));
+}
+
+void*
+operator new[](std::size_t size, std::align_val_t align)
+{
+    return tracked_new(size, static_cast<std::size_t>(align));
+}
+
+void*
+operator new(std::size_t size, const std::nothrow_t& tag) noexcept
+{
+    return tracked_new(size, alignof(std::max_align_t), tag);
+}
+
+void*
+operator new[](std::size_t size, const std::nothrow_t& tag) noexcept
+{
+    return tracked_new(size, alignof(std::max_align_t), tag);
+}
+
+void*
+operator new(
+    std::size_t size, std::align_val_t align, const std::nothrow_t& tag
+) noexcept
+{
+    return tracked_new(size, static_cast<std::size_t>(align), tag);
+}
+
+void*
+operator new[](
+    std::size_t size, std::align_val_t align, const std::nothrow_t& tag
+) noexcept
+{
+    return tracked_new(size, static_cast<std::size_t>(align), tag);
+}
+
+void
+operator delete(void* data) noexcept
+{
+    tracked_delete(data);
+}
+
+void
+operator delete[](void* data) noexcept
+{
+    tracked_delete(data);
+}
+
+void
+operator delete(void* data, std::size_t /* unused */) noexcept
+{
+    tracked_delete(data);
+}
+
+void
+operator delete[](void* data, std::size_t /* unused */) noexcept
+{
+    tracked_delete(data);
+}
+
+void
+operator delete(void* data, std::align_val_t /* unused */) noexcept
+{
+    tracked_delete(data);
+}
+
+void
+operator delete[](void* data, std::align_val_t /* unused */) noexcept
+{
+    tracked_delete(data);
+}
+
+void
+operator delete(void* data, std::size_t /* unused */, std::align_val_t /* unused */)
+    noexcept
+{
+    tracked_delete(data);
+}
+
+void
+operator delete[](void* data, std::size_t /* unused */, std::align_val_t /* unused */)
+    noexcept
+{
+    tracked_delete(data);
+}
+
+void
+operator delete(void* data, const std::nothrow_t& /* unused */) noexcept
+{
+    tracked_delete(data);
+}
+
+void
+operator delete[](void* data, const std::nothrow_t& /* unused */) noexcept
+{
+    tracked_delete(data);
+}
+
+void
+operator delete(
+    void* data, std::align_val_t /* unused */, const std::nothrow_t& /* unused */
+) noexcept
+{
+    tracked_delete(data);
+}
+
+void
+operator delete[](
+    void* data, std::align_val_t /* unused */, const std::nothrow_t& /* unused */
+) noexcept
+{
+    tracked_delete(data);
+}
+// NOLINTEND(*-new-delete-operators,*-exception-escape)
+#endif
+
+namespace krompir {
+namespace memory {
+
+std::string_view
+subsystem_name(Subsystem subsystem)
+{
+    switch (subsystem) {
+        case Subsystem::other:
+            return "other";
+        case Subsystem::scanner:
+            return "scanner";
+        case Subsystem::resolver:
+            return "resolver";
+        case Subsystem::gui:
+            return "gui";
+        case Subsystem::logging:
+            return "logging";
+    }
+
+    return "unknown";
+}
+
+AllocSnapshot
+alloc_snapshot()
+{
+    AllocSnapshot snapshot;
+    snapshot.time = std::chrono::steady_clock::now();
+
+#if TRACK_ALLOCATIONS()
+    const auto add_counters = [&](const ThreadCounters& counters) {
+        for (std::size_t i = 0; i < SUBSYSTEMS; ++i) {
+            const auto& from = counters.subsystems.at(i);
+            auto& stats = snapshot.subsystems.at(i);
+
+            stats.allocations += from.allocations.load(std::memory_order_relaxed);
+            stats.frees += from.frees.load(std::memory_order_relaxed);
+            stats.bytes_allocated +=
+                from.bytes_allocated.load(std::memory_order_relaxed);
+            stats.bytes_freed += from.bytes_freed.load(std::memory_order_relaxed);
+        }
+    };
+
+    for (const auto& counters : thread_counters)
+        add_counters(counters);
+    add_counters(overflow_counters);
+
+    const auto finish = [](AllocStats& stats, std::size_t index) {
+        stats.live_bytes = static_cast<std::int64_t>(stats.bytes_allocated)
+                           - static_cast<std::int64_t>(stats.bytes_freed);
+
+        // The published peak lags by up to a batch per thread
+        const auto peak = peak_bytes.at(index).load(std::memory_order_relaxed);
+        stats.peak_bytes = static_cast<std::uint64_t>(std::max(peak, stats.live_bytes));
+    };
+
+    for (std::size_t i = 0; i < SUBSYSTEMS; ++i) {
+        auto& stats = snapshot.subsystems.at(i);
+        finish(stats, i);
+
+        snapshot.total.allocations += stats.allocations;
+        snapshot.total.frees += stats.frees;
+        snapshot.total.bytes_allocated += stats.bytes_allocated;
+        snapshot.total.bytes_freed += stats.bytes_freed;
+    }
+    finish(snapshot.total, SUBSYSTEMS);
+#endif
+
+    return snapshot;
+}
+
+void
+log_alloc_snapshot(const AllocSnapshot& snapshot)
+{
+    if constexpr (!tracking_enabled())
+        return;
+
+    for (std::size_t i = 0; i < SUBSYSTEMS; ++i) {
+        const auto& stats = snapshot.subsystems.at(i);
+
+        log_i(
+            memory,
+            "{}: {} allocations, {} frees, {} bytes live, {} bytes peak",
+            subsystem_name(static_cast<Subsystem>(i)),
+            stats.allocations,
+            stats.frees,
+            stats.live_bytes,
+            stats.peak_bytes
+        );
+    }
+
+    log_i(
+        memory,
+        "Total: {} allocations, {} frees, {} bytes live, {} bytes peak",
+        snapshot.total.allocations,
+        snapshot.total.frees,
+        snapshot.total.live_bytes,
+        snapshot.total.peak_bytes
+    );
+}
+
+#if TRACK_ALLOCATIONS()
+AllocScope::AllocScope(Subsystem subsystem) noexcept : previous_(current_subsystem)
+{
+    current_subsystem = subsystem;
+}
+
+AllocScope::~AllocScope()
+{
+    current_subsystem = previous_;
+}
+#endif
+
+} // namespace memory
+} // namespace krompir
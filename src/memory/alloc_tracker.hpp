@@ -0,0 +1,117 @@
+/**
+ * @file alloc_tracker.hpp
+ * @brief Heap allocation counters, per subsystem.
+ * @copyright MIT
+ *
+ * When built with `krompir_TRACK_ALLOCATIONS`, the global `operator new` and
+ * `operator delete` are replaced to count every allocation against the
+ * subsystem tagged on the allocating thread with an `AllocScope`. Otherwise
+ * the scopes compile to nothing and the standard allocator is used as-is.
+ */
+#pragma once
+
+#include "config.h"
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace krompir {
+namespace memory {
+
+/**
+ * The parts of krompir that memory is attributed to.
+ */
+enum class Subsystem : std::uint8_t {
+    other,
+    scanner,  ///< Log, world and pack scanning
+    resolver, ///< Dependency resolution
+    gui,
+    logging,
+};
+
+/**
+ * The number of subsystems.
+ */
+constexpr std::size_t SUBSYSTEMS = 5;
+
+/**
+ * Get the name of a subsystem.
+ */
+std::string_view subsystem_name(Subsystem subsystem);
+
+/**
+ * Check if allocations are being tracked in this build.
+ */
+constexpr bool
+tracking_enabled()
+{
+    return TRACK_ALLOCATIONS() != 0;
+}
+
+/**
+ * Allocation counters for one subsystem.
+ */
+struct AllocStats {
+    std::uint64_t allocations = 0;
+    std::uint64_t frees = 0;
+    std::uint64_t bytes_allocated = 0;
+    std::uint64_t bytes_freed = 0;
+    std::int64_t live_bytes = 0;
+    std::uint64_t peak_bytes = 0; ///< Highest live bytes seen, within a few 64 KiB
+};
+
+/**
+ * The allocation counters of every subsystem at one point in time.
+ */
+struct AllocSnapshot {
+    std::chrono::steady_clock::time_point time;
+    std::array<AllocStats, SUBSYSTEMS> subsystems{};
+    AllocStats total;
+
+    [[nodiscard]] const AllocStats&
+    operator[](Subsystem subsystem) const
+    {
+        return subsystems.at(static_cast<std::size_t>(subsystem));
+    }
+};
+
+/**
+ * Take a snapshot of the allocation counters.
+ *
+ * All counters are zero if tracking is disabled.
+ */
+AllocSnapshot alloc_snapshot();
+
+/**
+ * Write a snapshot to the log.
+ */
+void log_alloc_snapshot(const AllocSnapshot& snapshot);
+
+/**
+ * Attributes the allocations of the current thread to a subsystem while alive.
+ *
+ * Scopes nest, restoring the previous subsystem when they end.
+ */
+class AllocScope {
+#if TRACK_ALLOCATIONS()
+    Subsystem previous_;
+
+public:
+    explicit AllocScope(Subsystem subsystem) noexcept;
+    ~AllocScope();
+#else
+public:
+    explicit constexpr AllocScope(Subsystem /* unused */) noexcept {}
+#endif
+
+    AllocScope(const AllocScope&) = delete;
+    AllocScope& operator=(const AllocScope&) = delete;
+    AllocScope(AllocScope&&) = delete;
+    AllocScope& operator=(AllocScope&&) = delete;
+};
+
+} // namespace memory
+} // namespace krompir
@@ -0,0 +1,342 @@
+#include "metrics.hpp"
+
+#include "logging.hpp"
+
+#include <fmt/format.h>
+
+#include <condition_variable>
+#include <fstream>
+#include <stdexcept>
+#include <stop_token>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+
+namespace {
+
+using krompir::metrics::MAX_SHARDS;
+
+/// Which shards are owned by a live thread
+constinit std::array<std::atomic<bool>, MAX_SHARDS> shards_in_use{};
+
+/**
+ * Gives a shard back when its thread exits.
+ */
+class ShardRelease {
+    std::size_t shard_;
+
+public:
+    explicit ShardRelease(std::size_t shard) : shard_(shard) {}
+
+    ShardRelease(const ShardRelease&) = delete;
+    ShardRelease& operator=(const ShardRelease&) = delete;
+    ShardRelease(ShardRelease&&) = delete;
+    ShardRelease& operator=(ShardRelease&&) = delete;
+
+    ~ShardRelease()
+    {
+        krompir::metrics::detail::shard_released = true;
+        shards_in_use.at(shard_).store(false, std::memory_order_release);
+    }
+};
+
+/**
+ * Write a label or help value, escaped for the Prometheus text format.
+ */
+void
+write_escaped(std::ostream& out, std::string_view str)
+{
+    for (const char chr : str) {
+        switch (chr) {
+            case '\\':
+                out << "\\\\";
+                break;
+            case '\n':
+                out << "\\n";
+                break;
+            default:
+                out << chr;
+        }
+    }
+}
+
+} // namespace
+
+namespace krompir {
+namespace metrics {
+
+namespace detail {
+
+std::size_t
+claim_shard()
+{
+    for (std::size_t shard = 0; shard < MAX_SHARDS; ++shard) {
+        if (!shards_in_use.at(shard).exchange(true, std::memory_order_acquire)) {
+            thread_local const ShardRelease release(shard);
+            return shard;
+        }
+    }
+
+    return SHARED_SHARD;
+}
+
+} // namespace detail
+
+std::uint64_t
+Counter::value() const
+{
+    std::uint64_t value = 0;
+    shards_.for_each([&](const Shard& shard) {
+        value += shard.value.load(std::memory_order_relaxed);
+    });
+    return value;
+}
+
+void
+HistogramSnapshot::merge(const HistogramSnapshot& other)
+{
+    buckets.resize(std::max(buckets.size(), other.buckets.size()));
+    for (std::size_t idx = 0; idx < other.buckets.size(); ++idx)
+        buckets[idx] += other.buckets[idx];
+
+    count += other.count;
+    sum += other.sum;
+    max = std::max(max, other.max);
+}
+
+std::uint64_t
+HistogramSnapshot::quantile(double quantile) const
+{
+    if (count == 0)
+        return 0;
+
+    // The rank of the value, counting from 1
+    const auto rank = std::max<std::uint64_t>(
+        1,
+        static_cast<std::uint64_t>(
+            std::clamp(quantile, 0.0, 1.0) * static_cast<double>(count) + 0.5
+        )
+    );
+
+    std::uint64_t seen = 0;
+    for (std::size_t idx = 0; idx < buckets.size(); ++idx) {
+        seen += buckets[idx];
+        if (seen >= rank)
+            return std::min(histogram_bucket_max(idx), max);
+    }
+
+    return max;
+}
+
+double
+HistogramSnapshot::mean() const
+{
+    return count == 0 ? 0.0 : static_cast<double>(sum) / static_cast<double>(count);
+}
+
+HistogramSnapshot
+Histogram::snapshot() const
+{
+    constexpr auto RELAXED = std::memory_order_relaxed;
+
+    HistogramSnapshot snapshot;
+    snapshot.buckets.resize(HISTOGRAM_BUCKETS);
+
+    shards_.for_each([&](const Shard& shard) {
+        // Read racily, so the count is taken from the buckets to stay consistent
+        for (std::size_t idx = 0; idx < HISTOGRAM_BUCKETS; ++idx) {
+            const auto count = shard.buckets[idx].load(RELAXED);
+
+            snapshot.buckets[idx] += count;
+            snapshot.count += count;
+        }
+
+        snapshot.sum += shard.sum.load(RELAXED);
+        snapshot.max = std::max(snapshot.max, shard.max.load(RELAXED));
+    });
+
+    return snapshot;
+}
+
+std::string_view
+metric_type_name(MetricType type)
+{
+    switch (type) {
+        case MetricType::counter:
+            return "counter";
+        case MetricType::gauge:
+            return "gauge";
+        case MetricType::histogram:
+            return "histogram";
+    }
+
+    return "untyped";
+}
+
+Registry&
+Registry::global()
+{
+    static Registry registry;
+    return registry;
+}
+
+template <typename T>
+T&
+Registry::get_(std::string_view name, std::string_view help)
+{
+    const std::lock_guard lock(mutex_);
+
+    auto iter = metrics_.find(name);
+    if (iter == metrics_.end()) {
+        Entry entry{std::string(help), std::make_unique<T>()};
+        iter = metrics_.emplace(std::string(name), std::move(entry)).first;
+    }
+
+    auto* metric = std::get_if<std::unique_ptr<T>>(&iter->second.metric);
+    if (metric == nullptr)
+        throw std::invalid_argument(
+            fmt::format("metric {} is already registered with another type", name)
+        );
+
+    return **metric;
+}
+
+Counter&
+Registry::counter(std::string_view name, std::string_view help)
+{
+    return get_<Counter>(name, help);
+}
+
+Gauge&
+Registry::gauge(std::string_view name, std::string_view help)
+{
+    return get_<Gauge>(name, help);
+}
+
+Histogram&
+Registry::histogram(std::string_view name, std::string_view help)
+{
+    return get_<Histogram>(name, help);
+}
+
+MetricsSnapshot
+Registry::snapshot() const
+{
+    MetricsSnapshot snapshot;
+    snapshot.time = std::chrono::system_clock::now();
+
+    const std::lock_guard lock(mutex_);
+    snapshot.metrics.reserve(metrics_.size());
+
+    for (const auto& [name, entry] : metrics_) {
+        auto& metric = snapshot.metrics.emplace_back();
+        metric.name = name;
+        metric.help = entry.help;
+
+        std::visit(
+            [&](const auto& value) {
+                using T = typename std::decay_t<decltype(value)>::element_type;
+
+                if constexpr (std::is_same_v<T, Counter>) {
+                    metric.type = MetricType::counter;
+                    metric.value = static_cast<std::int64_t>(value->value());
+                }
+                else if constexpr (std::is_same_v<T, Gauge>) {
+                    metric.type = MetricType::gauge;
+                    metric.value = value->value();
+                }
+                else {
+                    metric.type = MetricType::histogram;
+                    metric.histogram = value->snapshot();
+                }
+            },
+            entry.metric
+        );
+    }
+
+    return snapshot;
+}
+
+void
+write_prometheus(const MetricsSnapshot& snapshot, std::ostream& out)
+{
+    for (const auto& metric : snapshot.metrics) {
+        out << "# HELP " << metric.name << ' ';
+        write_escaped(out, metric.help);
+        out << '\n';
+        out << "# TYPE " << metric.name << ' ' << metric_type_name(metric.type) << '\n';
+
+        if (metric.type != MetricType::histogram) {
+            out << metric.name << ' ' << metric.value << '\n';
+            continue;
+        }
+
+        // Buckets are cumulative, empty ones add nothing
+        const auto& histogram = metric.histogram;
+        std::uint64_t cumulative = 0;
+
+        for (std::size_t idx = 0; idx < histogram.buckets.size(); ++idx) {
+            if (histogram.buckets[idx] == 0)
+                continue;
+
+            cumulative += histogram.buckets[idx];
+            out << metric.name << "_bucket{le=\"" << histogram_bucket_max(idx) << "\"} "
+                << cumulative << '\n';
+        }
+
+        out << metric.name << "_bucket{le=\"+Inf\"} " << histogram.count << '\n';
+        out << metric.name << "_sum " << histogram.sum << '\n';
+        out << metric.name << "_count " << histogram.count << '\n';
+    }
+}
+
+void
+write_prometheus_file(
+    const MetricsSnapshot& snapshot, const std::filesystem::path& path
+)
+{
+    // Write next to the file and rename, so scrapers never see half a file
+    auto temp = path;
+    temp += ".tmp";
+
+    {
+        std::ofstream file(temp, std::ofstream::out | std::ofstream::trunc);
+        write_prometheus(snapshot, file);
+
+        file.close();
+        if (!file)
+            throw std::system_error(
+                std::make_error_code(std::errc::io_error),
+                "failed to write " + temp.string()
+            );
+    }
+
+    std::filesystem::rename(temp, path);
+}
+
+PeriodicExporter::PeriodicExporter(
+    const Registry& registry,
+    std::filesystem::path path,
+    std::chrono::milliseconds interval
+) :
+    thread_([&registry, path = std::move(path), interval](const std::stop_token& stop) {
+        std::mutex mutex;
+        std::condition_variable_any wake;
+
+        // Wakes up early when stopped, for a final export
+        while (!stop.stop_requested()) {
+            std::unique_lock lock(mutex);
+            wake.wait_for(lock, stop, interval, [] { return false; });
+
+            try {
+                write_prometheus_file(registry.snapshot(), path);
+            } catch (const std::exception& err) {
+                log_w(metrics, "Failed to export metrics to {}: {}", path, err.what());
+                logging::release_thread_writer(); // Sleeps for most of the time
+            }
+        }
+    })
+{}
+
+} // namespace metrics
+} // namespace krompir
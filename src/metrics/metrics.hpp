@@ -0,0 +1,514 @@
+/**
+ * @file metrics.hpp
+ * @brief Counters, gauges and latency histograms for the work krompir does.
+ * @copyright MIT
+ *
+ * Metrics are registered once by name, usually in a function local static,
+ * and are then updated without locks. Every thread writes to its own shard of
+ * a metric, the shards are only merged when a snapshot is taken:
+ *
+ * @code
+ * static auto& regions = metrics::counter("krompir_world_regions_total", "...");
+ * regions.add();
+ * @endcode
+ *
+ * Snapshots can be exported in the Prometheus text format.
+ */
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <variant>
+#include <vector>
+
+namespace krompir {
+namespace metrics {
+
+/**
+ * The number of threads that get a shard of every metric to themselves.
+ *
+ * Threads beyond this share one more shard, which is still correct, just slower.
+ */
+constexpr std::size_t MAX_SHARDS = 64;
+
+namespace detail {
+
+/**
+ * The shard of every metric used by threads that did not get their own.
+ */
+constexpr std::size_t SHARED_SHARD = MAX_SHARDS;
+
+/**
+ * Set once the shard of the current thread is given back.
+ *
+ * Thread locals constructed before the shard was claimed are destroyed after
+ * it is released, and may still count, so they fall back to the shared shard.
+ */
+inline thread_local bool shard_released = false;
+
+/**
+ * Claim a shard for the current thread, released when the thread exits.
+ */
+std::size_t claim_shard();
+
+/**
+ * Get the shard of the current thread.
+ */
+inline std::size_t
+thread_shard()
+{
+    thread_local const std::size_t shard = claim_shard();
+    return shard_released ? SHARED_SHARD : shard;
+}
+
+/**
+ * Add to a counter of the current thread's shard.
+ *
+ * Only the owner writes to its shard, so a relaxed load and store is enough
+ * and avoids a locked instruction. Readers may see it a little late.
+ */
+inline void
+shard_add(std::atomic<std::uint64_t>& counter, std::uint64_t value)
+{
+    if (thread_shard() == SHARED_SHARD) [[unlikely]]
+        counter.fetch_add(value, std::memory_order_relaxed);
+    else
+        counter.store(
+            counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed
+        );
+}
+
+/**
+ * Per-thread copies of `Shard`, allocated on first use by a thread.
+ *
+ * Shards outlive their threads, and are reused by the next thread that
+ * claims the same index, so no counts are lost.
+ */
+template <typename Shard>
+class Shards {
+    std::array<std::atomic<Shard*>, MAX_SHARDS + 1> shards_{};
+
+    /**
+     * Create the shard in a slot, unless another thread beat us to it.
+     */
+    Shard*
+    create_(std::atomic<Shard*>& slot)
+    {
+        auto* shard = new Shard{}; // NOLINT(*-owning-memory)
+        Shard* expected = nullptr;
+
+        if (slot.compare_exchange_strong(expected, shard, std::memory_order_acq_rel))
+            return shard;
+
+        delete shard; // NOLINT(*-owning-memory)
+        return expected;
+    }
+
+public:
+    Shards() = default;
+
+    Shards(const Shards&) = delete;
+    Shards& operator=(const Shards&) = delete;
+    Shards(Shards&&) = delete;
+    Shards& operator=(Shards&&) = delete;
+
+    ~Shards()
+    {
+        for (auto& slot : shards_)
+            delete slot.load(std::memory_order_acquire); // NOLINT(*-owning-memory)
+    }
+
+    /**
+     * Get the shard of the current thread.
+     */
+    Shard&
+    local()
+    {
+        auto& slot = shards_[thread_shard()]; // NOLINT(*-constant-array-index)
+        auto* shard = slot.load(std::memory_order_acquire);
+
+        if (shard == nullptr) [[unlikely]]
+            shard = create_(slot);
+        return *shard;
+    }
+
+    /**
+     * Call `func` with every shard that was used.
+     */
+    template <typename Func>
+    void
+    for_each(Func&& func) const
+    {
+        for (const auto& slot : shards_) {
+            if (const auto* shard = slot.load(std::memory_order_acquire))
+                func(*shard);
+        }
+    }
+};
+
+} // namespace detail
+
+/**
+ * A monotonically increasing count, such as bytes or files processed.
+ */
+class Counter {
+    struct alignas(64) Shard {
+        std::atomic<std::uint64_t> value;
+    };
+
+    detail::Shards<Shard> shards_;
+
+public:
+    /**
+     * Add to the counter.
+     */
+    void
+    add(std::uint64_t value = 1)
+    {
+        detail::shard_add(shards_.local().value, value);
+    }
+
+    /**
+     * Get the sum of every shard.
+     */
+    [[nodiscard]] std::uint64_t value() const;
+};
+
+/**
+ * A value that goes up and down, such as a queue length.
+ *
+ * Gauges may be set, so they are not sharded.
+ */
+class Gauge {
+    alignas(64) std::atomic<std::int64_t> value_{0};
+
+public:
+    void
+    set(std::int64_t value)
+    {
+        value_.store(value, std::memory_order_relaxed);
+    }
+
+    void
+    add(std::int64_t value)
+    {
+        value_.fetch_add(value, std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] std::int64_t
+    value() const
+    {
+        return value_.load(std::memory_order_relaxed);
+    }
+};
+
+/**
+ * Bits of precision kept by histogram buckets, for at most 1/16 relative error.
+ */
+constexpr unsigned HISTOGRAM_SUB_BITS = 4;
+
+/**
+ * The number of buckets needed to cover every 64-bit value.
+ */
+constexpr std::size_t HISTOGRAM_BUCKETS =
+    (64 - HISTOGRAM_SUB_BITS + 1) << HISTOGRAM_SUB_BITS;
+
+/**
+ * Get the histogram bucket of a value.
+ *
+ * Buckets are exact below `2 << HISTOGRAM_SUB_BITS`, and from there on every
+ * power of two is split into `1 << HISTOGRAM_SUB_BITS` linear buckets, like
+ * HdrHistogram.
+ */
+constexpr std::size_t
+histogram_bucket(std::uint64_t value)
+{
+    constexpr unsigned EXACT_BITS = HISTOGRAM_SUB_BITS + 1;
+
+    const auto width = static_cast<unsigned>(std::bit_width(value));
+    const auto shift = width > EXACT_BITS ? width - EXACT_BITS : 0;
+
+    return (static_cast<std::size_t>(shift) << HISTOGRAM_SUB_BITS) + (value >> shift);
+}
+
+/**
+ * Get the largest value that falls in a histogram bucket.
+ */
+constexpr std::uint64_t
+histogram_bucket_max(std::size_t bucket)
+{
+    constexpr std::size_t SUB_BUCKETS = std::size_t{1} << HISTOGRAM_SUB_BITS;
+
+    if (bucket < 2 * SUB_BUCKETS)
+        return bucket;
+
+    const auto shift = (bucket >> HISTOGRAM_SUB_BITS) - 1;
+    const auto top = (bucket & (SUB_BUCKETS - 1)) + SUB_BUCKETS;
+
+    return ((std::uint64_t{top} + 1) << shift) - 1;
+}
+
+/**
+ * The merged contents of a histogram.
+ */
+struct HistogramSnapshot {
+    std::vector<std::uint64_t> buckets; ///< Empty, or one per histogram bucket
+    std::uint64_t count = 0;
+    std::uint64_t sum = 0;
+    std::uint64_t max = 0;
+
+    /**
+     * Add the values of another snapshot to this one.
+     */
+    void merge(const HistogramSnapshot& other);
+
+    /**
+     * Get the value below which a fraction of the values fall.
+     *
+     * @param quantile Between 0 and 1.
+     * @returns The upper bound of the bucket holding the quantile.
+     */
+    [[nodiscard]] std::uint64_t quantile(double quantile) const;
+
+    /**
+     * Get the mean of the values.
+     */
+    [[nodiscard]] double mean() const;
+};
+
+/**
+ * A distribution of values, usually latencies in nanoseconds.
+ */
+class Histogram {
+    struct alignas(64) Shard {
+        std::array<std::atomic<std::uint64_t>, HISTOGRAM_BUCKETS> buckets;
+        std::atomic<std::uint64_t> sum;
+        std::atomic<std::uint64_t> max;
+    };
+
+    detail::Shards<Shard> shards_;
+
+public:
+    /**
+     * Record a value.
+     */
+    void
+    record(std::uint64_t value)
+    {
+        constexpr auto RELAXED = std::memory_order_relaxed;
+        auto& shard = shards_.local();
+
+        detail::shard_add(shard.buckets[histogram_bucket(value)], 1); // NOLINT
+        detail::shard_add(shard.sum, value);
+
+        auto previous = shard.max.load(RELAXED);
+        while (value > previous) {
+            if (shard.max.compare_exchange_weak(previous, value, RELAXED))
+                break;
+        }
+    }
+
+    /**
+     * Record a duration, in nanoseconds.
+     */
+    template <typename Rep, typename Period>
+    void
+    record(std::chrono::duration<Rep, Period> duration)
+    {
+        const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(duration);
+        record(static_cast<std::uint64_t>(std::max<std::int64_t>(ns.count(), 0)));
+    }
+
+    /**
+     * Merge every shard.
+     */
+    [[nodiscard]] HistogramSnapshot snapshot() const;
+};
+
+/**
+ * Records the lifetime of a scope into a histogram, in nanoseconds.
+ */
+class ScopedTimer {
+    Histogram& histogram_;
+    std::chrono::steady_clock::time_point start_;
+
+public:
+    explicit ScopedTimer(Histogram& histogram) :
+        histogram_(histogram), start_(std::chrono::steady_clock::now())
+    {}
+
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+    ScopedTimer(ScopedTimer&&) = delete;
+    ScopedTimer& operator=(ScopedTimer&&) = delete;
+
+    ~ScopedTimer() { histogram_.record(std::chrono::steady_clock::now() - start_); }
+};
+
+/**
+ * The kind of a metric.
+ */
+enum class MetricType : std::uint8_t { counter, gauge, histogram };
+
+/**
+ * Get the Prometheus name of a metric type.
+ */
+std::string_view metric_type_name(MetricType type);
+
+/**
+ * The value of one metric at one point in time.
+ */
+struct MetricSnapshot {
+    std::string name;
+    std::string help;
+    MetricType type = MetricType::counter;
+    std::int64_t value = 0; ///< For counters and gauges
+    HistogramSnapshot histogram;
+};
+
+/**
+ * The values of every metric at one point in time, sorted by name.
+ */
+struct MetricsSnapshot {
+    std::chrono::system_clock::time_point time;
+    std::vector<MetricSnapshot> metrics;
+};
+
+/**
+ * Owns metrics by name.
+ *
+ * The lock is only taken to register metrics and take snapshots, never to
+ * update them. Metrics live as long as their registry.
+ */
+class Registry {
+    using Metric = std::variant<
+        std::unique_ptr<Counter>,
+        std::unique_ptr<Gauge>,
+        std::unique_ptr<Histogram>>;
+
+    struct Entry {
+        std::string help;
+        Metric metric;
+    };
+
+    mutable std::mutex mutex_;
+    std::map<std::string, Entry, std::less<>> metrics_;
+
+    /**
+     * Get or create a metric of type T.
+     */
+    template <typename T>
+    T& get_(std::string_view name, std::string_view help);
+
+public:
+    /**
+     * Get the registry of the application.
+     */
+    static Registry& global();
+
+    /**
+     * Get a counter, creating it if needed.
+     *
+     * @throws std::invalid_argument if the name is used by another type of metric.
+     */
+    Counter& counter(std::string_view name, std::string_view help);
+
+    /**
+     * Get a gauge, creating it if needed.
+     *
+     * @throws std::invalid_argument if the name is used by another type of metric.
+     */
+    Gauge& gauge(std::string_view name, std::string_view help);
+
+    /**
+     * Get a histogram, creating it if needed.
+     *
+     * @throws std::invalid_argument if the name is used by another type of metric.
+     */
+    Histogram& histogram(std::string_view name, std::string_view help);
+
+    /**
+     * Take a snapshot of every metric.
+     */
+    [[nodiscard]] MetricsSnapshot snapshot() const;
+};
+
+/**
+ * Get a counter of the global registry.
+ */
+inline Counter&
+counter(std::string_view name, std::string_view help)
+{
+    return Registry::global().counter(name, help);
+}
+
+/**
+ * Get a gauge of the global registry.
+ */
+inline Gauge&
+gauge(std::string_view name, std::string_view help)
+{
+    return Registry::global().gauge(name, help);
+}
+
+/**
+ * Get a histogram of the global registry.
+ */
+inline Histogram&
+histogram(std::string_view name, std::string_view help)
+{
+    return Registry::global().histogram(name, help);
+}
+
+/**
+ * Write a snapshot in the Prometheus text exposition format.
+ *
+ * Histograms only list their non-empty buckets.
+ */
+void write_prometheus(const MetricsSnapshot& snapshot, std::ostream& out);
+
+/**
+ * Write a snapshot to a Prometheus text file, replacing it atomically.
+ *
+ * @throws std::system_error if the file can not be written.
+ */
+void write_prometheus_file(
+    const MetricsSnapshot& snapshot, const std::filesystem::path& path
+);
+
+/**
+ * Writes the metrics of a registry to a file on a background thread.
+ *
+ * The file is written once more when the exporter is destroyed.
+ */
+class PeriodicExporter {
+    std::jthread thread_;
+
+public:
+    /**
+     * Start exporting.
+     *
+     * @param interval Time between writes, which must not be zero.
+     */
+    PeriodicExporter(
+        const Registry& registry,
+        std::filesystem::path path,
+        std::chrono::milliseconds interval
+    );
+};
+
+} // namespace metrics
+} // namespace krompir
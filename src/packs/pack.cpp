@@ -0,0 +1,670 @@
+#include "pack.hpp"
+
+#include "configs/document.hpp"
+#include "logging.hpp"
+#include "utils/mapped_file.hpp"
+#include "utils/strings.hpp"
+
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cctype>
+#include <charconv>
+#include <chrono>
+#include <exception>
+#include <istream>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <tuple>
+#include <utility>
+
+namespace {
+
+using krompir::packs::EntryKind;
+using krompir::packs::PackEntry;
+using krompir::packs::PackError;
+using FileType = krompir::packs::PackCache::FileType;
+
+/// First line of a saved cache, changed whenever the format changes
+constexpr std::string_view CACHE_HEADER = "krompir-pack-cache 2";
+
+/**
+ * A file of a pack to describe.
+ */
+struct PackFile {
+    std::filesystem::path path;
+    std::string relative;
+    FileType type;
+};
+
+/**
+ * Decide how to describe a file, from its path in the pack.
+ *
+ * @returns nothing for files that are not part of the pack.
+ */
+std::optional<FileType>
+classify(std::string_view relative)
+{
+    if (relative == "index.toml")
+        return std::nullopt; // A packwiz index only repeats the hashes
+    if (relative == "pack.toml")
+        return FileType::pack;
+    if (relative == "modrinth.index.json")
+        return FileType::lockfile;
+    if (relative.ends_with(".pw.toml"))
+        return FileType::metafile;
+    if (relative.starts_with("mods/") && relative.ends_with(".jar")
+        && relative.find('/', 5) == std::string_view::npos)
+        return FileType::jar;
+
+    return FileType::override;
+}
+
+/**
+ * Get the last component of a `/` separated path.
+ */
+constexpr std::string_view
+filename(std::string_view path)
+{
+    const auto slash = path.rfind('/');
+    return slash == std::string_view::npos ? path : path.substr(slash + 1);
+}
+
+/**
+ * Get a string value of a document, or nothing if it is not set.
+ */
+std::string
+get_string(const krompir::configs::ConfigDocument& document, std::string_view key)
+{
+    const auto* entry = document.find(key);
+    return entry == nullptr ? std::string() : document.string(*entry);
+}
+
+/**
+ * Parse a config document, naming the file in errors.
+ */
+krompir::configs::ConfigDocument
+parse_document(
+    const std::filesystem::path& path, krompir::configs::ConfigFormat format
+)
+{
+    const krompir::utils::MappedFile file(path);
+
+    try {
+        return {format, std::string(file.view())};
+    } catch (const krompir::configs::ConfigError& err) {
+        throw PackError(fmt::format("{}: {}", path.string(), err.what()));
+    }
+}
+
+/**
+ * Describe a JAR in `mods/`.
+ */
+PackEntry
+describe_jar(const std::filesystem::path& path)
+{
+    const krompir::utils::MappedFile file(path);
+    auto [id, version] = krompir::packs::split_jar_name(path.filename().string());
+
+    return {
+        EntryKind::mod,
+        {},
+        std::move(id),
+        {},
+        std::move(version),
+        krompir::utils::fnv1a(file.view()),
+        file.size()
+    };
+}
+
+/**
+ * Describe a packwiz metafile, whose name is the ID of the mod.
+ */
+PackEntry
+describe_metafile(const std::filesystem::path& path)
+{
+    const auto document = parse_document(path, krompir::configs::ConfigFormat::toml);
+
+    auto id = path.filename().string();
+    id.resize(id.size() - std::string_view(".pw.toml").size());
+
+    return {
+        EntryKind::mod,
+        {},
+        std::move(id),
+        get_string(document, "name"),
+        krompir::packs::split_jar_name(get_string(document, "filename")).version,
+        krompir::utils::fnv1a(document.text()),
+        document.text().size()
+    };
+}
+
+/**
+ * Describe a packwiz `pack.toml`.
+ */
+PackEntry
+describe_pack(const std::filesystem::path& path)
+{
+    const auto document = parse_document(path, krompir::configs::ConfigFormat::toml);
+
+    return {
+        EntryKind::pack,
+        {},
+        {},
+        get_string(document, "name"),
+        get_string(document, "version"),
+        krompir::utils::fnv1a(document.text()),
+        document.text().size()
+    };
+}
+
+/**
+ * Describe every file listed by a `modrinth.index.json`.
+ *
+ * The hashes are taken from the index, so the files are not needed.
+ */
+std::vector<PackEntry>
+describe_lockfile(const std::filesystem::path& path)
+{
+    const auto document = parse_document(path, krompir::configs::ConfigFormat::json);
+
+    std::vector<PackEntry> entries;
+    entries.push_back(
+        {EntryKind::pack,
+         {},
+         {},
+         get_string(document, "name"),
+         get_string(document, "versionId"),
+         krompir::utils::fnv1a(document.text()),
+         document.text().size()}
+    );
+
+    for (std::size_t idx = 0;; ++idx) {
+        const auto prefix = fmt::format("files[{}].", idx);
+
+        auto file = get_string(document, prefix + "path");
+        if (file.empty())
+            break;
+
+        auto hash = get_string(document, prefix + "hashes.sha512");
+        if (hash.empty())
+            hash = get_string(document, prefix + "hashes.sha1");
+
+        const auto size = get_string(document, prefix + "fileSize");
+
+        PackEntry entry;
+        entry.path = std::move(file);
+        entry.hash = krompir::utils::fnv1a(hash);
+        std::from_chars(size.data(), size.data() + size.size(), entry.size);
+
+        if (classify(entry.path) == FileType::jar) {
+            auto [id, version] = krompir::packs::split_jar_name(filename(entry.path));
+
+            entry.kind = EntryKind::mod;
+            entry.id = std::move(id);
+            entry.version = std::move(version);
+        }
+
+        entries.push_back(std::move(entry));
+    }
+
+    return entries;
+}
+
+/**
+ * Describe a file, without using the cache.
+ */
+std::vector<PackEntry>
+describe_file(const std::filesystem::path& path, FileType type)
+{
+    switch (type) {
+        case FileType::jar:
+            return {describe_jar(path)};
+        case FileType::metafile:
+            return {describe_metafile(path)};
+        case FileType::pack:
+            return {describe_pack(path)};
+        case FileType::lockfile:
+            return describe_lockfile(path);
+        case FileType::override:
+            break;
+    }
+
+    const krompir::utils::MappedFile file(path);
+
+    PackEntry entry;
+    entry.hash = krompir::utils::fnv1a(file.view());
+    entry.size = file.size();
+
+    return {std::move(entry)};
+}
+
+/**
+ * Parse an integer field of a saved cache.
+ *
+ * @throws PackError if the field is not an integer.
+ */
+template <typename T>
+T
+parse_field(std::string_view field)
+{
+    T value{};
+    const auto [end, error] =
+        std::from_chars(field.data(), field.data() + field.size(), value);
+
+    if (error != std::errc() || end != field.data() + field.size())
+        throw PackError(fmt::format("malformed pack cache field '{}'", field));
+
+    return value;
+}
+
+} // namespace
+
+namespace krompir {
+namespace packs {
+
+void
+write_field(std::ostream& out, std::string_view str, char separator)
+{
+    out << separator;
+
+    for (const char chr : str) {
+        switch (chr) {
+            case '\\':
+                out << "\\\\";
+                break;
+            case '\t':
+                out << "\\t";
+                break;
+            case '\n':
+                out << "\\n";
+                break;
+            default:
+                out << chr;
+        }
+    }
+}
+
+std::vector<std::string>
+read_fields(std::string_view line)
+{
+    std::vector<std::string> fields(1);
+
+    for (std::size_t pos = 0; pos < line.size(); ++pos) {
+        if (line[pos] == '\t') {
+            fields.emplace_back();
+        }
+        else if (line[pos] == '\\' && pos + 1 < line.size()) {
+            const char chr = line[++pos];
+            fields.back() += chr == 't' ? '\t' : chr == 'n' ? '\n' : chr;
+        }
+        else {
+            fields.back() += line[pos];
+        }
+    }
+
+    return fields;
+}
+
+JarName
+split_jar_name(std::string_view filename)
+{
+    if (filename.ends_with(".jar"))
+        filename.remove_suffix(4);
+
+    const auto is_digit = [&](std::size_t pos) {
+        return pos < filename.size()
+               && std::isdigit(static_cast<unsigned char>(filename[pos])) != 0;
+    };
+    const auto is_char = [&](std::size_t pos, char chr) {
+        return pos < filename.size() && filename[pos] == chr;
+    };
+
+    std::size_t split = filename.size();
+    for (std::size_t pos = 1; pos < filename.size(); ++pos) {
+        const char chr = filename[pos];
+
+        if ((chr == '-' || chr == '_' || chr == ' ')
+            && (is_digit(pos + 1) || (is_char(pos + 1, 'v') && is_digit(pos + 2)))) {
+            split = pos;
+            break;
+        }
+    }
+
+    JarName name{std::string(filename.substr(0, split)), {}};
+    if (split < filename.size())
+        name.version = filename.substr(split + 1);
+
+    std::transform(name.id.begin(), name.id.end(), name.id.begin(), [](char chr) {
+        return static_cast<char>(std::tolower(static_cast<unsigned char>(chr)));
+    });
+
+    return name;
+}
+
+std::filesystem::path
+game_folder(const std::filesystem::path& root)
+{
+    std::error_code err;
+
+    // Hidden folders are skipped otherwise, so this one is always the game
+    if (std::filesystem::is_directory(root / ".minecraft", err))
+        return root / ".minecraft";
+
+    const bool launcher_instance =
+        std::filesystem::is_regular_file(root / "instance.cfg", err)
+        || std::filesystem::is_regular_file(root / "mmc-pack.json", err);
+    if (launcher_instance && std::filesystem::is_directory(root / "minecraft", err))
+        return root / "minecraft";
+
+    return root;
+}
+
+std::vector<PackEntry>
+PackCache::describe(
+    const std::filesystem::path& path, FileType type, PackCacheStats& stats
+)
+{
+    const auto time = std::filesystem::last_write_time(path).time_since_epoch().count();
+    const auto size = std::filesystem::file_size(path);
+    const auto key = path.string();
+
+    {
+        const std::lock_guard lock(mutex_);
+
+        const auto iter = files_.find(key);
+        if (iter != files_.end() && iter->second.type == type
+            && iter->second.time == time && iter->second.size == size) {
+            ++stats.unchanged;
+            return iter->second.entries;
+        }
+    }
+
+    auto entries = describe_file(path, type);
+    ++stats.read;
+
+    const std::lock_guard lock(mutex_);
+    files_.insert_or_assign(
+        key, CachedFile{type, static_cast<std::int64_t>(time), size, entries, {}}
+    );
+
+    return entries;
+}
+
+std::optional<std::uint64_t>
+PackCache::content_hash(
+    const std::filesystem::path& path, std::int64_t time, std::uintmax_t size
+) const
+{
+    const std::lock_guard lock(mutex_);
+
+    const auto iter = files_.find(path.string());
+    if (iter == files_.end() || iter->second.time != time || iter->second.size != size)
+        return std::nullopt;
+
+    const auto& file = iter->second;
+    if (file.content_hash)
+        return file.content_hash;
+
+    // Only these are described by a hash of their whole content
+    if ((file.type != FileType::override && file.type != FileType::jar)
+        || file.entries.size() != 1)
+        return std::nullopt;
+
+    return file.entries.front().hash;
+}
+
+void
+PackCache::set_content_hash(
+    const std::filesystem::path& path,
+    std::int64_t time,
+    std::uintmax_t size,
+    std::uint64_t hash
+)
+{
+    const std::lock_guard lock(mutex_);
+
+    // Keep the description of a file that did not change, next to its hash
+    auto& file = files_[path.string()];
+    if (file.time == time && file.size == size && !file.entries.empty()) {
+        file.content_hash = hash;
+        return;
+    }
+
+    PackEntry entry;
+    entry.hash = hash;
+    entry.size = size;
+
+    file = {FileType::override, time, size, {std::move(entry)}, hash};
+}
+
+std::size_t
+PackCache::size() const
+{
+    const std::lock_guard lock(mutex_);
+    return files_.size();
+}
+
+void
+PackCache::read(std::istream& in)
+{
+    std::unordered_map<std::string, CachedFile> files;
+    CachedFile* file = nullptr;
+
+    std::string line;
+    if (!std::getline(in, line) || line != CACHE_HEADER)
+        throw PackError("not a pack cache, or from another version");
+
+    // A line per file, with its content hash if known, followed by a line per
+    // entry starting with a tab
+    while (std::getline(in, line)) {
+        auto fields = read_fields(line);
+
+        if (!fields[0].empty() && fields.size() == 5) {
+            file = &files[std::move(fields[0])];
+            file->type = static_cast<FileType>(parse_field<unsigned>(fields[1]));
+            file->time = parse_field<std::int64_t>(fields[2]);
+            file->size = parse_field<std::uintmax_t>(fields[3]);
+            if (!fields[4].empty())
+                file->content_hash = parse_field<std::uint64_t>(fields[4]);
+        }
+        else if (file != nullptr && fields[0].empty() && fields.size() == 8) {
+            file->entries.push_back(
+                {static_cast<EntryKind>(parse_field<unsigned>(fields[1])),
+                 std::move(fields[2]),
+                 std::move(fields[3]),
+                 std::move(fields[4]),
+                 std::move(fields[5]),
+                 parse_field<std::uint64_t>(fields[6]),
+                 parse_field<std::uint64_t>(fields[7])}
+            );
+        }
+        else {
+            throw PackError(fmt::format("malformed pack cache line '{}'", line));
+        }
+    }
+
+    const std::lock_guard lock(mutex_);
+    files_ = std::move(files);
+}
+
+void
+PackCache::write(std::ostream& out) const
+{
+    const std::lock_guard lock(mutex_);
+
+    out << CACHE_HEADER;
+
+    for (const auto& [path, file] : files_) {
+        write_field(out, path, '\n');
+        write_field(out, std::to_string(static_cast<unsigned>(file.type)));
+        write_field(out, std::to_string(file.time));
+        write_field(out, std::to_string(file.size));
+        write_field(out, file.content_hash ? std::to_string(*file.content_hash) : "");
+
+        for (const auto& entry : file.entries) {
+            out << '\n';
+            write_field(out, std::to_string(static_cast<unsigned>(entry.kind)));
+            write_field(out, entry.path);
+            write_field(out, entry.id);
+            write_field(out, entry.name);
+            write_field(out, entry.version);
+            write_field(out, std::to_string(entry.hash));
+            write_field(out, std::to_string(entry.size));
+        }
+    }
+
+    out << '\n';
+}
+
+Pack
+load_pack(
+    const std::filesystem::path& path,
+    PackCache& cache,
+    PackCacheStats& stats,
+    unsigned threads
+)
+{
+    const auto start = std::chrono::steady_clock::now();
+
+    std::vector<PackFile> files;
+    auto root = std::filesystem::absolute(path).lexically_normal();
+    if (!root.has_filename())
+        root = root.parent_path(); // Trailing separator
+
+    if (std::filesystem::is_regular_file(root)) {
+        root = root.parent_path();
+
+        if (path.filename() == "modrinth.index.json")
+            files.push_back({path, "modrinth.index.json", FileType::lockfile});
+        else if (path.filename() != "pack.toml")
+            throw PackError(fmt::format("{} is not a pack", path.string()));
+    }
+
+    if (files.empty()) {
+        const auto game = game_folder(root);
+        auto iter = std::filesystem::recursive_directory_iterator(game);
+
+        for (const auto& entry : iter) {
+            const auto name = entry.path().filename().string();
+
+            if (entry.is_directory()) {
+                const auto& data = INSTANCE_DATA_DIRS;
+                const bool skipped =
+                    name.starts_with('.')
+                    || (iter.depth() == 0
+                        && std::find(data.begin(), data.end(), name) != data.end());
+                if (skipped)
+                    iter.disable_recursion_pending();
+                continue;
+            }
+
+            if (!entry.is_regular_file() || name.starts_with('.'))
+                continue;
+
+            // Overrides of a Modrinth pack are part of the pack like any file
+            auto relative = entry.path().lexically_relative(game).generic_string();
+            if (relative.starts_with("overrides/"))
+                relative.erase(0, std::string_view("overrides/").size());
+
+            if (const auto type = classify(relative))
+                files.push_back({entry.path(), std::move(relative), *type});
+        }
+    }
+
+    // Describe files in parallel, only the changed ones are actually read
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = static_cast<unsigned>(std::min<std::size_t>(threads, files.size()));
+
+    std::vector<std::vector<PackEntry>> described(files.size());
+    std::atomic<std::size_t> next{0};
+    std::exception_ptr error;
+    std::mutex mutex;
+
+    auto work = [&] {
+        PackCacheStats partial;
+
+        for (auto idx = next++; idx < files.size(); idx = next++) {
+            try {
+                const auto& file = files[idx];
+                described[idx] = cache.describe(file.path, file.type, partial);
+            } catch (...) {
+                const std::lock_guard lock(mutex);
+                if (!error)
+                    error = std::current_exception();
+            }
+        }
+
+        const std::lock_guard lock(mutex);
+        stats.unchanged += partial.unchanged;
+        stats.read += partial.read;
+    };
+
+    {
+        std::vector<std::jthread> workers;
+        workers.reserve(threads);
+
+        for (unsigned idx = 1; idx < threads; ++idx)
+            workers.emplace_back(work);
+
+        work();
+    }
+
+    if (error)
+        std::rethrow_exception(error);
+
+    Pack pack;
+
+    for (std::size_t idx = 0; idx < files.size(); ++idx) {
+        for (auto& entry : described[idx]) {
+            if (files[idx].type != FileType::lockfile)
+                entry.path = files[idx].relative;
+
+            switch (entry.kind) {
+                case EntryKind::pack:
+                    pack.name = std::move(entry.name);
+                    pack.version = std::move(entry.version);
+                    break;
+                case EntryKind::mod:
+                    pack.mods.push_back(std::move(entry));
+                    break;
+                case EntryKind::override:
+                    pack.overrides.push_back(std::move(entry));
+                    break;
+            }
+        }
+    }
+
+    if (pack.name.empty())
+        pack.name = root.filename().string();
+
+    std::sort(pack.mods.begin(), pack.mods.end(), [](const auto& lhs, const auto& rhs) {
+        return std::tie(lhs.id, lhs.path) < std::tie(rhs.id, rhs.path);
+    });
+    std::sort(pack.overrides.begin(), pack.overrides.end(), [](auto& lhs, auto& rhs) {
+        return lhs.path < rhs.path;
+    });
+
+    log_i(
+        packs,
+        "Loaded {} with {} mods and {} overrides in {}, {} files read",
+        path,
+        pack.mods.size(),
+        pack.overrides.size(),
+        std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start
+        ),
+        stats.read
+    );
+
+    return pack;
+}
+
+} // namespace packs
+} // namespace krompir
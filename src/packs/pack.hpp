@@ -0,0 +1,236 @@
+/**
+ * @file pack.hpp
+ * @brief Describe the mods and files of a pack, from its folder or lockfile.
+ * @copyright MIT
+ *
+ * A pack can be given as:
+ *  - a packwiz folder, where every `*.pw.toml` metafile is a mod,
+ *  - an unpacked Modrinth pack, whose `modrinth.index.json` lists the mods,
+ *  - a plain pack or instance folder, where every JAR in `mods/` is a mod.
+ *
+ * MultiMC and Prism instances keep the game in a `.minecraft/` or `minecraft/`
+ * folder next to their `instance.cfg`, and their pack is the one in there.
+ *
+ * Anything else in the folder is an override. Files are hashed by content and
+ * the results are cached by path, size and modification time, so loading a
+ * pack again only costs a `stat` per file.
+ */
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <iosfwd>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace krompir {
+namespace packs {
+
+/**
+ * Folders of an instance that are not part of its pack.
+ */
+constexpr std::array<std::string_view, 5> INSTANCE_DATA_DIRS = {
+    "backups", "crash-reports", "logs", "saves", "screenshots"
+};
+
+/**
+ * What an entry of a pack is.
+ */
+enum class EntryKind : std::uint8_t {
+    pack,     ///< The name and version of the pack itself
+    mod,      ///< A mod, known by a stable ID
+    override, ///< Any other file, known by its path
+};
+
+/**
+ * A mod or file of a pack.
+ */
+struct PackEntry {
+    EntryKind kind = EntryKind::override;
+    std::string path;    ///< Relative to the pack, without any `overrides/`
+    std::string id;      ///< Stable between versions, for mods
+    std::string name;    ///< Human readable, may be empty
+    std::string version; ///< May be empty
+    std::uint64_t hash = 0;
+    std::uint64_t size = 0;
+
+    /**
+     * Get the name to show for the entry.
+     */
+    [[nodiscard]] std::string_view
+    display_name() const noexcept
+    {
+        return name.empty() ? std::string_view(id) : std::string_view(name);
+    }
+};
+
+/**
+ * The ID and version of a mod, guessed from its file name.
+ */
+struct JarName {
+    std::string id;
+    std::string version;
+};
+
+/**
+ * Guess the ID and version of a mod from the name of its JAR.
+ *
+ * The version starts at the first `-`, `_` or space followed by a digit (or a
+ * `v` and a digit), e.g. `jei-1.20.1-forge-15.2.0.27.jar` is `jei` at
+ * `1.20.1-forge-15.2.0.27`. The ID is lower cased.
+ */
+JarName split_jar_name(std::string_view filename);
+
+/**
+ * Write a field of a saved cache or manifest, escaping tabs and newlines.
+ *
+ * @param separator Written before the field, a newline starts a record.
+ */
+void write_field(std::ostream& out, std::string_view str, char separator = '\t');
+
+/**
+ * Split a line of a saved cache or manifest into its fields, resolving escapes.
+ */
+std::vector<std::string> read_fields(std::string_view line);
+
+/**
+ * Get the folder holding the game files of an instance.
+ *
+ * @param root An instance or pack folder.
+ *
+ * @returns The `.minecraft/` folder of `root`, the `minecraft/` folder of a
+ *          MultiMC or Prism instance, or `root` itself.
+ */
+std::filesystem::path game_folder(const std::filesystem::path& root);
+
+/**
+ * A loaded pack, with mods sorted by ID and overrides by path.
+ */
+struct Pack {
+    std::string name;
+    std::string version;
+    std::vector<PackEntry> mods;
+    std::vector<PackEntry> overrides;
+};
+
+/**
+ * Thrown when a pack can not be loaded.
+ */
+class PackError : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
+
+/**
+ * How much work the cache saved.
+ */
+struct PackCacheStats {
+    std::size_t unchanged = 0; ///< Files described without reading them
+    std::size_t read = 0;      ///< Files read and hashed
+};
+
+/**
+ * Descriptions of files, by path.
+ *
+ * Safe to use from many threads, and can be saved between runs.
+ */
+class PackCache {
+public:
+    /**
+     * How a file is described, which depends on where it is in its pack.
+     */
+    enum class FileType : std::uint8_t { override, jar, metafile, pack, lockfile };
+
+private:
+    struct CachedFile {
+        FileType type;
+        std::int64_t time;
+        std::uintmax_t size;
+        std::vector<PackEntry> entries; ///< Without paths, for single files
+        std::optional<std::uint64_t> content_hash; ///< If read by a caller
+    };
+
+    mutable std::mutex mutex_;
+    std::unordered_map<std::string, CachedFile> files_;
+
+public:
+    /**
+     * Describe a file, reading it only if it changed.
+     *
+     * @returns The entries of the file, with paths only for lockfiles.
+     *
+     * @throws std::system_error if the file can not be read.
+     * @throws PackError if the file is malformed.
+     */
+    std::vector<PackEntry> describe(
+        const std::filesystem::path& path, FileType type, PackCacheStats& stats
+    );
+
+    /**
+     * Get the hash of the content of a file, if it did not change since cached.
+     *
+     * @param time The modification time of the file, as a count of ticks.
+     */
+    [[nodiscard]] std::optional<std::uint64_t> content_hash(
+        const std::filesystem::path& path, std::int64_t time, std::uintmax_t size
+    ) const;
+
+    /**
+     * Cache the hash of the content of a file, read by the caller.
+     *
+     * Files cached by how they were described keep that description, and
+     * the hash is kept next to it.
+     */
+    void set_content_hash(
+        const std::filesystem::path& path,
+        std::int64_t time,
+        std::uintmax_t size,
+        std::uint64_t hash
+    );
+
+    /**
+     * Get the number of cached files.
+     */
+    [[nodiscard]] std::size_t size() const;
+
+    /**
+     * Read a saved cache, replacing everything in this one.
+     *
+     * @throws PackError if the cache is malformed.
+     */
+    void read(std::istream& in);
+
+    /**
+     * Save the cache.
+     */
+    void write(std::ostream& out) const;
+};
+
+/**
+ * Load a pack.
+ *
+ * @param path A pack folder, a `pack.toml` or a `modrinth.index.json`.
+ * @param cache File descriptions, kept between calls.
+ * @param stats Where to count cache hits.
+ * @param threads Number of worker threads, or 0 to pick one per core.
+ *
+ * @throws std::filesystem::filesystem_error if the folder can not be listed.
+ * @throws std::system_error if a file can not be read.
+ * @throws PackError if a lockfile or metafile is malformed.
+ */
+Pack load_pack(
+    const std::filesystem::path& path,
+    PackCache& cache,
+    PackCacheStats& stats,
+    unsigned threads = 0
+);
+
+} // namespace packs
+} // namespace krompir
@@ -0,0 +1,302 @@
+#include "pack_diff.hpp"
+
+#include <fmt/ostream.h>
+
+#include <ostream>
+#include <string_view>
+
+namespace {
+
+using krompir::packs::EntryChange;
+using krompir::packs::PackEntry;
+
+/**
+ * Walk two sorted lists of entries together.
+ *
+ * @param key Gets the key the lists are sorted by.
+ * @param visit Called with the entry of each side, or nullptr if it is missing.
+ */
+template <typename Key, typename Visit>
+void
+merge_entries(
+    const std::vector<PackEntry>& from,
+    const std::vector<PackEntry>& to,
+    Key&& key,
+    Visit&& visit
+)
+{
+    auto lhs = from.begin();
+    auto rhs = to.begin();
+
+    while (lhs != from.end() || rhs != to.end()) {
+        if (rhs == to.end() || (lhs != from.end() && key(*lhs) < key(*rhs)))
+            visit(&*lhs++, nullptr);
+        else if (lhs == from.end() || key(*rhs) < key(*lhs))
+            visit(nullptr, &*rhs++);
+        else
+            visit(&*lhs++, &*rhs++);
+    }
+}
+
+/**
+ * Sort changes into added, changed and removed entries.
+ */
+template <typename Key>
+std::size_t
+diff_entries(
+    const std::vector<PackEntry>& from,
+    const std::vector<PackEntry>& to,
+    Key&& key,
+    std::vector<PackEntry>& added,
+    std::vector<EntryChange>& changed,
+    std::vector<PackEntry>& removed
+)
+{
+    std::size_t unchanged = 0;
+
+    merge_entries(from, to, key, [&](const PackEntry* lhs, const PackEntry* rhs) {
+        if (lhs == nullptr)
+            added.push_back(*rhs);
+        else if (rhs == nullptr)
+            removed.push_back(*lhs);
+        else if (lhs->hash != rhs->hash || lhs->version != rhs->version)
+            changed.push_back({*lhs, *rhs});
+        else
+            ++unchanged;
+    });
+
+    return unchanged;
+}
+
+/**
+ * Write text for a Markdown table cell.
+ */
+std::string
+cell(std::string_view str)
+{
+    if (str.empty())
+        return "-";
+
+    std::string escaped;
+    for (const char chr : str) {
+        if (chr == '|' || chr == '\\')
+            escaped += '\\';
+        escaped += chr == '\n' ? ' ' : chr;
+    }
+
+    return escaped;
+}
+
+/**
+ * Write a Markdown table of mods, if there are any.
+ */
+void
+write_mods(
+    std::ostream& out, std::string_view title, const std::vector<PackEntry>& mods
+)
+{
+    if (mods.empty())
+        return;
+
+    fmt::print(out, "\n### {}\n\n| Mod | Version |\n| --- | --- |\n", title);
+    for (const auto& mod : mods)
+        fmt::print(out, "| {} | {} |\n", cell(mod.display_name()), cell(mod.version));
+}
+
+/**
+ * Write a quoted and escaped JSON string.
+ */
+void
+write_json_string(std::ostream& out, std::string_view str)
+{
+    out << '"';
+
+    for (const char chr : str) {
+        switch (chr) {
+            case '"':
+                out << "\\\"";
+                break;
+            case '\\':
+                out << "\\\\";
+                break;
+            case '\n':
+                out << "\\n";
+                break;
+            case '\t':
+                out << "\\t";
+                break;
+            default:
+                if (static_cast<unsigned char>(chr) < 0x20) // NOLINT(*-magic-numbers)
+                    fmt::print(out, "\\u{:04x}", static_cast<unsigned>(chr));
+                else
+                    out << chr;
+        }
+    }
+
+    out << '"';
+}
+
+/**
+ * Write a JSON array, one element per line.
+ */
+template <typename T, typename Write>
+void
+write_json_array(std::ostream& out, const std::vector<T>& values, Write&& write)
+{
+    out << '[';
+
+    for (std::size_t idx = 0; idx < values.size(); ++idx) {
+        out << (idx == 0 ? "\n      " : ",\n      ");
+        write(values[idx]);
+    }
+
+    out << (values.empty() ? "]" : "\n    ]");
+}
+
+} // namespace
+
+namespace krompir {
+namespace packs {
+
+bool
+PackDiff::empty() const noexcept
+{
+    return added_mods.empty() && updated_mods.empty() && removed_mods.empty()
+           && added_overrides.empty() && changed_overrides.empty()
+           && removed_overrides.empty();
+}
+
+PackDiff
+diff_packs(const Pack& from, const Pack& to)
+{
+    PackDiff diff;
+    diff.from_name = from.name;
+    diff.from_version = from.version;
+    diff.to_name = to.name;
+    diff.to_version = to.version;
+
+    diff.unchanged_mods = diff_entries(
+        from.mods,
+        to.mods,
+        [](const PackEntry& entry) -> const std::string& { return entry.id; },
+        diff.added_mods,
+        diff.updated_mods,
+        diff.removed_mods
+    );
+
+    diff.unchanged_overrides = diff_entries(
+        from.overrides,
+        to.overrides,
+        [](const PackEntry& entry) -> const std::string& { return entry.path; },
+        diff.added_overrides,
+        diff.changed_overrides,
+        diff.removed_overrides
+    );
+
+    return diff;
+}
+
+void
+write_markdown(const PackDiff& diff, std::ostream& out)
+{
+    fmt::print(out, "## {} {}\n\n", diff.to_name, diff.to_version);
+    fmt::print(
+        out,
+        "Changes since {} {}: {} mods added, {} updated and {} removed.\n",
+        diff.from_name,
+        diff.from_version,
+        diff.added_mods.size(),
+        diff.updated_mods.size(),
+        diff.removed_mods.size()
+    );
+
+    write_mods(out, "Added mods", diff.added_mods);
+
+    if (!diff.updated_mods.empty()) {
+        out << "\n### Updated mods\n\n| Mod | From | To |\n| --- | --- | --- |\n";
+        for (const auto& [old, mod] : diff.updated_mods) {
+            fmt::print(
+                out,
+                "| {} | {} | {} |\n",
+                cell(mod.display_name()),
+                cell(old.version),
+                cell(mod.version)
+            );
+        }
+    }
+
+    write_mods(out, "Removed mods", diff.removed_mods);
+
+    const auto overrides = diff.added_overrides.size() + diff.changed_overrides.size()
+                           + diff.removed_overrides.size();
+    if (overrides == 0)
+        return;
+
+    out << "\n### Overrides\n\n";
+    for (const auto& file : diff.added_overrides)
+        fmt::print(out, "- Added `{}`\n", file.path);
+    for (const auto& change : diff.changed_overrides)
+        fmt::print(out, "- Changed `{}`\n", change.to.path);
+    for (const auto& file : diff.removed_overrides)
+        fmt::print(out, "- Removed `{}`\n", file.path);
+}
+
+void
+write_json(const PackDiff& diff, std::ostream& out)
+{
+    const auto mod = [&](const PackEntry& entry) {
+        out << "{\"id\": ";
+        write_json_string(out, entry.id);
+        out << ", \"name\": ";
+        write_json_string(out, entry.display_name());
+        out << ", \"version\": ";
+        write_json_string(out, entry.version);
+        out << '}';
+    };
+
+    const auto update = [&](const EntryChange& change) {
+        out << "{\"id\": ";
+        write_json_string(out, change.to.id);
+        out << ", \"name\": ";
+        write_json_string(out, change.to.display_name());
+        out << ", \"from\": ";
+        write_json_string(out, change.from.version);
+        out << ", \"to\": ";
+        write_json_string(out, change.to.version);
+        out << '}';
+    };
+
+    const auto file = [&](const PackEntry& entry) {
+        write_json_string(out, entry.path);
+    };
+    const auto changed = [&](const EntryChange& change) { file(change.to); };
+
+    out << "{\n  \"from\": {\"name\": ";
+    write_json_string(out, diff.from_name);
+    out << ", \"version\": ";
+    write_json_string(out, diff.from_version);
+    out << "},\n  \"to\": {\"name\": ";
+    write_json_string(out, diff.to_name);
+    out << ", \"version\": ";
+    write_json_string(out, diff.to_version);
+
+    out << "},\n  \"mods\": {\n    \"added\": ";
+    write_json_array(out, diff.added_mods, mod);
+    out << ",\n    \"updated\": ";
+    write_json_array(out, diff.updated_mods, update);
+    out << ",\n    \"removed\": ";
+    write_json_array(out, diff.removed_mods, mod);
+    out << ",\n    \"unchanged\": " << diff.unchanged_mods;
+
+    out << "\n  },\n  \"overrides\": {\n    \"added\": ";
+    write_json_array(out, diff.added_overrides, file);
+    out << ",\n    \"changed\": ";
+    write_json_array(out, diff.changed_overrides, changed);
+    out << ",\n    \"removed\": ";
+    write_json_array(out, diff.removed_overrides, file);
+    out << ",\n    \"unchanged\": " << diff.unchanged_overrides;
+    out << "\n  }\n}\n";
+}
+
+} // namespace packs
+} // namespace krompir
@@ -0,0 +1,70 @@
+/**
+ * @file pack_diff.hpp
+ * @brief Compare two versions of a pack, and write release notes.
+ * @copyright MIT
+ */
+#pragma once
+
+#include "packs/pack.hpp"
+
+#include <cstddef>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+namespace krompir {
+namespace packs {
+
+/**
+ * A mod or override in both versions of a pack, that changed.
+ */
+struct EntryChange {
+    PackEntry from;
+    PackEntry to;
+};
+
+/**
+ * What changed between two versions of a pack.
+ */
+struct PackDiff {
+    std::string from_name;
+    std::string from_version;
+    std::string to_name;
+    std::string to_version;
+
+    std::vector<PackEntry> added_mods;
+    std::vector<EntryChange> updated_mods; ///< New version, or same but rebuilt
+    std::vector<PackEntry> removed_mods;
+    std::size_t unchanged_mods = 0;
+
+    std::vector<PackEntry> added_overrides;
+    std::vector<EntryChange> changed_overrides;
+    std::vector<PackEntry> removed_overrides;
+    std::size_t unchanged_overrides = 0;
+
+    /**
+     * Check if nothing changed.
+     */
+    [[nodiscard]] bool empty() const noexcept;
+};
+
+/**
+ * Compare two versions of a pack.
+ *
+ * Mods are matched by ID and overrides by path, with a single merge over the
+ * sorted entries of both packs.
+ */
+PackDiff diff_packs(const Pack& from, const Pack& to);
+
+/**
+ * Write a diff as Markdown release notes.
+ */
+void write_markdown(const PackDiff& diff, std::ostream& out);
+
+/**
+ * Write a diff as JSON.
+ */
+void write_json(const PackDiff& diff, std::ostream& out);
+
+} // namespace packs
+} // namespace krompir
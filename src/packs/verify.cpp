@@ -0,0 +1,875 @@
+#include "verify.hpp"
+
+#include "config.h"
+#include "logging.hpp"
+#include "utils/strings.hpp"
+
+#include <fmt/core.h>
+
+#if IO_URING()
+#  include <fcntl.h>
+#  include <linux/io_uring.h>
+#  include <sys/mman.h>
+#  include <sys/syscall.h>
+#  include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <deque>
+#include <fstream>
+#include <istream>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <utility>
+
+namespace {
+
+using krompir::packs::HashStats;
+using krompir::packs::Manifest;
+using krompir::packs::ManifestFile;
+using krompir::packs::PackCache;
+using krompir::packs::PackError;
+using krompir::packs::ReadBackend;
+using krompir::utils::fnv1a;
+using krompir::utils::FNV1A_OFFSET;
+
+/// First line of a saved manifest, changed whenever the format changes
+constexpr std::string_view MANIFEST_HEADER = "krompir-manifest 2";
+
+/// Bytes read from a file at once
+constexpr std::uint32_t CHUNK_SIZE = 256 * 1024;
+
+/// Reads in flight per worker, enough to keep a fast SSD busy
+constexpr unsigned QUEUE_DEPTH = 32;
+
+/// Files read at once per worker, so small files do not leave the queue empty
+constexpr std::size_t OPEN_FILES = 16;
+
+/**
+ * A file of an instance, as it is.
+ */
+struct InstanceFile {
+    std::filesystem::path path;
+    std::string relative;
+    std::uint64_t size;
+    std::int64_t time;
+};
+
+/**
+ * A file to hash.
+ */
+struct HashJob {
+    const InstanceFile* file;
+    std::size_t index; ///< Of the file, among those to hash
+    std::optional<std::uint64_t> hash = std::nullopt; ///< Nothing if not read whole
+};
+
+/**
+ * Get the game folder of an instance, the same way `load_pack` does.
+ */
+std::filesystem::path
+instance_root(const std::filesystem::path& path)
+{
+    auto root = std::filesystem::absolute(path).lexically_normal();
+    if (!root.has_filename())
+        root = root.parent_path(); // Trailing separator
+    return krompir::packs::game_folder(root);
+}
+
+/**
+ * List the files of an instance, sorted by path.
+ */
+std::vector<InstanceFile>
+list_instance(const std::filesystem::path& root)
+{
+    std::vector<InstanceFile> files;
+    auto iter = std::filesystem::recursive_directory_iterator(root);
+
+    for (const auto& entry : iter) {
+        const auto name = entry.path().filename().string();
+
+        if (entry.is_directory()) {
+            const auto& data = krompir::packs::INSTANCE_DATA_DIRS;
+            const bool skipped =
+                name.starts_with('.')
+                || (iter.depth() == 0
+                    && std::find(data.begin(), data.end(), name) != data.end());
+            if (skipped)
+                iter.disable_recursion_pending();
+            continue;
+        }
+
+        if (!entry.is_regular_file() || name.starts_with('.'))
+            continue;
+
+        files.push_back(
+            {entry.path(),
+             entry.path().lexically_relative(root).generic_string(),
+             entry.file_size(),
+             entry.last_write_time().time_since_epoch().count()}
+        );
+    }
+
+    std::sort(files.begin(), files.end(), [](const auto& lhs, const auto& rhs) {
+        return lhs.relative < rhs.relative;
+    });
+
+    return files;
+}
+
+/**
+ * Hash a file with blocking reads.
+ *
+ * @returns nothing if the file could not be read whole.
+ */
+std::optional<std::uint64_t>
+hash_blocking(const InstanceFile& file, std::vector<char>& buffer, HashStats& stats)
+{
+    std::ifstream in(file.path, std::ifstream::in | std::ifstream::binary);
+    if (!in)
+        return std::nullopt;
+
+    auto hash = FNV1A_OFFSET;
+
+    for (std::uint64_t left = file.size; left > 0;) {
+        const auto size = static_cast<std::size_t>(
+            std::min<std::uint64_t>(left, buffer.size())
+        );
+
+        in.read(buffer.data(), static_cast<std::streamsize>(size));
+        if (static_cast<std::size_t>(in.gcount()) != size)
+            return std::nullopt;
+
+        hash = fnv1a({buffer.data(), size}, hash);
+        stats.bytes_read += size;
+        left -= size;
+    }
+
+    return hash;
+}
+
+#if IO_URING()
+
+/**
+ * An io_uring instance, set up with system calls as plain reads need nothing
+ * from liburing.
+ */
+class Ring {
+    int fd_ = -1;
+    std::array<std::pair<void*, std::size_t>, 3> maps_{};
+
+    unsigned* sq_tail_ = nullptr;
+    unsigned* sq_mask_ = nullptr;
+    unsigned* sq_array_ = nullptr;
+    io_uring_sqe* sqes_ = nullptr;
+
+    unsigned* cq_head_ = nullptr;
+    unsigned* cq_tail_ = nullptr;
+    unsigned* cq_mask_ = nullptr;
+    io_uring_cqe* cqes_ = nullptr;
+
+    std::vector<char> buffers_;
+    unsigned queued_ = 0; ///< Reads not submitted yet
+
+    /**
+     * Map part of the ring.
+     */
+    void*
+    map(std::size_t idx, std::size_t size, off_t offset)
+    {
+        const int prot = PROT_READ | PROT_WRITE;
+        void* ptr = mmap(nullptr, size, prot, MAP_SHARED | MAP_POPULATE, fd_, offset);
+        if (ptr == MAP_FAILED) // NOLINT(*-cstyle-cast,performance-no-int-to-ptr)
+            throw std::system_error(errno, std::system_category(), "io_uring mmap");
+
+        maps_.at(idx) = {ptr, size};
+        return ptr;
+    }
+
+    template <typename T>
+    static T*
+    at(void* base, std::uint32_t offset)
+    {
+        // NOLINTNEXTLINE(*-reinterpret-cast,*-pointer-arithmetic)
+        return reinterpret_cast<T*>(static_cast<char*>(base) + offset);
+    }
+
+    void
+    close() noexcept
+    {
+        for (const auto& [ptr, size] : maps_) {
+            if (ptr != nullptr)
+                munmap(ptr, size);
+        }
+        if (fd_ >= 0)
+            ::close(fd_);
+    }
+
+public:
+    /**
+     * Set up a ring with room for `QUEUE_DEPTH` reads.
+     *
+     * @throws std::system_error if the kernel does not allow io_uring.
+     */
+    Ring()
+    {
+        io_uring_params params{};
+        fd_ = static_cast<int>(syscall(__NR_io_uring_setup, QUEUE_DEPTH, &params));
+        if (fd_ < 0)
+            throw std::system_error(errno, std::system_category(), "io_uring_setup");
+
+        try {
+            // IORING_OP_READ came with this, in Linux 5.6
+            if ((params.features & IORING_FEAT_RW_CUR_POS) == 0) {
+                throw std::system_error(
+                    std::make_error_code(std::errc::function_not_supported),
+                    "io_uring reads"
+                );
+            }
+
+            auto* sq = map(
+                0,
+                params.sq_off.array + params.sq_entries * sizeof(unsigned),
+                IORING_OFF_SQ_RING
+            );
+            auto* cq = map(
+                1,
+                params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe),
+                IORING_OFF_CQ_RING
+            );
+            auto* sqes =
+                map(2, params.sq_entries * sizeof(io_uring_sqe), IORING_OFF_SQES);
+
+            sq_tail_ = at<unsigned>(sq, params.sq_off.tail);
+            sq_mask_ = at<unsigned>(sq, params.sq_off.ring_mask);
+            sq_array_ = at<unsigned>(sq, params.sq_off.array);
+            sqes_ = static_cast<io_uring_sqe*>(sqes);
+
+            cq_head_ = at<unsigned>(cq, params.cq_off.head);
+            cq_tail_ = at<unsigned>(cq, params.cq_off.tail);
+            cq_mask_ = at<unsigned>(cq, params.cq_off.ring_mask);
+            cqes_ = at<io_uring_cqe>(cq, params.cq_off.cqes);
+
+            buffers_.resize(std::size_t{QUEUE_DEPTH} * CHUNK_SIZE);
+        } catch (...) {
+            close();
+            throw;
+        }
+    }
+
+    ~Ring() { close(); }
+
+    Ring(const Ring&) = delete;
+    Ring(Ring&&) = delete;
+    Ring& operator=(const Ring&) = delete;
+    Ring& operator=(Ring&&) = delete;
+
+    /**
+     * Get one of the `QUEUE_DEPTH` buffers of `CHUNK_SIZE` bytes.
+     */
+    [[nodiscard]] char*
+    buffer(unsigned idx) noexcept
+    {
+        return &buffers_[std::size_t{idx} * CHUNK_SIZE];
+    }
+
+    /**
+     * Queue a read into a buffer, submitted on the next `wait`.
+     *
+     * @param skip Bytes at the start of the buffer to leave as they are.
+     */
+    void
+    read(
+        int file,
+        unsigned buffer,
+        std::uint32_t size,
+        std::uint64_t offset,
+        std::uint32_t skip = 0
+    )
+    {
+        const auto tail = std::atomic_ref(*sq_tail_).load(std::memory_order_relaxed);
+        const auto idx = tail & *sq_mask_;
+
+        auto& sqe = sqes_[idx]; // NOLINT(*-pointer-arithmetic)
+        sqe = {};
+        sqe.opcode = IORING_OP_READ;
+        sqe.fd = file;
+        // NOLINTNEXTLINE(*-reinterpret-cast,*-pointer-arithmetic)
+        sqe.addr = reinterpret_cast<std::uintptr_t>(this->buffer(buffer) + skip);
+        sqe.len = size;
+        sqe.off = offset;
+        sqe.user_data = buffer;
+
+        sq_array_[idx] = idx; // NOLINT(*-pointer-arithmetic)
+        std::atomic_ref(*sq_tail_).store(tail + 1, std::memory_order_release);
+        ++queued_;
+    }
+
+    /**
+     * Submit queued reads, and wait for at least one read to complete.
+     *
+     * @param done Called with the buffer and result of every completed read.
+     *
+     * @throws std::system_error if reads can not be submitted, which only
+     *         happens on bugs as the queue never overflows.
+     */
+    template <typename Func>
+    void
+    wait(Func&& done)
+    {
+        for (;;) {
+            const auto submitted = syscall(
+                __NR_io_uring_enter, fd_, queued_, 1, IORING_ENTER_GETEVENTS, nullptr, 0
+            );
+            if (submitted >= 0) {
+                queued_ -= static_cast<unsigned>(submitted);
+                break;
+            }
+            if (errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+                throw std::system_error(
+                    errno, std::system_category(), "io_uring_enter"
+                );
+            }
+        }
+
+        auto head = std::atomic_ref(*cq_head_).load(std::memory_order_relaxed);
+        const auto tail = std::atomic_ref(*cq_tail_).load(std::memory_order_acquire);
+
+        for (; head != tail; ++head) {
+            const auto& cqe = cqes_[head & *cq_mask_]; // NOLINT(*-pointer-arithmetic)
+            done(static_cast<unsigned>(cqe.user_data), cqe.res);
+        }
+
+        std::atomic_ref(*cq_head_).store(head, std::memory_order_release);
+    }
+};
+
+/**
+ * Hash files with reads batched through a ring.
+ *
+ * Chunks are hashed in order as they arrive, while later chunks and other
+ * files are still being read.
+ */
+void
+hash_with_ring(
+    Ring& ring,
+    std::vector<HashJob>& jobs,
+    std::atomic<std::size_t>& next,
+    HashStats& stats
+)
+{
+    struct Chunk {
+        int fd = -1;
+        std::uint64_t offset = 0;
+        std::uint32_t size = 0;
+        std::uint32_t filled = 0;
+        bool done = false;
+    };
+
+    struct OpenFile {
+        HashJob* job = nullptr;
+        int fd = -1;
+        std::uint64_t queued = 0;
+        std::uint64_t hash = FNV1A_OFFSET;
+        bool failed = false;
+        std::deque<unsigned> chunks; ///< In the order of the file
+    };
+
+    std::array<Chunk, QUEUE_DEPTH> chunks{};
+    std::array<OpenFile, OPEN_FILES> files{};
+
+    // Close what is still open if waiting for reads throws
+    struct CloseFiles {
+        std::array<OpenFile, OPEN_FILES>& files;
+
+        ~CloseFiles()
+        {
+            for (const auto& file : files) {
+                if (file.fd >= 0)
+                    ::close(file.fd);
+            }
+        }
+    } const close_files{files};
+
+    std::vector<unsigned> free(QUEUE_DEPTH);
+    std::iota(free.begin(), free.end(), 0);
+    std::vector<unsigned> retries;
+
+    bool more = true;
+    unsigned in_flight = 0;
+
+    // Take the next job, finishing those that need no reads
+    const auto open_next = [&](OpenFile& file) {
+        for (auto idx = next++; idx < jobs.size(); idx = next++) {
+            auto& job = jobs[idx];
+
+            if (job.file->size == 0) {
+                job.hash = FNV1A_OFFSET;
+                ++stats.read;
+                continue;
+            }
+
+            const int fd = ::open(job.file->path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0) {
+                ++stats.failed;
+                continue;
+            }
+
+            file = {};
+            file.job = &job;
+            file.fd = fd;
+            return true;
+        }
+
+        more = false;
+        return false;
+    };
+
+    for (;;) {
+        // Queue reads of open files first, opening more once they are queued
+        while (!free.empty()) {
+            auto file = std::find_if(files.begin(), files.end(), [](auto& open) {
+                return open.fd >= 0 && !open.failed
+                       && open.queued < open.job->file->size;
+            });
+
+            if (file == files.end()) {
+                file = std::find_if(files.begin(), files.end(), [](auto& slot) {
+                    return slot.fd < 0;
+                });
+                if (!more || file == files.end() || !open_next(*file))
+                    break;
+            }
+
+            const auto buffer = free.back();
+            free.pop_back();
+
+            const auto left = file->job->file->size - file->queued;
+            const auto size =
+                static_cast<std::uint32_t>(std::min<std::uint64_t>(CHUNK_SIZE, left));
+            ring.read(file->fd, buffer, size, file->queued);
+
+            chunks.at(buffer) = {file->fd, file->queued, size};
+            file->chunks.push_back(buffer);
+            file->queued += size;
+            ++in_flight;
+        }
+
+        if (in_flight == 0)
+            break;
+
+        ring.wait([&](unsigned buffer, int result) {
+            auto& chunk = chunks.at(buffer);
+
+            // Buffered reads may stop short, so read the rest of the chunk
+            // until the file ends early or fails
+            if (result > 0) {
+                chunk.filled += static_cast<std::uint32_t>(result);
+                if (chunk.filled < chunk.size) {
+                    retries.push_back(buffer);
+                    return;
+                }
+            }
+
+            chunk.done = true;
+            --in_flight;
+        });
+
+        for (const auto buffer : retries) {
+            const auto& chunk = chunks.at(buffer);
+            ring.read(
+                chunk.fd,
+                buffer,
+                chunk.size - chunk.filled,
+                chunk.offset + chunk.filled,
+                chunk.filled
+            );
+        }
+        retries.clear();
+
+        // Hash what arrived, as far as it goes in order
+        for (auto& file : files) {
+            if (file.fd < 0)
+                continue;
+
+            while (!file.chunks.empty() && chunks.at(file.chunks.front()).done) {
+                const auto buffer = file.chunks.front();
+                const auto& chunk = chunks.at(buffer);
+
+                // Missing bytes mean the file shrank since it was listed
+                if (chunk.filled != chunk.size)
+                    file.failed = true;
+
+                if (!file.failed) {
+                    file.hash = fnv1a({ring.buffer(buffer), chunk.size}, file.hash);
+                    stats.bytes_read += chunk.size;
+                }
+
+                file.chunks.pop_front();
+                free.push_back(buffer);
+            }
+
+            const bool finished =
+                file.chunks.empty()
+                && (file.failed || file.queued == file.job->file->size);
+            if (!finished)
+                continue;
+
+            if (file.failed) {
+                ++stats.failed;
+            }
+            else {
+                file.job->hash = file.hash;
+                ++stats.read;
+            }
+
+            ::close(file.fd);
+            file.fd = -1;
+        }
+    }
+}
+
+#else
+
+/// Never set up without io_uring
+class Ring {};
+
+void
+hash_with_ring(Ring&, std::vector<HashJob>&, std::atomic<std::size_t>&, HashStats&)
+{}
+
+#endif
+
+/**
+ * Set up a ring for a worker.
+ *
+ * @returns nothing if io_uring is not available.
+ */
+std::unique_ptr<Ring>
+open_ring()
+{
+#if IO_URING()
+    try {
+        return std::make_unique<Ring>();
+    } catch (const std::system_error& err) {
+        log_w(packs, "Reading files without io_uring: {}", err.what());
+    }
+#endif
+
+    return nullptr;
+}
+
+/**
+ * Hash files in parallel.
+ */
+void
+hash_files(
+    std::vector<HashJob>& jobs, unsigned threads, ReadBackend backend, HashStats& stats
+)
+{
+    // The first ring tells if the kernel allows io_uring at all
+    auto first_ring = backend == ReadBackend::blocking ? nullptr : open_ring();
+    stats.backend = first_ring ? ReadBackend::io_uring : ReadBackend::blocking;
+
+    if (backend == ReadBackend::io_uring && !first_ring)
+        throw PackError("io_uring reads are not available");
+
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = static_cast<unsigned>(std::min<std::size_t>(threads, jobs.size()));
+
+    std::atomic<std::size_t> next{0};
+    std::exception_ptr error;
+    std::mutex mutex;
+
+    auto work = [&](std::unique_ptr<Ring> ring) {
+        HashStats partial;
+
+        try {
+            if (!ring && stats.backend == ReadBackend::io_uring)
+                ring = open_ring();
+
+            if (ring) {
+                hash_with_ring(*ring, jobs, next, partial);
+            }
+            else {
+                std::vector<char> buffer(CHUNK_SIZE);
+
+                for (auto idx = next++; idx < jobs.size(); idx = next++) {
+                    jobs[idx].hash = hash_blocking(*jobs[idx].file, buffer, partial);
+                    ++(jobs[idx].hash ? partial.read : partial.failed);
+                }
+            }
+        } catch (...) {
+            const std::lock_guard lock(mutex);
+            if (!error)
+                error = std::current_exception();
+        }
+
+        const std::lock_guard lock(mutex);
+        stats.read += partial.read;
+        stats.failed += partial.failed;
+        stats.bytes_read += partial.bytes_read;
+    };
+
+    {
+        std::vector<std::jthread> workers;
+        workers.reserve(threads);
+
+        for (unsigned idx = 1; idx < threads; ++idx)
+            workers.emplace_back(work, nullptr);
+
+        work(std::move(first_ring));
+    }
+
+    if (error)
+        std::rethrow_exception(error);
+}
+
+/**
+ * Hash files of an instance, reading only those not in the cache.
+ *
+ * @returns The hash of each file, or nothing if it could not be read whole.
+ */
+std::vector<std::optional<std::uint64_t>>
+hash_instance_files(
+    const std::vector<const InstanceFile*>& files,
+    PackCache& cache,
+    HashStats& stats,
+    unsigned threads,
+    ReadBackend backend
+)
+{
+    std::vector<std::optional<std::uint64_t>> hashes(files.size());
+    std::vector<HashJob> jobs;
+
+    for (std::size_t idx = 0; idx < files.size(); ++idx) {
+        const auto& file = *files[idx];
+
+        hashes[idx] = cache.content_hash(file.path, file.time, file.size);
+        if (hashes[idx])
+            ++stats.unchanged;
+        else
+            jobs.push_back({&file, idx});
+    }
+
+    if (jobs.empty())
+        return hashes;
+
+    hash_files(jobs, threads, backend, stats);
+
+    for (const auto& job : jobs) {
+        hashes[job.index] = job.hash;
+
+        if (job.hash) {
+            const auto& file = *job.file;
+            cache.set_content_hash(file.path, file.time, file.size, *job.hash);
+        }
+    }
+
+    return hashes;
+}
+
+/**
+ * Parse a number of a manifest line.
+ */
+std::uint64_t
+parse_number(std::string_view str, std::string_view line)
+{
+    std::uint64_t value = 0;
+
+    const auto [end, err] = std::from_chars(str.data(), str.data() + str.size(), value);
+    if (err != std::errc() || end != str.data() + str.size())
+        throw PackError(fmt::format("malformed manifest line '{}'", line));
+
+    return value;
+}
+
+} // namespace
+
+namespace krompir {
+namespace packs {
+
+Manifest
+read_manifest(std::istream& in)
+{
+    Manifest manifest;
+
+    std::string line;
+    if (!std::getline(in, line) || line != MANIFEST_HEADER)
+        throw PackError("not a manifest, or from another version");
+
+    // A line per file, with the size, hash and escaped path separated by tabs
+    while (std::getline(in, line)) {
+        auto fields = read_fields(line);
+        if (fields.size() != 3 || fields[2].empty())
+            throw PackError(fmt::format("malformed manifest line '{}'", line));
+
+        ManifestFile file;
+        file.size = parse_number(fields[0], line);
+        file.hash = parse_number(fields[1], line);
+        file.path = std::move(fields[2]);
+
+        manifest.files.push_back(std::move(file));
+    }
+
+    std::sort(
+        manifest.files.begin(),
+        manifest.files.end(),
+        [](const auto& lhs, const auto& rhs) { return lhs.path < rhs.path; }
+    );
+
+    return manifest;
+}
+
+void
+write_manifest(const Manifest& manifest, std::ostream& out)
+{
+    out << MANIFEST_HEADER;
+
+    for (const auto& file : manifest.files) {
+        write_field(out, std::to_string(file.size), '\n');
+        write_field(out, std::to_string(file.hash));
+        write_field(out, file.path);
+    }
+
+    out << '\n';
+}
+
+std::string_view
+backend_name(ReadBackend backend)
+{
+    switch (backend) {
+        case ReadBackend::automatic:
+            return "automatic";
+        case ReadBackend::io_uring:
+            return "io_uring";
+        case ReadBackend::blocking:
+            return "blocking";
+    }
+
+    return "unknown";
+}
+
+Manifest
+build_manifest(
+    const std::filesystem::path& root,
+    PackCache& cache,
+    HashStats& stats,
+    unsigned threads,
+    ReadBackend backend
+)
+{
+    const auto files = list_instance(instance_root(root));
+
+    std::vector<const InstanceFile*> pointers;
+    pointers.reserve(files.size());
+    for (const auto& file : files)
+        pointers.push_back(&file);
+
+    const auto hashes = hash_instance_files(pointers, cache, stats, threads, backend);
+
+    Manifest manifest;
+    manifest.files.reserve(files.size());
+
+    for (std::size_t idx = 0; idx < files.size(); ++idx) {
+        if (!hashes[idx])
+            throw PackError(fmt::format("failed to read {}", files[idx].path.string()));
+
+        manifest.files.push_back({files[idx].relative, files[idx].size, *hashes[idx]});
+    }
+
+    return manifest;
+}
+
+VerifyReport
+verify_instance(
+    const std::filesystem::path& root,
+    const Manifest& manifest,
+    PackCache& cache,
+    unsigned threads,
+    ReadBackend backend
+)
+{
+    const auto start = std::chrono::steady_clock::now();
+
+    VerifyReport report;
+    const auto files = list_instance(instance_root(root));
+
+    // Both are sorted by path, so a single merge matches them up
+    std::vector<const InstanceFile*> to_hash;
+    std::vector<const ManifestFile*> expected;
+
+    auto lhs = manifest.files.begin();
+    auto rhs = files.begin();
+
+    while (lhs != manifest.files.end() || rhs != files.end()) {
+        const bool missing = lhs != manifest.files.end()
+                             && (rhs == files.end() || lhs->path < rhs->relative);
+
+        if (missing) {
+            report.missing.push_back((lhs++)->path);
+        }
+        else if (lhs == manifest.files.end() || rhs->relative < lhs->path) {
+            report.extra.push_back((rhs++)->relative);
+        }
+        else {
+            // Files of another size are corrupt without reading them
+            if (lhs->size != rhs->size) {
+                report.corrupt.push_back(rhs->relative);
+            }
+            else {
+                to_hash.push_back(&*rhs);
+                expected.push_back(&*lhs);
+            }
+
+            ++lhs;
+            ++rhs;
+        }
+    }
+
+    const auto hashes =
+        hash_instance_files(to_hash, cache, report.stats, threads, backend);
+
+    for (std::size_t idx = 0; idx < to_hash.size(); ++idx) {
+        if (hashes[idx] == expected[idx]->hash)
+            ++report.intact;
+        else
+            report.corrupt.push_back(to_hash[idx]->relative);
+    }
+
+    std::sort(report.corrupt.begin(), report.corrupt.end());
+
+    log_i(
+        packs,
+        "Verified {} in {}: {} intact, {} missing, {} extra and {} corrupt files, "
+        "{} read and {} unreadable with {}",
+        root,
+        std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start
+        ),
+        report.intact,
+        report.missing.size(),
+        report.extra.size(),
+        report.corrupt.size(),
+        report.stats.read,
+        report.stats.failed,
+        backend_name(report.stats.backend)
+    );
+
+    return report;
+}
+
+} // namespace packs
+} // namespace krompir
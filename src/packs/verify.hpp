@@ -0,0 +1,150 @@
+/**
+ * @file verify.hpp
+ * @brief Check an installed instance against a manifest of its files.
+ * @copyright MIT
+ *
+ * A manifest lists the size and content hash of every file of an instance,
+ * with the same hashes as the pack cache. Verifying an instance lists its
+ * files, compares sizes, and only reads the files whose size and modification
+ * time are not already in the pack cache.
+ *
+ * Files are read in chunks, many at a time, and hashed as chunks arrive while
+ * the next ones are still being read. On Linux reads are batched through
+ * io_uring, with a ring per worker thread. Elsewhere, or when the kernel does
+ * not allow io_uring, every worker reads its files with blocking reads.
+ */
+#pragma once
+
+#include "packs/pack.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <iosfwd>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace krompir {
+namespace packs {
+
+/**
+ * A file of an instance, as it should be.
+ */
+struct ManifestFile {
+    std::string path; ///< Relative to the instance, with `/` separators
+    std::uint64_t size = 0;
+    std::uint64_t hash = 0; ///< Of the content, like `PackEntry::hash`
+};
+
+/**
+ * The files of an instance, sorted by path.
+ */
+struct Manifest {
+    std::vector<ManifestFile> files;
+};
+
+/**
+ * Read a saved manifest.
+ *
+ * @throws PackError if the manifest is malformed.
+ */
+Manifest read_manifest(std::istream& in);
+
+/**
+ * Save a manifest.
+ */
+void write_manifest(const Manifest& manifest, std::ostream& out);
+
+/**
+ * How files are read.
+ */
+enum class ReadBackend : std::uint8_t {
+    automatic, ///< io_uring if available, or blocking reads
+    io_uring,  ///< Batched reads, only on Linux, or fail
+    blocking,  ///< A blocking read per chunk
+};
+
+/**
+ * Get the name of a backend.
+ */
+std::string_view backend_name(ReadBackend backend);
+
+/**
+ * How much work hashing an instance took.
+ */
+struct HashStats {
+    std::size_t unchanged = 0; ///< Files whose hash was in the cache
+    std::size_t read = 0;      ///< Files read and hashed
+    std::size_t failed = 0;    ///< Files that could not be opened or read whole
+    std::uint64_t bytes_read = 0;
+    ReadBackend backend = ReadBackend::blocking; ///< What read the files
+};
+
+/**
+ * Hash every file of an instance.
+ *
+ * Skips the same files as `load_pack`.
+ *
+ * @param root The instance folder.
+ * @param cache Hashes of files, kept between calls.
+ * @param stats Where to count the work done.
+ * @param threads Number of worker threads, or 0 to pick one per core.
+ * @param backend How to read files.
+ *
+ * @throws std::filesystem::filesystem_error if the folder can not be listed.
+ * @throws PackError if a file can not be read, or if `backend` is io_uring and
+ *         io_uring is not available.
+ */
+Manifest build_manifest(
+    const std::filesystem::path& root,
+    PackCache& cache,
+    HashStats& stats,
+    unsigned threads = 0,
+    ReadBackend backend = ReadBackend::automatic
+);
+
+/**
+ * How an instance differs from its manifest.
+ */
+struct VerifyReport {
+    std::vector<std::string> missing; ///< In the manifest, not the instance
+    std::vector<std::string> extra;   ///< In the instance, not the manifest
+    std::vector<std::string> corrupt; ///< Different size or content
+    std::size_t intact = 0;
+    HashStats stats;
+
+    /**
+     * Check if every file of the manifest is there and intact.
+     */
+    [[nodiscard]] bool
+    ok() const noexcept
+    {
+        return missing.empty() && corrupt.empty();
+    }
+};
+
+/**
+ * Check an instance against its manifest.
+ *
+ * Files that change or can not be read while verifying are corrupt.
+ *
+ * @param root The instance folder.
+ * @param manifest The files that should be there.
+ * @param cache Hashes of files, kept between calls.
+ * @param threads Number of worker threads, or 0 to pick one per core.
+ * @param backend How to read files.
+ *
+ * @throws std::filesystem::filesystem_error if the folder can not be listed.
+ * @throws PackError if `backend` is io_uring and io_uring is not available.
+ */
+VerifyReport verify_instance(
+    const std::filesystem::path& root,
+    const Manifest& manifest,
+    PackCache& cache,
+    unsigned threads = 0,
+    ReadBackend backend = ReadBackend::automatic
+);
+
+} // namespace packs
+} // namespace krompir
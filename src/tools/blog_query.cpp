@@ -0,0 +1,144 @@
+/**
+ * @file blog_query.cpp
+ * @brief Print the events of an indexed binary log by time, severity and category.
+ * @copyright MIT
+ *
+ * Unlike binlog's `bread`, this only decodes the blocks of the log that may
+ * contain matching events.
+ */
+#include "common.hpp"
+#include "logging_index.hpp"
+
+#include <argparse/argparse.hpp>
+
+#include <array>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+namespace {
+
+/**
+ * Parse a local time such as `2023-07-01 13:37:00` to nanoseconds since the epoch.
+ */
+std::int64_t
+parse_time(const std::string& str)
+{
+    constexpr std::int64_t NS_PER_SEC = 1'000'000'000;
+
+    std::tm time{};
+    std::istringstream stream(str);
+    stream >> std::get_time(&time, "%Y-%m-%d %H:%M:%S");
+
+    if (stream.fail())
+        throw std::runtime_error("invalid time '" + str + "', use YYYY-MM-DD HH:MM:SS");
+
+    time.tm_isdst = -1;
+    return static_cast<std::int64_t>(std::mktime(&time)) * NS_PER_SEC;
+}
+
+/**
+ * Parse the name of a severity.
+ */
+binlog::Severity
+parse_severity(const std::string& str)
+{
+    constexpr std::array SEVERITIES = {
+        std::pair{"trace", binlog::Severity::trace},
+        std::pair{"debug", binlog::Severity::debug},
+        std::pair{"info", binlog::Severity::info},
+        std::pair{"warning", binlog::Severity::warning},
+        std::pair{"error", binlog::Severity::error},
+        std::pair{"critical", binlog::Severity::critical},
+    };
+
+    for (const auto& [name, severity] : SEVERITIES) {
+        if (str == name)
+            return severity;
+    }
+
+    throw std::runtime_error("invalid severity '" + str + "'");
+}
+
+} // namespace
+
+int
+main(int argc, char* argv[])
+{
+    argparse::ArgumentParser program(
+        "krompir-blogq", KROMPIR_VERSION, argparse::default_arguments::help
+    );
+
+    krompir::logging::BlogQuery query;
+    bool show_stats = false;
+
+    program.add_argument("log")
+        .help("the binary log to query, indexed while it was written")
+        .default_value(std::string("krompir.blog"))
+        .nargs(argparse::nargs_pattern::optional);
+
+    program.add_argument("-f", "--from")
+        .help("only print events from this local time on (YYYY-MM-DD HH:MM:SS)")
+        .action([&](const std::string& value) { query.from_ns = parse_time(value); })
+        .metavar("TIME");
+
+    program.add_argument("-t", "--to")
+        .help("only print events up to this local time (YYYY-MM-DD HH:MM:SS)")
+        .action([&](const std::string& value) { query.to_ns = parse_time(value); })
+        .metavar("TIME");
+
+    program.add_argument("-s", "--severity")
+        .help("only print events of at least this severity (trace ... critical)")
+        .action([&](const std::string& value) {
+            query.min_severity = parse_severity(value);
+        })
+        .metavar("LEVEL");
+
+    program.add_argument("-c", "--category")
+        .help("only print events of this category, may be given more than once")
+        .action([&](const std::string& value) { query.categories.push_back(value); })
+        .append()
+        .metavar("NAME");
+
+    program.add_argument("--stats")
+        .help("print how much of the log had to be read")
+        .action([&](const auto& /* unused */) { show_stats = true; })
+        .default_value(false)
+        .implicit_value(true)
+        .nargs(0);
+
+    try {
+        program.parse_args(argc, argv);
+    } catch (const std::runtime_error& err) {
+        std::cerr << err.what() << std::endl;
+        std::cerr << program;
+        return 1;
+    }
+
+    const auto log = program.get<std::string>("log");
+
+    try {
+        const auto result = krompir::logging::query_blog(log, query, std::cout);
+
+        if (show_stats) {
+            fmt::print(
+                stderr,
+                "Read {} of {} blocks ({} bytes), {} events matched\n",
+                result.blocks_read,
+                result.blocks,
+                result.bytes_read,
+                result.events_matched
+            );
+        }
+    } catch (const std::exception& err) {
+        std::cerr << err.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
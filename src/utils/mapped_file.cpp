@@ -0,0 +1,178 @@
+#include "mapped_file.hpp"
+
+#include <system_error>
+#include <utility>
+
+#ifdef _WIN32
+#  ifndef WIN32_LEAN_AND_MEAN
+#    define WIN32_LEAN_AND_MEAN
+#  endif
+#  ifndef NOMINMAX
+#    define NOMINMAX
+#  endif
+#  include <windows.h>
+#else
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+
+#  include <cerrno>
+#endif
+
+namespace krompir {
+namespace utils {
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const std::filesystem::path& path, Access access)
+{
+    const DWORD flags = access == Access::sequential ? FILE_FLAG_SEQUENTIAL_SCAN
+                                                     : FILE_FLAG_RANDOM_ACCESS;
+
+    file_ = CreateFileW(
+        path.c_str(),
+        GENERIC_READ,
+        FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+        nullptr,
+        OPEN_EXISTING,
+        flags,
+        nullptr
+    );
+    if (file_ == INVALID_HANDLE_VALUE) {
+        file_ = nullptr;
+        throw std::system_error(
+            static_cast<int>(GetLastError()), std::system_category(), path.string()
+        );
+    }
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file_, &size)) {
+        const auto err = static_cast<int>(GetLastError());
+        close_();
+        throw std::system_error(err, std::system_category(), path.string());
+    }
+
+    size_ = static_cast<std::size_t>(size.QuadPart);
+    if (size_ == 0)
+        return;
+
+    mapping_ = CreateFileMappingW(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping_ == nullptr) {
+        const auto err = static_cast<int>(GetLastError());
+        close_();
+        throw std::system_error(err, std::system_category(), path.string());
+    }
+
+    data_ = static_cast<const char*>(MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+    if (data_ == nullptr) {
+        const auto err = static_cast<int>(GetLastError());
+        close_();
+        throw std::system_error(err, std::system_category(), path.string());
+    }
+}
+
+void
+MappedFile::close_() noexcept
+{
+    if (data_ != nullptr)
+        UnmapViewOfFile(data_);
+    if (mapping_ != nullptr)
+        CloseHandle(mapping_);
+    if (file_ != nullptr)
+        CloseHandle(file_);
+
+    data_ = nullptr;
+    mapping_ = nullptr;
+    file_ = nullptr;
+    size_ = 0;
+}
+
+#else
+
+MappedFile::MappedFile(const std::filesystem::path& path, Access access)
+{
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC); // NOLINT
+    if (fd < 0)
+        throw std::system_error(errno, std::generic_category(), path.string());
+
+    struct stat info {};
+
+    if (::fstat(fd, &info) != 0) {
+        const int err = errno;
+        ::close(fd);
+        throw std::system_error(err, std::generic_category(), path.string());
+    }
+
+    size_ = static_cast<std::size_t>(info.st_size);
+    if (size_ == 0) {
+        ::close(fd);
+        return;
+    }
+
+    void* data = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    const int err = errno;
+
+    // The mapping keeps its own reference to the file
+    ::close(fd);
+
+    if (data == MAP_FAILED) { // NOLINT(*-cstyle-cast, performance-no-int-to-ptr)
+        size_ = 0;
+        throw std::system_error(err, std::generic_category(), path.string());
+    }
+
+    ::madvise(
+        data,
+        size_,
+        access == Access::sequential ? MADV_SEQUENTIAL : MADV_RANDOM
+    );
+
+    data_ = static_cast<const char*>(data);
+}
+
+void
+MappedFile::close_() noexcept
+{
+    if (data_ != nullptr)
+        ::munmap(const_cast<char*>(data_), size_); // NOLINT(*-const-cast)
+
+    data_ = nullptr;
+    size_ = 0;
+}
+
+#endif
+
+MappedFile::MappedFile(MappedFile&& other) noexcept :
+    data_(std::exchange(other.data_, nullptr)),
+    size_(std::exchange(other.size_, 0))
+#ifdef _WIN32
+    ,
+    file_(std::exchange(other.file_, nullptr)),
+    mapping_(std::exchange(other.mapping_, nullptr))
+#endif
+{}
+
+MappedFile&
+MappedFile::operator=(MappedFile&& other) noexcept
+{
+    if (this != &other) {
+        close_();
+
+        data_ = std::exchange(other.data_, nullptr);
+        size_ = std::exchange(other.size_, 0);
+#ifdef _WIN32
+        file_ = std::exchange(other.file_, nullptr);
+        mapping_ = std::exchange(other.mapping_, nullptr);
+#endif
+    }
+
+    return *this;
+}
+
+MappedFile::~MappedFile()
+{
+    close_();
+}
+
+} // namespace utils
+} // namespace krompir
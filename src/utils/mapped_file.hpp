@@ -0,0 +1,83 @@
+/**
+ * @file mapped_file.hpp
+ * @brief Read-only memory mapped files.
+ * @copyright MIT
+ */
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <string_view>
+
+namespace krompir {
+namespace utils {
+
+/**
+ * A read-only memory mapping of a whole file.
+ *
+ * Large inputs (logs, region files) are mapped instead of read so that the OS
+ * can page them in on demand and we never hold a second copy in memory.
+ */
+class MappedFile {
+public:
+    /**
+     * How the mapping is going to be accessed, passed on to the OS as a hint.
+     */
+    enum class Access { sequential, random };
+
+private:
+    const char* data_ = nullptr;
+    std::size_t size_ = 0;
+
+#ifdef _WIN32
+    void* file_ = nullptr;
+    void* mapping_ = nullptr;
+#endif
+
+    /**
+     * Unmap the file and close any handles.
+     */
+    void close_() noexcept;
+
+public:
+    /**
+     * Map a file into memory.
+     *
+     * @param path The file to map.
+     * @param access The expected access pattern.
+     *
+     * @throws std::system_error if the file cannot be opened or mapped.
+     */
+    explicit MappedFile(
+        const std::filesystem::path& path, Access access = Access::sequential
+    );
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    ~MappedFile();
+
+    /**
+     * Get the contents of the file.
+     */
+    [[nodiscard]] std::string_view
+    view() const noexcept
+    {
+        return {data_, size_};
+    }
+
+    /**
+     * Get the size of the file, in bytes.
+     */
+    [[nodiscard]] std::size_t
+    size() const noexcept
+    {
+        return size_;
+    }
+};
+
+} // namespace utils
+} // namespace krompir
@@ -0,0 +1,208 @@
+/**
+ * @file strings.hpp
+ * @brief String helpers shared by the parsers.
+ * @copyright MIT
+ */
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <string_view>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#  include <emmintrin.h>
+#  define KROMPIR_HAVE_SSE2 1 // NOLINT(cppcoreguidelines-macro-usage)
+#else
+#  define KROMPIR_HAVE_SSE2 0 // NOLINT(cppcoreguidelines-macro-usage)
+#endif
+
+namespace krompir {
+namespace utils {
+
+/**
+ * Hash for `std::string` keyed containers that allows lookups by `string_view`.
+ */
+struct StringHash {
+    using is_transparent = void;
+
+    std::size_t
+    operator()(std::string_view str) const noexcept
+    {
+        return std::hash<std::string_view>{}(str);
+    }
+};
+
+/**
+ * Check if a character is ASCII whitespace.
+ */
+constexpr bool
+is_space(char chr) noexcept
+{
+    return chr == ' ' || chr == '\t' || chr == '\r' || chr == '\n' || chr == '\f'
+           || chr == '\v';
+}
+
+/**
+ * Remove leading whitespace.
+ */
+constexpr std::string_view
+trim_left(std::string_view str) noexcept
+{
+    while (!str.empty() && is_space(str.front()))
+        str.remove_prefix(1);
+    return str;
+}
+
+/**
+ * Remove trailing whitespace.
+ */
+constexpr std::string_view
+trim_right(std::string_view str) noexcept
+{
+    while (!str.empty() && is_space(str.back()))
+        str.remove_suffix(1);
+    return str;
+}
+
+/**
+ * Remove leading and trailing whitespace.
+ */
+constexpr std::string_view
+trim(std::string_view str) noexcept
+{
+    return trim_right(trim_left(str));
+}
+
+/// The hash of nothing, with 64-bit FNV-1a
+constexpr std::uint64_t FNV1A_OFFSET = 0xcbf29ce484222325;
+
+/**
+ * Hash a string with 64-bit FNV-1a, which is stable between builds.
+ *
+ * @param hash The hash of whatever came before `str`, to hash data in pieces.
+ */
+constexpr std::uint64_t
+fnv1a(std::string_view str, std::uint64_t hash = FNV1A_OFFSET) noexcept
+{
+    constexpr std::uint64_t FNV_PRIME = 0x100000001b3;
+
+    for (const char chr : str) {
+        hash ^= static_cast<unsigned char>(chr);
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+/**
+ * Match a path against a glob pattern.
+ *
+ * `?` matches any character and `*` any run of characters, except `/`.
+ * `**` matches across directories, and `**` followed by `/` also matches none.
+ */
+constexpr bool
+glob_match(std::string_view pattern, std::string_view str) noexcept
+{
+    while (!pattern.empty()) {
+        if (pattern.starts_with("**")) {
+            pattern.remove_prefix(2);
+
+            if (pattern.starts_with('/') && glob_match(pattern.substr(1), str))
+                return true;
+
+            for (std::size_t idx = 0; idx <= str.size(); ++idx) {
+                if (glob_match(pattern, str.substr(idx)))
+                    return true;
+            }
+            return false;
+        }
+
+        if (pattern.front() == '*') {
+            pattern.remove_prefix(1);
+
+            for (std::size_t idx = 0; idx <= str.size(); ++idx) {
+                if (glob_match(pattern, str.substr(idx)))
+                    return true;
+                if (idx < str.size() && str[idx] == '/')
+                    return false;
+            }
+            return false;
+        }
+
+        if (str.empty())
+            return false;
+
+        const bool any = pattern.front() == '?' && str.front() != '/';
+        if (!any && pattern.front() != str.front())
+            return false;
+
+        pattern.remove_prefix(1);
+        str.remove_prefix(1);
+    }
+
+    return str.empty();
+}
+
+/**
+ * Call `func` with every line of `text`, without the line terminator.
+ *
+ * Newlines are located 16 bytes at a time with SSE2 where available, falling
+ * back to `memchr` for the tail. A trailing `\r` is stripped from each line.
+ */
+template <typename Func>
+void
+for_each_line(std::string_view text, Func&& func)
+{
+    const char* line = text.data();
+    const char* pos = text.data();
+    const char* const end = text.data() + text.size(); // NOLINT(*-pointer-arithmetic)
+
+    auto emit = [&](const char* newline) {
+        std::string_view str(line, static_cast<std::size_t>(newline - line));
+        if (!str.empty() && str.back() == '\r')
+            str.remove_suffix(1);
+
+        func(str);
+        if (newline != end)
+            line = newline + 1; // NOLINT(*-pointer-arithmetic)
+    };
+
+    // NOLINTBEGIN(*-pointer-arithmetic, *-reinterpret-cast)
+#if KROMPIR_HAVE_SSE2
+    constexpr std::ptrdiff_t BLOCK = sizeof(__m128i);
+    const __m128i newlines = _mm_set1_epi8('\n');
+
+    for (; end - pos >= BLOCK; pos += BLOCK) {
+        const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pos));
+        auto mask = static_cast<unsigned>(
+            _mm_movemask_epi8(_mm_cmpeq_epi8(block, newlines))
+        );
+
+        while (mask != 0) {
+            emit(pos + std::countr_zero(mask));
+            mask &= mask - 1;
+        }
+    }
+#endif
+
+    while (pos < end) {
+        const auto* newline = static_cast<const char*>(
+            std::memchr(pos, '\n', static_cast<std::size_t>(end - pos))
+        );
+        if (newline == nullptr)
+            break;
+
+        emit(newline);
+        pos = line;
+    }
+    // NOLINTEND(*-pointer-arithmetic, *-reinterpret-cast)
+
+    if (line < end)
+        emit(end);
+}
+
+} // namespace utils
+} // namespace krompir
@@ -0,0 +1,221 @@
+#include "nbt.hpp"
+
+#include <cstring>
+
+namespace {
+
+using krompir::world::NbtError;
+using krompir::world::StringCallback;
+using krompir::world::TagType;
+
+// Same nesting limit as the game itself
+constexpr int MAX_DEPTH = 512;
+
+/**
+ * Walks NBT in place, bounds checking every read.
+ */
+class Walker {
+    const unsigned char* pos_;
+    const unsigned char* end_;
+    const StringCallback& callback_;
+
+    void
+    need_(std::size_t size) const
+    {
+        if (static_cast<std::size_t>(end_ - pos_) < size)
+            throw NbtError("unexpected end of NBT data");
+    }
+
+    void
+    skip_(std::size_t size)
+    {
+        need_(size);
+        pos_ += size; // NOLINT(*-pointer-arithmetic)
+    }
+
+    std::uint8_t
+    u8_()
+    {
+        need_(1);
+        return *pos_++; // NOLINT(*-pointer-arithmetic)
+    }
+
+    std::uint16_t
+    u16_()
+    {
+        need_(2);
+        // NOLINTNEXTLINE(*-pointer-arithmetic)
+        const auto value = static_cast<std::uint16_t>((pos_[0] << 8u) | pos_[1]);
+        pos_ += 2; // NOLINT(*-pointer-arithmetic)
+        return value;
+    }
+
+    std::size_t
+    length_()
+    {
+        need_(4);
+        // NOLINTBEGIN(*-pointer-arithmetic)
+        const auto value = static_cast<std::int32_t>(
+            (std::uint32_t{pos_[0]} << 24u) | (std::uint32_t{pos_[1]} << 16u)
+            | (std::uint32_t{pos_[2]} << 8u) | std::uint32_t{pos_[3]}
+        );
+        pos_ += 4;
+        // NOLINTEND(*-pointer-arithmetic)
+
+        if (value < 0)
+            throw NbtError("negative NBT length");
+        return static_cast<std::size_t>(value);
+    }
+
+    std::string_view
+    string_()
+    {
+        const std::size_t size = u16_();
+        need_(size);
+
+        // NOLINTNEXTLINE(*-reinterpret-cast)
+        const std::string_view str(reinterpret_cast<const char*>(pos_), size);
+        pos_ += size; // NOLINT(*-pointer-arithmetic)
+        return str;
+    }
+
+    /**
+     * Skip `count` elements of an array, checking for overflow.
+     */
+    void
+    skip_array_(std::size_t count, std::size_t element_size)
+    {
+        if (count > static_cast<std::size_t>(end_ - pos_) / element_size)
+            throw NbtError("unexpected end of NBT data");
+        skip_(count * element_size);
+    }
+
+    void
+    payload_(TagType type, std::string_view context, int depth)
+    {
+        if (depth > MAX_DEPTH)
+            throw NbtError("NBT nested too deeply");
+
+        switch (type) {
+            case TagType::byte:
+                skip_(1);
+                break;
+            case TagType::short_:
+                skip_(2);
+                break;
+            case TagType::int_:
+            case TagType::float_:
+                skip_(4);
+                break;
+            case TagType::long_:
+            case TagType::double_:
+                skip_(8);
+                break;
+            case TagType::byte_array:
+                skip_array_(length_(), 1);
+                break;
+            case TagType::int_array:
+                skip_array_(length_(), 4);
+                break;
+            case TagType::long_array:
+                skip_array_(length_(), 8);
+                break;
+            case TagType::string:
+                skip_(u16_());
+                break;
+            case TagType::list:
+                list_(context, depth);
+                break;
+            case TagType::compound:
+                compound_(context, depth);
+                break;
+            case TagType::end:
+            default:
+                throw NbtError("invalid NBT tag type");
+        }
+    }
+
+    void
+    list_(std::string_view context, int depth)
+    {
+        const auto type = static_cast<TagType>(u8_());
+        const std::size_t count = length_();
+
+        switch (type) {
+            // Fixed size elements can be skipped in one go
+            case TagType::end:
+                break;
+            case TagType::byte:
+                skip_array_(count, 1);
+                break;
+            case TagType::short_:
+                skip_array_(count, 2);
+                break;
+            case TagType::int_:
+            case TagType::float_:
+                skip_array_(count, 4);
+                break;
+            case TagType::long_:
+            case TagType::double_:
+                skip_array_(count, 8);
+                break;
+
+            // Elements of a list inherit its name as their context
+            default:
+                for (std::size_t idx = 0; idx < count; ++idx)
+                    payload_(type, context, depth + 1);
+                break;
+        }
+    }
+
+    void
+    compound_(std::string_view context, int depth)
+    {
+        for (;;) {
+            const auto type = static_cast<TagType>(u8_());
+            if (type == TagType::end)
+                return;
+
+            const auto name = string_();
+
+            if (type == TagType::string)
+                callback_(name, string_(), context);
+            else
+                payload_(type, name, depth + 1);
+        }
+    }
+
+public:
+    Walker(std::string_view data, const StringCallback& callback) :
+        // NOLINTBEGIN(*-reinterpret-cast, *-pointer-arithmetic)
+        pos_(reinterpret_cast<const unsigned char*>(data.data())),
+        end_(pos_ + data.size()),
+        // NOLINTEND(*-reinterpret-cast, *-pointer-arithmetic)
+        callback_(callback)
+    {}
+
+    void
+    root()
+    {
+        const auto type = static_cast<TagType>(u8_());
+        if (type == TagType::end)
+            return;
+
+        const auto name = string_();
+        payload_(type, name, 0);
+    }
+};
+
+} // namespace
+
+namespace krompir {
+namespace world {
+
+void
+walk_strings(std::string_view data, const StringCallback& callback)
+{
+    Walker(data, callback).root();
+}
+
+} // namespace world
+} // namespace krompir
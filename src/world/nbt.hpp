@@ -0,0 +1,69 @@
+/**
+ * @file nbt.hpp
+ * @brief Lazy, zero-copy walking of binary NBT.
+ * @copyright MIT
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <stdexcept>
+#include <string_view>
+
+namespace krompir {
+namespace world {
+
+/**
+ * NBT tag types, as stored on disk.
+ */
+enum class TagType : std::uint8_t {
+    end = 0,
+    byte = 1,
+    short_ = 2,
+    int_ = 3,
+    long_ = 4,
+    float_ = 5,
+    double_ = 6,
+    byte_array = 7,
+    string = 8,
+    list = 9,
+    compound = 10,
+    int_array = 11,
+    long_array = 12,
+};
+
+/**
+ * Thrown when NBT data is truncated or malformed.
+ */
+class NbtError : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
+
+/**
+ * Called for every string tag inside a compound.
+ *
+ * @param name The name of the tag.
+ * @param value The value of the tag.
+ * @param context The name of the closest named compound or list enclosing the
+ *                tag, e.g. `palette` for the entries of a block palette.
+ */
+using StringCallback = std::function<
+    void(std::string_view name, std::string_view value, std::string_view context)>;
+
+/**
+ * Walk an uncompressed NBT document, reporting its string tags.
+ *
+ * No tree is built: numbers and arrays are skipped over by length, and the
+ * views passed to `callback` point straight into `data`.
+ *
+ * @param data The uncompressed NBT, starting with the root tag.
+ * @param callback Called for every string tag that is a member of a compound.
+ *
+ * @throws NbtError if the data is malformed.
+ */
+void walk_strings(std::string_view data, const StringCallback& callback);
+
+} // namespace world
+} // namespace krompir
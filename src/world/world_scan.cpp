@@ -0,0 +1,528 @@
+#include "world_scan.hpp"
+
+#include "logging.hpp"
+#include "memory/alloc_tracker.hpp"
+#include "metrics/metrics.hpp"
+#include "utils/mapped_file.hpp"
+#include "world/nbt.hpp"
+
+#include <fmt/core.h>
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using krompir::world::UsageKind;
+using krompir::world::WorldUsage;
+
+// Anvil layout
+constexpr std::size_t SECTOR_SIZE = 4096;
+constexpr std::size_t CHUNKS_PER_REGION = 1024;
+constexpr std::size_t REGION_WIDTH = 32;
+constexpr std::size_t CHUNK_HEADER_SIZE = 5;
+constexpr std::uint8_t EXTERNAL_CHUNK = 0x80;
+
+// Chunk compression schemes
+constexpr std::uint8_t COMPRESSION_GZIP = 1;
+constexpr std::uint8_t COMPRESSION_ZLIB = 2;
+constexpr std::uint8_t COMPRESSION_NONE = 3;
+
+// Inflate buffers start at this size and double as needed...
+constexpr std::size_t INFLATE_INITIAL_SIZE = 256u << 10u;
+// ...but chunks bigger than this are skipped rather than held in memory
+constexpr std::size_t INFLATE_MAX_SIZE = 64u << 20u;
+
+std::uint32_t
+read_be32(const char* data)
+{
+    // NOLINTBEGIN(*-pointer-arithmetic)
+    const auto* bytes = reinterpret_cast<const unsigned char*>(data); // NOLINT
+    return (std::uint32_t{bytes[0]} << 24u) | (std::uint32_t{bytes[1]} << 16u)
+           | (std::uint32_t{bytes[2]} << 8u) | std::uint32_t{bytes[3]};
+    // NOLINTEND(*-pointer-arithmetic)
+}
+
+/**
+ * Check if `str` contains `needle`, ignoring ASCII case.
+ *
+ * @param needle A lowercase string.
+ */
+bool
+contains_icase(std::string_view str, std::string_view needle)
+{
+    if (needle.size() > str.size())
+        return false;
+
+    for (std::size_t start = 0; start + needle.size() <= str.size(); ++start) {
+        bool match = true;
+
+        for (std::size_t idx = 0; idx < needle.size() && match; ++idx) {
+            char chr = str[start + idx];
+            if (chr >= 'A' && chr <= 'Z')
+                chr = static_cast<char>(chr - 'A' + 'a');
+            match = chr == needle[idx];
+        }
+
+        if (match)
+            return true;
+    }
+
+    return false;
+}
+
+/**
+ * Work out what an ID is for from the name of the tag enclosing it.
+ */
+UsageKind
+classify(std::string_view context)
+{
+    if (contains_icase(context, "palette"))
+        return UsageKind::block;
+    if (contains_icase(context, "block_entit") || contains_icase(context, "tileentit"))
+        return UsageKind::block_entity;
+    if (contains_icase(context, "entit") || contains_icase(context, "passengers"))
+        return UsageKind::entity;
+    if (contains_icase(context, "item") || contains_icase(context, "inventory"))
+        return UsageKind::item;
+    return UsageKind::other;
+}
+
+/**
+ * Get the namespace of an ID such as `create:cogwheel`, if it is one.
+ */
+std::string_view
+id_namespace(std::string_view value)
+{
+    const auto colon = value.find(':');
+    if (colon == 0 || colon == std::string_view::npos || colon + 1 == value.size())
+        return {};
+
+    const auto ns = value.substr(0, colon);
+    const bool valid = std::all_of(ns.begin(), ns.end(), [](char chr) {
+        return (chr >= 'a' && chr <= 'z') || (chr >= '0' && chr <= '9') || chr == '_'
+               || chr == '-' || chr == '.';
+    });
+
+    return valid ? ns : std::string_view{};
+}
+
+/**
+ * A reusable zlib/gzip decompressor.
+ */
+class Inflater {
+    z_stream stream_{};
+    std::vector<char> buffer_;
+
+public:
+    Inflater()
+    {
+        // 15 bits of window, +32 to detect zlib and gzip headers
+        constexpr int WINDOW_BITS = 15 + 32;
+
+        if (inflateInit2(&stream_, WINDOW_BITS) != Z_OK)
+            throw std::runtime_error("failed to initialize zlib");
+    }
+
+    Inflater(const Inflater&) = delete;
+    Inflater& operator=(const Inflater&) = delete;
+    Inflater(Inflater&&) = delete;
+    Inflater& operator=(Inflater&&) = delete;
+
+    ~Inflater() { inflateEnd(&stream_); }
+
+    /**
+     * Decompress `input` into the internal buffer.
+     *
+     * @returns A view of the data, valid until the next call, or nothing if
+     *          `input` is corrupt or too big.
+     */
+    std::optional<std::string_view>
+    inflate(std::string_view input)
+    {
+        if (inflateReset(&stream_) != Z_OK)
+            return {};
+
+        if (buffer_.empty())
+            buffer_.resize(INFLATE_INITIAL_SIZE);
+
+        // NOLINTBEGIN(*-reinterpret-cast, *-const-cast, *-pointer-arithmetic)
+        stream_.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(input.data()));
+        stream_.avail_in = static_cast<uInt>(input.size());
+
+        std::size_t produced = 0;
+
+        for (;;) {
+            stream_.next_out = reinterpret_cast<Bytef*>(buffer_.data() + produced);
+            stream_.avail_out = static_cast<uInt>(buffer_.size() - produced);
+
+            const int ret = ::inflate(&stream_, Z_NO_FLUSH);
+            produced = buffer_.size() - stream_.avail_out;
+
+            if (ret == Z_STREAM_END)
+                return std::string_view(buffer_.data(), produced);
+            if (ret != Z_OK && ret != Z_BUF_ERROR)
+                return {};
+
+            if (stream_.avail_out != 0) {
+                // Ran out of input before the end of the stream
+                if (stream_.avail_in == 0)
+                    return {};
+                continue;
+            }
+
+            if (buffer_.size() >= INFLATE_MAX_SIZE)
+                return {};
+            buffer_.resize(buffer_.size() * 2);
+        }
+        // NOLINTEND(*-reinterpret-cast, *-const-cast, *-pointer-arithmetic)
+    }
+};
+
+/**
+ * Parse the region coordinates from a file name such as `r.-1.2.mca`.
+ */
+std::optional<std::pair<int, int>>
+region_coords(const std::filesystem::path& path)
+{
+    const auto name = path.stem().string();
+    if (!name.starts_with("r."))
+        return {};
+
+    const auto dot = name.find('.', 2);
+    if (dot == std::string::npos)
+        return {};
+
+    int region_x = 0;
+    int region_z = 0;
+
+    // NOLINTBEGIN(*-pointer-arithmetic)
+    const char* const begin = name.data();
+    const char* const end = name.data() + name.size();
+
+    if (std::from_chars(begin + 2, begin + dot, region_x).ec != std::errc{})
+        return {};
+    if (std::from_chars(begin + dot + 1, end, region_z).ec != std::errc{})
+        return {};
+    // NOLINTEND(*-pointer-arithmetic)
+
+    return std::pair{region_x, region_z};
+}
+
+/**
+ * Scans region files, holding on to buffers between them.
+ */
+class RegionScanner {
+    Inflater inflater_;
+
+    /**
+     * Read a chunk stored outside the region, in a `c.<x>.<z>.mcc` file.
+     */
+    std::optional<krompir::utils::MappedFile>
+    external_chunk_(const std::filesystem::path& region, std::size_t index)
+    {
+        const auto coords = region_coords(region);
+        if (!coords)
+            return {};
+
+        const auto chunk_x = coords->first * static_cast<int>(REGION_WIDTH)
+                             + static_cast<int>(index % REGION_WIDTH);
+        const auto chunk_z = coords->second * static_cast<int>(REGION_WIDTH)
+                             + static_cast<int>(index / REGION_WIDTH);
+
+        try {
+            return krompir::utils::MappedFile(
+                region.parent_path() / fmt::format("c.{}.{}.mcc", chunk_x, chunk_z)
+            );
+        } catch (const std::system_error&) {
+            return {};
+        }
+    }
+
+    /**
+     * Decompress and count one chunk.
+     *
+     * @returns If the chunk could be read.
+     */
+    bool
+    chunk_(std::string_view data, std::uint8_t compression, WorldUsage& usage)
+    {
+        std::optional<std::string_view> nbt;
+
+        switch (compression) {
+            case COMPRESSION_GZIP:
+            case COMPRESSION_ZLIB:
+                nbt = inflater_.inflate(data);
+                break;
+            case COMPRESSION_NONE:
+                nbt = data;
+                break;
+            default: // LZ4 and custom compression are not supported
+                return false;
+        }
+
+        if (!nbt)
+            return false;
+
+        try {
+            krompir::world::count_chunk(*nbt, usage);
+        } catch (const krompir::world::NbtError&) {
+            return false;
+        }
+
+        return true;
+    }
+
+public:
+    void
+    scan(const std::filesystem::path& path, WorldUsage& usage)
+    {
+        const krompir::utils::MappedFile file(path);
+        const auto region = file.view();
+
+        ++usage.regions;
+        usage.bytes += region.size();
+
+        if (region.size() < 2 * SECTOR_SIZE)
+            return;
+
+        for (std::size_t idx = 0; idx < CHUNKS_PER_REGION; ++idx) {
+            const auto location = read_be32(&region[idx * 4]);
+            if (location == 0)
+                continue;
+
+            ++usage.chunks;
+
+            const std::size_t offset = (location >> 8u) * SECTOR_SIZE;
+            if (offset < 2 * SECTOR_SIZE
+                || offset + CHUNK_HEADER_SIZE > region.size()) {
+                ++usage.chunks_skipped;
+                continue;
+            }
+
+            const std::size_t length = read_be32(&region[offset]);
+            const auto compression = static_cast<std::uint8_t>(region[offset + 4]);
+
+            bool read = false;
+
+            if ((compression & EXTERNAL_CHUNK) != 0) {
+                if (auto external = external_chunk_(path, idx)) {
+                    read = chunk_(
+                        external->view(),
+                        static_cast<std::uint8_t>(compression & ~EXTERNAL_CHUNK),
+                        usage
+                    );
+                }
+            }
+            else if (length > 0 && offset + 4 + length <= region.size()) {
+                read = chunk_(
+                    region.substr(offset + CHUNK_HEADER_SIZE, length - 1),
+                    compression,
+                    usage
+                );
+            }
+
+            if (!read)
+                ++usage.chunks_skipped;
+        }
+    }
+};
+
+/**
+ * Find all the region files of a world, largest first.
+ */
+std::vector<std::pair<std::uintmax_t, std::filesystem::path>>
+find_regions(const std::filesystem::path& world)
+{
+    std::vector<std::pair<std::uintmax_t, std::filesystem::path>> regions;
+
+    for (const auto& entry : std::filesystem::recursive_directory_iterator(world)) {
+        if (!entry.is_regular_file() || entry.path().extension() != ".mca")
+            continue;
+
+        // Points of interest only hold vanilla POI types
+        if (entry.path().parent_path().filename() == "poi")
+            continue;
+
+        regions.emplace_back(entry.file_size(), entry.path());
+    }
+
+    // Hand out the big ones first so that no thread is left with one at the end
+    std::sort(regions.begin(), regions.end(), std::greater<>{});
+    return regions;
+}
+
+} // namespace
+
+namespace krompir {
+namespace world {
+
+std::string_view
+usage_kind_name(UsageKind kind)
+{
+    switch (kind) {
+        case UsageKind::block:
+            return "block";
+        case UsageKind::block_entity:
+            return "block entity";
+        case UsageKind::entity:
+            return "entity";
+        case UsageKind::item:
+            return "item";
+        case UsageKind::other:
+        default:
+            return "other";
+    }
+}
+
+std::uint64_t
+NamespaceUsage::total() const
+{
+    std::uint64_t sum = 0;
+    for (const auto count : counts)
+        sum += count;
+    return sum;
+}
+
+void
+WorldUsage::merge(const WorldUsage& other)
+{
+    for (const auto& [name, usage] : other.namespaces) {
+        auto& ours = namespaces[name];
+
+        for (std::size_t idx = 0; idx < USAGE_KINDS; ++idx)
+            ours.counts.at(idx) += usage.counts.at(idx);
+    }
+
+    regions += other.regions;
+    chunks += other.chunks;
+    chunks_skipped += other.chunks_skipped;
+    bytes += other.bytes;
+}
+
+void
+count_chunk(std::string_view nbt, WorldUsage& usage)
+{
+    walk_strings(
+        nbt,
+        [&](std::string_view name, std::string_view value, std::string_view context) {
+            if (name != "id" && name != "Name")
+                return;
+
+            const auto kind = classify(context);
+
+            // Only palettes use "Name" for IDs
+            if (name == "Name" && kind != UsageKind::block)
+                return;
+
+            const auto ns = id_namespace(value);
+            if (ns.empty())
+                return;
+
+            auto iter = usage.namespaces.find(ns);
+            if (iter == usage.namespaces.end())
+                iter = usage.namespaces.emplace(ns, NamespaceUsage{}).first;
+
+            ++iter->second[kind];
+        }
+    );
+}
+
+void
+scan_region(const std::filesystem::path& path, WorldUsage& usage)
+{
+    RegionScanner().scan(path, usage);
+}
+
+WorldUsage
+scan_world(const std::filesystem::path& world, unsigned threads)
+{
+    const memory::AllocScope scope(memory::Subsystem::scanner);
+    const auto start = std::chrono::steady_clock::now();
+    const auto regions = find_regions(world);
+
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = static_cast<unsigned>(std::min<std::size_t>(threads, regions.size()));
+
+    static auto& region_time = metrics::histogram(
+        "krompir_world_region_scan_nanoseconds", "Time to scan one region file"
+    );
+
+    std::atomic<std::size_t> next{0};
+    std::mutex mutex;
+    WorldUsage total;
+
+    auto work = [&] {
+        const memory::AllocScope worker_scope(memory::Subsystem::scanner);
+        RegionScanner scanner;
+        WorldUsage usage;
+
+        for (auto idx = next++; idx < regions.size(); idx = next++) {
+            const metrics::ScopedTimer timer(region_time);
+
+            try {
+                scanner.scan(regions[idx].second, usage);
+            } catch (const std::system_error& err) {
+                log_w(
+                    world,
+                    "Failed to read region {}: {}",
+                    regions[idx].second,
+                    err.what()
+                );
+            }
+        }
+
+        const std::lock_guard lock(mutex);
+        total.merge(usage);
+    };
+
+    {
+        std::vector<std::jthread> workers;
+        workers.reserve(threads);
+
+        for (unsigned idx = 1; idx < threads; ++idx)
+            workers.emplace_back(work);
+
+        work();
+    }
+
+    static auto& regions_total =
+        metrics::counter("krompir_world_regions_total", "Region files scanned");
+    static auto& chunks_total =
+        metrics::counter("krompir_world_chunks_total", "Chunks found in region files");
+    static auto& bytes_total =
+        metrics::counter("krompir_world_bytes_total", "Bytes of region files scanned");
+
+    regions_total.add(total.regions);
+    chunks_total.add(total.chunks);
+    bytes_total.add(total.bytes);
+
+    log_i(
+        world,
+        "Scanned {} chunks in {} regions ({} bytes) in {}, {} skipped, {} namespaces",
+        total.chunks,
+        total.regions,
+        total.bytes,
+        std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start
+        ),
+        total.chunks_skipped,
+        total.namespaces.size()
+    );
+
+    return total;
+}
+
+} // namespace world
+} // namespace krompir
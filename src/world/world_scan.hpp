@@ -0,0 +1,113 @@
+/**
+ * @file world_scan.hpp
+ * @brief Audit which namespaces (mods) a world uses.
+ * @copyright MIT
+ */
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <string>
+#include <string_view>
+
+namespace krompir {
+namespace world {
+
+/**
+ * What kind of thing an ID was found on.
+ */
+enum class UsageKind : std::uint8_t { block, block_entity, entity, item, other };
+
+/**
+ * The number of different usage kinds.
+ */
+constexpr std::size_t USAGE_KINDS = 5;
+
+/**
+ * Get a human readable name for a usage kind.
+ */
+std::string_view usage_kind_name(UsageKind kind);
+
+/**
+ * How often the IDs of one namespace occur in a world.
+ *
+ * Blocks are counted once per chunk section whose palette contains them, not
+ * once per block.
+ */
+struct NamespaceUsage {
+    std::array<std::uint64_t, USAGE_KINDS> counts{};
+
+    std::uint64_t&
+    operator[](UsageKind kind)
+    {
+        return counts.at(static_cast<std::size_t>(kind));
+    }
+
+    std::uint64_t
+    operator[](UsageKind kind) const
+    {
+        return counts.at(static_cast<std::size_t>(kind));
+    }
+
+    /**
+     * Get the total number of uses, of any kind.
+     */
+    [[nodiscard]] std::uint64_t total() const;
+};
+
+/**
+ * Namespace usage aggregated over a set of chunks.
+ */
+struct WorldUsage {
+    std::map<std::string, NamespaceUsage, std::less<>> namespaces;
+
+    std::size_t regions = 0;
+    std::size_t chunks = 0;
+    std::size_t chunks_skipped = 0; ///< Corrupt, or in an unsupported compression
+    std::uint64_t bytes = 0;        ///< Size of the region files read
+
+    /**
+     * Add the counts from another scan to this one.
+     */
+    void merge(const WorldUsage& other);
+};
+
+/**
+ * Count the namespaced IDs in one chunk.
+ *
+ * @param nbt The uncompressed NBT of the chunk.
+ * @param usage Where to add the counts.
+ *
+ * @throws NbtError if the chunk is malformed.
+ */
+void count_chunk(std::string_view nbt, WorldUsage& usage);
+
+/**
+ * Count the namespaced IDs in every chunk of an Anvil region file.
+ *
+ * Corrupt chunks are skipped and counted in `WorldUsage::chunks_skipped`.
+ *
+ * @throws std::system_error if the file cannot be mapped.
+ */
+void scan_region(const std::filesystem::path& path, WorldUsage& usage);
+
+/**
+ * Count the namespaced IDs in every region file of a world, in parallel.
+ *
+ * Terrain and entity regions of all dimensions are included, points of
+ * interest are not. Each worker reuses a single decompression buffer, so
+ * memory use is bounded by the number of threads and not the world size.
+ *
+ * @param world The world (save) folder.
+ * @param threads Number of worker threads, or 0 to pick one per core.
+ *
+ * @throws std::filesystem::filesystem_error if the world cannot be listed.
+ */
+WorldUsage scan_world(const std::filesystem::path& world, unsigned threads = 0);
+
+} // namespace world
+} // namespace krompir
@@ -0,0 +1,98 @@
+#include "memory/alloc_tracker.hpp"
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <thread>
+#include <utility>
+
+using krompir::memory::AllocScope;
+using krompir::memory::Subsystem;
+
+namespace {
+
+constexpr std::size_t BLOCK_SIZE = 1000;
+
+/**
+ * Allocate a block in a subsystem, returning the counters of that subsystem
+ * before and while the block is live.
+ */
+std::pair<krompir::memory::AllocStats, krompir::memory::AllocStats>
+allocate_in(Subsystem subsystem, std::size_t align = alignof(std::max_align_t))
+{
+    const auto before = krompir::memory::alloc_snapshot()[subsystem];
+
+    void* block = nullptr;
+    {
+        const AllocScope scope(subsystem);
+        block = ::operator new(BLOCK_SIZE, std::align_val_t{align});
+    }
+
+    const auto during = krompir::memory::alloc_snapshot()[subsystem];
+
+    REQUIRE(reinterpret_cast<std::uintptr_t>(block) % align == 0); // NOLINT
+    ::operator delete(block, std::align_val_t{align});
+
+    return {before, during};
+}
+
+} // namespace
+
+TEST_CASE("Subsystems have names", "[memory]")
+{
+    CHECK(krompir::memory::subsystem_name(Subsystem::scanner) == "scanner");
+    CHECK(krompir::memory::subsystem_name(Subsystem::logging) == "logging");
+}
+
+TEST_CASE("Allocations are attributed to the tagged subsystem", "[memory]")
+{
+    const auto [before, during] = allocate_in(Subsystem::resolver);
+
+    if constexpr (!krompir::memory::tracking_enabled()) {
+        CHECK(during.allocations == 0);
+        CHECK(during.live_bytes == 0);
+        return;
+    }
+
+    CHECK(during.allocations == before.allocations + 1);
+    CHECK(during.bytes_allocated == before.bytes_allocated + BLOCK_SIZE);
+    CHECK(during.live_bytes == before.live_bytes + std::int64_t{BLOCK_SIZE});
+    CHECK(during.peak_bytes >= static_cast<std::uint64_t>(during.live_bytes));
+
+    const auto after = krompir::memory::alloc_snapshot()[Subsystem::resolver];
+    CHECK(after.frees == before.frees + 1);
+    CHECK(after.live_bytes == before.live_bytes);
+}
+
+TEST_CASE("Over-aligned allocations are tracked", "[memory]")
+{
+    constexpr std::size_t PAGE = 4096;
+
+    const auto [before, during] = allocate_in(Subsystem::scanner, PAGE);
+
+    if constexpr (krompir::memory::tracking_enabled())
+        CHECK(during.bytes_allocated == before.bytes_allocated + BLOCK_SIZE);
+}
+
+TEST_CASE("Counts survive the threads that made them", "[memory]")
+{
+    const auto before = krompir::memory::alloc_snapshot()[Subsystem::gui];
+
+    std::thread([] {
+        const AllocScope scope(Subsystem::gui);
+        const auto block = std::make_unique<char[]>(BLOCK_SIZE); // NOLINT
+    }).join();
+
+    const auto after = krompir::memory::alloc_snapshot()[Subsystem::gui];
+
+    if constexpr (krompir::memory::tracking_enabled()) {
+        CHECK(after.allocations == before.allocations + 1);
+        CHECK(after.live_bytes == before.live_bytes);
+    }
+    else {
+        CHECK(after.allocations == 0);
+    }
+}
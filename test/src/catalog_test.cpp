@@ -0,0 +1,162 @@
+#include "catalog/catalog.hpp"
+#include "test_files.hpp"
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <fmt/core.h>
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using krompir::catalog::Catalog;
+using krompir::catalog::CatalogQuery;
+using krompir::catalog::ProjectSource;
+using krompir::catalog::read_dump;
+using krompir::catalog::refresh_catalog;
+using krompir::catalog::write_catalog;
+using krompir::test::TempDir;
+
+namespace {
+
+/**
+ * Write a dump of generated projects, project N has N * 10 downloads.
+ */
+void
+write_dump(const std::filesystem::path& path, std::size_t count)
+{
+    std::ofstream out(path, std::ofstream::out | std::ofstream::binary);
+
+    for (std::size_t idx = 0; idx < count; ++idx) {
+        out << fmt::format(
+            R"({{"id": "p{0}", "slug": "mod-{0}", "title": "Mod {0}", )"
+            R"("summary": "Does \"thing\" {0}", "source": "{1}", )"
+            R"("downloads": {2}, "updated": 1700000000, "loaders": ["{3}"], )"
+            R"("game_versions": ["1.{4}"], "categories": ["{5}"]}})"
+            "\n",
+            idx,
+            idx % 2 == 0 ? "modrinth" : "curseforge",
+            idx * 10,
+            idx % 3 == 0 ? "fabric" : "forge",
+            16 + idx % 5,
+            // Only the last block has this category
+            idx >= count - 10 ? "rare" : "misc"
+        );
+    }
+}
+
+} // namespace
+
+TEST_CASE("Catalog snapshots are queried by column", "[catalog]")
+{
+    const TempDir root("krompir_catalog_test");
+
+    write_dump(root / "dump.jsonl", 3000);
+    const auto dump = read_dump(root / "dump.jsonl");
+    REQUIRE(dump.projects.size() == 3000);
+    CHECK(dump.projects[1].source == ProjectSource::curseforge);
+    CHECK(dump.projects[1].summary == "Does \"thing\" 1");
+
+    write_catalog(dump.projects, root / "catalog.bin", 100);
+    const Catalog catalog(root / "catalog.bin");
+    CHECK(catalog.size() == 3000);
+    CHECK(catalog.blocks().size() == 30);
+
+    CatalogQuery query;
+    query.loader = "fabric";
+    query.game_version = "1.16";
+    query.limit = 3;
+
+    auto result = catalog.query(query);
+    CHECK(result.matches == 200);
+    REQUIRE(result.projects.size() == 3);
+    CHECK(result.projects[0].id == "p2985");
+    CHECK(result.projects[1].id == "p2970");
+    CHECK(result.projects[0].loaders == std::vector<std::string>{"fabric"});
+    CHECK(result.projects[0].summary == "Does \"thing\" 2985");
+
+    query = {};
+    query.category = "rare";
+    result = catalog.query(query);
+    CHECK(result.matches == 10);
+    CHECK(result.blocks_skipped == 29);
+
+    query = {};
+    query.text = "MOD-12";
+    query.source = ProjectSource::modrinth;
+    query.min_downloads = 1250;
+    query.limit = 100;
+    result = catalog.query(query);
+    CHECK(result.matches == 52); // 126, 128, and even ones from 1200 to 1298
+    CHECK(result.projects.back().id == "p126");
+
+    // Columns kept for later queries stay within the budget
+    CHECK(catalog.cached_bytes() > 0);
+    const Catalog small(root / "catalog.bin", 4096);
+    CHECK(small.query(query).matches == 52);
+    CHECK(small.query(query).matches == 52);
+    CHECK(small.cached_bytes() > 0);
+    CHECK(small.cached_bytes() <= 4096);
+
+    query = {};
+    query.loader = "neoforge";
+    CHECK(catalog.query(query).matches == 0);
+
+    // Rows are decoded in the order asked for
+    const auto projects = catalog.decode(2, {7, 3, 7});
+    REQUIRE(projects.size() == 3);
+    CHECK(projects[0].id == "p207");
+    CHECK(projects[0].loaders == std::vector<std::string>{"fabric"});
+    CHECK(projects[1].id == "p203");
+    CHECK(projects[1].loaders == std::vector<std::string>{"forge"});
+    CHECK(projects[2].id == "p207");
+    CHECK(projects[2].loaders == std::vector<std::string>{"fabric"});
+}
+
+TEST_CASE("Catalog snapshots are refreshed with deltas", "[catalog]")
+{
+    const TempDir root("krompir_catalog_refresh_test");
+
+    write_dump(root / "dump.jsonl", 250);
+    write_catalog(read_dump(root / "dump.jsonl").projects, root / "old.bin", 100);
+
+    std::ofstream(root / "delta.jsonl")
+        << R"({"id": "p5", "slug": "mod-5", "title": "Renamed", "downloads": 1, )"
+           R"("loaders": ["neoforge"]})"
+           "\n"
+           R"({"id": "p6", "deleted": true})"
+           "\n"
+           R"({"id": "new", "slug": "new", "title": "New", "downloads": 99999})"
+           "\n";
+
+    const Catalog old_catalog(root / "old.bin");
+    const auto stats =
+        refresh_catalog(old_catalog, read_dump(root / "delta.jsonl"), root / "new.bin");
+
+    CHECK(stats.added == 1);
+    CHECK(stats.updated == 1);
+    CHECK(stats.removed == 1);
+    CHECK(stats.blocks_checked == 1); // Only the block of p5 and p6
+    CHECK(stats.blocks_copied == 1);
+    CHECK(stats.blocks_rewritten == 2);
+
+    const Catalog catalog(root / "new.bin");
+    CHECK(catalog.size() == 250);
+
+    CatalogQuery query;
+    query.loader = "neoforge";
+    auto result = catalog.query(query);
+    REQUIRE(result.matches == 1);
+    CHECK(result.projects[0].title == "Renamed");
+
+    query = {};
+    query.limit = 1;
+    result = catalog.query(query);
+    CHECK(result.matches == 250);
+    CHECK(result.projects[0].id == "new");
+
+    query = {};
+    query.text = "mod-6";
+    CHECK(catalog.query(query).matches == 10); // mod-6 itself was deleted
+}
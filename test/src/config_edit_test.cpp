@@ -0,0 +1,312 @@
+#include "configs/bulk_edit.hpp"
+#include "configs/document.hpp"
+#include "test_files.hpp"
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <filesystem>
+#include <string>
+
+using krompir::configs::ConfigDocument;
+using krompir::configs::ConfigError;
+using krompir::configs::ConfigFormat;
+using krompir::configs::ValueKind;
+using krompir::test::read_text;
+using krompir::test::TempDir;
+using krompir::test::write_text;
+
+namespace {
+
+/**
+ * Set one value of a document.
+ */
+std::string
+set_value(const ConfigDocument& document, std::string_view key, std::string_view value)
+{
+    const auto* entry = document.find(key);
+    REQUIRE(entry != nullptr);
+
+    return document.with_values({{entry, document.format_value(*entry, value)}});
+}
+
+} // namespace
+
+TEST_CASE("TOML values are found in tables and arrays of tables", "[configs]")
+{
+    const ConfigDocument document(
+        ConfigFormat::toml,
+        "# Client settings\n"
+        "[advanced]\n"
+        "\tcheatItemsEnabled = true # keep this\n"
+        "\tname = 'jei'\n"
+        "\"quoted key\".inner = [1, 2,\n 3]\n"
+        "[[layers]]\n"
+        "depth = 4\n"
+        "[[layers]]\n"
+        "depth = 8\n"
+    );
+
+    const auto* cheat = document.find("advanced.cheatItemsEnabled");
+    REQUIRE(cheat != nullptr);
+    CHECK(document.value(*cheat) == "true");
+    CHECK(cheat->kind == ValueKind::scalar);
+
+    const auto* name = document.find("advanced.name");
+    REQUIRE(name != nullptr);
+    CHECK(name->kind == ValueKind::string);
+
+    const auto* inner = document.find("advanced.quoted key.inner");
+    REQUIRE(inner != nullptr);
+    CHECK(document.value(*inner) == "[1, 2,\n 3]");
+    CHECK(inner->kind == ValueKind::container);
+    REQUIRE(document.find("advanced.quoted key.inner[2]") != nullptr);
+    CHECK(document.value(*document.find("advanced.quoted key.inner[2]")) == "3");
+
+    REQUIRE(document.find("layers[1].depth") != nullptr);
+    CHECK(document.value(*document.find("layers[1].depth")) == "8");
+
+    CHECK(
+        set_value(document, "advanced.cheatItemsEnabled", "false")
+        == "# Client settings\n"
+           "[advanced]\n"
+           "\tcheatItemsEnabled = false # keep this\n"
+           "\tname = 'jei'\n"
+           "\"quoted key\".inner = [1, 2,\n 3]\n"
+           "[[layers]]\n"
+           "depth = 4\n"
+           "[[layers]]\n"
+           "depth = 8\n"
+    );
+}
+
+TEST_CASE("TOML array elements and inline tables are edited in place", "[configs]")
+{
+    const ConfigDocument document(
+        ConfigFormat::toml,
+        "mods = [ # by ID\n"
+        "  'jei', \"emi\",\n"
+        "  [1, 2.5], # nested\n"
+        "]\n"
+        "point = { x = 1, y = \"two\", z.w = [true] }\n"
+    );
+
+    CHECK(document.string(*document.find("mods[1]")) == "emi");
+    CHECK(document.value(*document.find("mods[2][1]")) == "2.5");
+    CHECK(document.value(*document.find("point.x")) == "1");
+    CHECK(document.string(*document.find("point.y")) == "two");
+    CHECK(document.value(*document.find("point.z.w[0]")) == "true");
+    CHECK(document.find("mods[3]") == nullptr);
+
+    CHECK(
+        set_value(document, "mods[2][1]", "3")
+        == "mods = [ # by ID\n"
+           "  'jei', \"emi\",\n"
+           "  [1, 3], # nested\n"
+           "]\n"
+           "point = { x = 1, y = \"two\", z.w = [true] }\n"
+    );
+    CHECK(
+        set_value(document, "point.y", "three")
+        == "mods = [ # by ID\n"
+           "  'jei', \"emi\",\n"
+           "  [1, 2.5], # nested\n"
+           "]\n"
+           "point = { x = 1, y = \"three\", z.w = [true] }\n"
+    );
+
+    CHECK_THROWS_AS(ConfigDocument(ConfigFormat::toml, "a = [1, 2\n"), ConfigError);
+}
+
+TEST_CASE("Strings keep their quotes and are escaped", "[configs]")
+{
+    const ConfigDocument document(
+        ConfigFormat::toml, "literal = 'a'\nbasic = \"b\"\n"
+    );
+
+    CHECK(set_value(document, "literal", "c:d") == "literal = 'c:d'\nbasic = \"b\"\n");
+    CHECK(
+        set_value(document, "basic", "say \"hi\"")
+        == "literal = 'a'\nbasic = \"say \\\"hi\\\"\"\n"
+    );
+
+    CHECK(document.string(*document.find("literal")) == "a");
+
+    // Literal strings can not hold a quote
+    CHECK(
+        set_value(document, "literal", "it's") == "literal = \"it's\"\nbasic = \"b\"\n"
+    );
+}
+
+TEST_CASE("Unicode escapes are decoded to UTF-8", "[configs]")
+{
+    const ConfigDocument document(
+        ConfigFormat::json,
+        R"({"name": "Pok\u00e9mon \u2603", "emoji": "\ud83d\ude00\b\f", )"
+        R"("lone": "\ud83d!", "bad": "\u12"})"
+    );
+
+    CHECK(document.string(*document.find("name")) == "Pok\xc3\xa9mon \xe2\x98\x83");
+    CHECK(document.string(*document.find("emoji")) == "\xf0\x9f\x98\x80\b\f");
+    CHECK(document.string(*document.find("lone")) == "\xef\xbf\xbd!");
+    CHECK(document.string(*document.find("bad")) == "u12");
+
+    const ConfigDocument toml(ConfigFormat::toml, "emoji = \"\\U0001F600\"\n");
+    CHECK(toml.string(*toml.find("emoji")) == "\xf0\x9f\x98\x80");
+}
+
+TEST_CASE("JSON5 values are found and edited in place", "[configs]")
+{
+    const ConfigDocument document(
+        ConfigFormat::json,
+        "{\n"
+        "  // Rendering\n"
+        "  render: { distance: 12, fancy: true, },\n"
+        "  'list': [\"a\", \"b\"],\n"
+        "}\n"
+    );
+
+    REQUIRE(document.find("render") != nullptr);
+    CHECK(document.find("render")->kind == ValueKind::container);
+    CHECK(document.value(*document.find("render.distance")) == "12");
+    CHECK(document.value(*document.find("list[1]")) == "\"b\"");
+    CHECK(document.string(*document.find("list[1]")) == "b");
+
+    CHECK(
+        set_value(document, "render.distance", "8")
+        == "{\n"
+           "  // Rendering\n"
+           "  render: { distance: 8, fancy: true, },\n"
+           "  'list': [\"a\", \"b\"],\n"
+           "}\n"
+    );
+
+    // Only the first of overlapping edits is applied
+    std::size_t applied = 0;
+    CHECK(
+        document.with_values(
+            {{document.find("render.fancy"), "false"}, {document.find("render"), "{}"}},
+            &applied
+        )
+        == "{\n"
+           "  // Rendering\n"
+           "  render: { distance: 12, fancy: false, },\n"
+           "  'list': [\"a\", \"b\"],\n"
+           "}\n"
+    );
+    CHECK(applied == 1);
+
+    CHECK_THROWS_AS(ConfigDocument(ConfigFormat::json, "{\"a\": [1, 2}"), ConfigError);
+}
+
+TEST_CASE("Forge cfg and properties values are found", "[configs]")
+{
+    const ConfigDocument cfg(
+        ConfigFormat::cfg,
+        "# Configuration file\n"
+        "general {\n"
+        "    # Check for updates\n"
+        "    B:enableUpdateChecker=true\n"
+        "    S:blacklist <\n"
+        "        minecraft:stone\n"
+        "     >\n"
+        "}\n"
+    );
+
+    CHECK(cfg.value(*cfg.find("general.enableUpdateChecker")) == "true");
+    CHECK(cfg.find("general.blacklist")->kind == ValueKind::container);
+    CHECK(
+        set_value(cfg, "general.enableUpdateChecker", "false").find(
+            "B:enableUpdateChecker=false\n"
+        )
+        != std::string::npos
+    );
+
+    const ConfigDocument properties(
+        ConfigFormat::properties,
+        "# Server\n"
+        "! legacy comment\n"
+        "motd = A \\\n"
+        "   server\n"
+        "max-players:20\n"
+    );
+
+    CHECK(properties.value(*properties.find("max-players")) == "20");
+    CHECK(properties.find("motd") != nullptr);
+    CHECK(
+        set_value(properties, "max-players", "8")
+        == "# Server\n! legacy comment\nmotd = A \\\n   server\nmax-players:8\n"
+    );
+}
+
+TEST_CASE("Profiles are parsed line by line", "[configs]")
+{
+    const auto profile = krompir::configs::EditProfile::parse(
+        "# Defaults for every pack\n"
+        "\n"
+        "jei/jei-client.toml   advanced.cheatItemsEnabled = false\n"
+        "**.cfg general.motd = \"Hello = world\"\n"
+    );
+
+    REQUIRE(profile.edits.size() == 2);
+    CHECK(profile.edits[0].files == "jei/jei-client.toml");
+    CHECK(profile.edits[0].key == "advanced.cheatItemsEnabled");
+    CHECK(profile.edits[0].value == "false");
+    CHECK(profile.edits[1].value == "\"Hello = world\"");
+
+    CHECK_THROWS_AS(krompir::configs::EditProfile::parse("a.toml key"), ConfigError);
+}
+
+TEST_CASE("Profiles are applied to packs through the cache", "[configs]")
+{
+    const TempDir root("krompir_config_test");
+
+    const auto first = root / "first";
+    const auto second = root / "second";
+    const std::string toml = "[general]\nenabled = true # default\n";
+
+    write_text(first / "config" / "mod.toml", toml);
+    write_text(first / "config" / "other" / "server.properties", "max-players=20\n");
+    write_text(second / "config" / "mod.toml", toml);
+    write_text(second / "config" / "notes.txt", "enabled = true\n");
+
+    const auto profile = krompir::configs::EditProfile::parse(
+        "*.toml general.enabled = false\n"
+        "**.properties max-players = 20\n"
+        "*.toml general.missing = 1\n"
+    );
+
+    krompir::configs::ConfigCache cache;
+
+    const auto dry = krompir::configs::apply_profile(
+        {first, second}, profile, cache, {.dry_run = true, .threads = 2}
+    );
+
+    CHECK(dry.files == 3);
+    CHECK(dry.files_matched == 3);
+    CHECK(dry.files_changed == 2);
+    CHECK(dry.values_changed == 2);
+    CHECK(dry.cache.parsed == 2); // The two mod.toml files are identical
+    CHECK(dry.cache.shared == 1);
+    CHECK(dry.failures.empty());
+    CHECK(dry.unused_edits == std::vector<std::size_t>{2});
+    CHECK(read_text(first / "config" / "mod.toml") == toml);
+
+    const auto applied =
+        krompir::configs::apply_profile({first, second}, profile, cache);
+
+    CHECK(applied.files_changed == 2);
+    CHECK(applied.cache.unchanged == 3);
+    CHECK(applied.cache.parsed == 0);
+    CHECK(
+        read_text(second / "config" / "mod.toml")
+        == "[general]\nenabled = false # default\n"
+    );
+    const auto properties = first / "config" / "other" / "server.properties";
+    CHECK(read_text(properties) == "max-players=20\n");
+
+    // Everything is already set
+    const auto again = krompir::configs::apply_profile({first, second}, profile, cache);
+
+    CHECK(again.files_changed == 0);
+    CHECK(again.cache.unchanged == 3);
+}
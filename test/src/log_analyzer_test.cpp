@@ -0,0 +1,145 @@
+#include "analyze/log_analyzer.hpp"
+
+#include <catch2/catch_approx.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+#include <string>
+#include <string_view>
+
+using krompir::analyze::Analysis;
+using krompir::analyze::analyze_log;
+using krompir::analyze::ClassIndex;
+
+namespace {
+
+// A trimmed down Forge crash report
+constexpr const char* CRASH_REPORT =
+    "---- Minecraft Crash Report ----\n"
+    "Description: Ticking entity\n"
+    "\n"
+    "java.lang.NullPointerException: Cannot invoke \"Object.hashCode()\"\n"
+    "\tat net.minecraft.world.entity.Entity.handler$zbd000$sodium$tick(Entity.java:1)"
+    " ~[client-1.20.1.jar:?] {re:mixin,pl:mixin:APP:iris.mixins.json:EntityMixin}\n"
+    "\tat TRANSFORMER/create@0.5.1/com.simibubi.create.Contraption.tick(C.java:3)"
+    " ~[create-1.20.1-0.5.1.jar%2390!/:0.5.1]\n"
+    "\tat com.example.lib.Util.run(Util.java:3) ~[examplelib-1.0.jar:?]\n"
+    "\tat java.base/java.lang.Thread.run(Thread.java:833)\r\n"
+    "\n"
+    "Suspected Mods:\n"
+    "\tCreate (create), Version: 0.5.1\n"
+    "\t\tIssue tracker URL: https://github.com/Creators-of-Create/Create/issues\n"
+    "\n"
+    "[12:00:02] [main/ERROR] [mixin/]: Mixin apply for mod lithium failed\n"
+    "[12:00:03] [main/INFO] [minecraft/]: Stopping!\n";
+
+void
+require_same(const Analysis& lhs, const Analysis& rhs)
+{
+    REQUIRE(lhs.lines == rhs.lines);
+    REQUIRE(lhs.suspects.size() == rhs.suspects.size());
+
+    for (std::size_t idx = 0; idx < lhs.suspects.size(); ++idx) {
+        const auto& left = lhs.suspects[idx];
+        const auto& right = rhs.suspects[idx];
+
+        REQUIRE(left.mod == right.mod);
+        REQUIRE(left.score == Catch::Approx(right.score));
+        REQUIRE(left.frames == right.frames);
+        REQUIRE(left.mixins == right.mixins);
+        REQUIRE(left.mentions == right.mentions);
+    }
+}
+
+} // namespace
+
+TEST_CASE("Suspects are ranked by evidence", "[analyze]")
+{
+    const ClassIndex index;
+    const auto result = analyze_log(CRASH_REPORT, index, 1);
+
+    REQUIRE(result.lines == 15);
+    REQUIRE_FALSE(result.suspects.empty());
+    REQUIRE(result.suspects.front().mod == "create");
+    REQUIRE(result.suspects.front().frames == 1);
+    REQUIRE(result.suspects.front().mentions == 1);
+
+    for (const auto& suspect : result.suspects) {
+        REQUIRE(suspect.mod != "minecraft");
+        REQUIRE(suspect.mod != "java");
+        REQUIRE(suspect.mod != "client-1.20.1");
+    }
+}
+
+TEST_CASE("Mixins are attributed to their mods", "[analyze]")
+{
+    const ClassIndex index;
+    const auto result = analyze_log(CRASH_REPORT, index, 1);
+
+    auto find = [&](std::string_view mod) {
+        for (const auto& suspect : result.suspects) {
+            if (suspect.mod == mod)
+                return suspect.mixins;
+        }
+        return std::size_t{0};
+    };
+
+    REQUIRE(find("sodium") == 1);
+    REQUIRE(find("iris") == 1);
+    REQUIRE(find("lithium") == 1);
+}
+
+TEST_CASE("Class index maps classes back to mods", "[analyze]")
+{
+    ClassIndex index;
+    index.add("com.example.lib", "examplelib");
+    index.add("create.mixins.json", "create");
+
+    REQUIRE(index.find_class("com.example.lib.Util$Inner") == "examplelib");
+    REQUIRE(index.find_class("com.example.other.Util") == std::nullopt);
+    REQUIRE(index.find("create.mixins.json") == "create");
+
+    const auto result = analyze_log(CRASH_REPORT, index, 1);
+    auto iter = std::find_if(
+        result.suspects.begin(),
+        result.suspects.end(),
+        [](const auto& suspect) { return suspect.mod == "examplelib"; }
+    );
+
+    REQUIRE(iter != result.suspects.end());
+    REQUIRE(iter->frames == 1);
+}
+
+TEST_CASE("Results do not depend on the number of threads", "[analyze]")
+{
+    std::string log;
+    for (int i = 0; i < 100'000; ++i)
+        log += CRASH_REPORT;
+
+    const ClassIndex index;
+    require_same(analyze_log(log, index, 1), analyze_log(log, index, 8));
+}
+
+TEST_CASE("Traces and sections split between threads are scanned whole", "[analyze]")
+{
+    // Long enough that every split between 4 threads lands in one or the other
+    std::string log = "java.lang.IllegalStateException: Broken\n";
+    for (int i = 0; i < 300'000; ++i)
+        log += "\tat com.example.Foo.bar(Foo.java:1) ~[example-1.0.jar:?]\n";
+
+    log += "Suspected Mods:\n";
+    for (int i = 0; i < 600'000; ++i)
+        log += "\tCreate (create), Version: 0.5.1\n";
+
+    log += "\n[12:00:03] [main/ERROR] [lithium/]: Stopping!\n";
+
+    const ClassIndex index;
+    const auto single = analyze_log(log, index, 1);
+    require_same(single, analyze_log(log, index, 4));
+
+    REQUIRE(single.suspects.size() == 3);
+    REQUIRE(single.suspects[0].mod == "create");
+    REQUIRE(single.suspects[0].mentions == 600'000);
+    REQUIRE(single.suspects[1].mod == "example");
+    REQUIRE(single.suspects[1].frames == 300'000);
+}
@@ -0,0 +1,134 @@
+#include "logging_index.hpp"
+#include "test_files.hpp"
+
+#include <binlog/binlog.hpp>
+#include <binlog/Session.hpp>
+#include <binlog/SessionWriter.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <sstream>
+
+using krompir::logging::BlogQuery;
+using krompir::test::TempDir;
+
+namespace {
+
+/**
+ * Writes a binary log and its index, like the application sink.
+ */
+class IndexedLog {
+    std::ofstream log_;
+    std::ofstream index_;
+    std::ofstream meta_;
+    krompir::logging::detail::BlogIndexWriter writer_;
+
+public:
+    explicit IndexedLog(const std::filesystem::path& path) :
+        log_(path, std::ofstream::out | std::ofstream::binary),
+        index_(
+            krompir::logging::blog_index_path(path),
+            std::ofstream::out | std::ofstream::binary
+        ),
+        meta_(
+            krompir::logging::blog_meta_path(path),
+            std::ofstream::out | std::ofstream::binary
+        ),
+        writer_(index_, meta_)
+    {}
+
+    IndexedLog&
+    write(const char* data, std::streamsize size)
+    {
+        log_.write(data, size);
+        log_.flush();
+
+        writer_.write(data, size);
+        return *this;
+    }
+};
+
+/**
+ * Write a log where only rounds 5 and 6 contain errors.
+ */
+void
+write_log(const std::filesystem::path& path)
+{
+    binlog::Session session;
+    binlog::SessionWriter writer(session, 1u << 20u);
+    IndexedLog out(path);
+
+    for (int round = 0; round < 20; ++round) {
+        for (int idx = 0; idx < 2000; ++idx) {
+            if ((round == 5 || round == 6) && idx % 100 == 0)
+                BINLOG_ERROR_WC(writer, scanner, "Failed to scan {} in {}", idx, round);
+            else
+                BINLOG_INFO_WC(writer, gui, "Event {} of round {}", idx, round);
+        }
+
+        session.consume(out);
+    }
+}
+
+} // namespace
+
+TEST_CASE("Binary log queries only decode matching blocks", "[logging]")
+{
+    const TempDir dir("krompir_blog_test");
+
+    const auto path = dir / "test.blog";
+    write_log(path);
+
+    const auto blocks = krompir::logging::read_blog_index(path);
+    REQUIRE(blocks.size() >= 20);
+
+    std::uint64_t events = 0;
+    for (const auto& block : blocks)
+        events += block.events;
+    REQUIRE(events == 20 * 2000);
+
+    SECTION("by severity")
+    {
+        BlogQuery query;
+        query.min_severity = binlog::Severity::error;
+
+        std::ostringstream out;
+        const auto result = krompir::logging::query_blog(path, query, out);
+
+        REQUIRE(result.events_matched == 40);
+        REQUIRE(result.blocks_read < blocks.size() / 2);
+        REQUIRE(out.str().find("Failed to scan 100 in 5") != std::string::npos);
+    }
+
+    SECTION("by category")
+    {
+        BlogQuery query;
+        query.categories = {"scanner"};
+
+        std::ostringstream out;
+        const auto result = krompir::logging::query_blog(path, query, out);
+
+        REQUIRE(result.events_matched == 40);
+        REQUIRE(result.blocks_read < blocks.size() / 2);
+    }
+
+    SECTION("by time")
+    {
+        BlogQuery query;
+        query.from_ns = blocks.back().last_ns + 1;
+
+        std::ostringstream out;
+        const auto result = krompir::logging::query_blog(path, query, out);
+
+        REQUIRE(result.events_matched == 0);
+        REQUIRE(result.blocks_read == 0);
+
+        query.from_ns = blocks.front().first_ns;
+        query.to_ns = blocks.front().last_ns;
+
+        REQUIRE(krompir::logging::query_blog(path, query, out).events_matched > 0);
+    }
+}
@@ -0,0 +1,137 @@
+#include "logging.hpp"
+
+#include <binlog/binlog.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <cstddef>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+using krompir::logging::consume;
+using krompir::logging::queue_counts;
+using krompir::logging::release_thread_writer;
+
+namespace {
+
+/**
+ * Counts the events of one category in a binary log.
+ */
+class EventCounter {
+    std::string_view category_;
+    binlog::EventStream events_;
+
+public:
+    std::size_t count = 0;
+
+    explicit EventCounter(std::string_view category) : category_(category) {}
+
+    EventCounter&
+    write(const char* data, std::streamsize size)
+    {
+        const binlog::Range range{data, data + size}; // NOLINT(*-pointer-arithmetic)
+        binlog::RangeEntryStream entries(range);
+
+        while (const binlog::Event* event = events_.nextEvent(entries)) {
+            if (event->source->category == category_)
+                ++count;
+        }
+
+        return *this;
+    }
+};
+
+} // namespace
+
+TEST_CASE("Writers are opened on demand and released", "[logging]")
+{
+    EventCounter counter("writer_test");
+
+    release_thread_writer();
+    consume(counter);
+    const auto before = queue_counts();
+
+    log_i(writer_test, "Opens a writer");
+    CHECK(queue_counts().writers == before.writers + 1);
+
+    consume(counter);
+    CHECK(queue_counts().queues == before.queues + 1);
+
+    // The queue is closed, and freed by the next consume
+    release_thread_writer();
+    CHECK(queue_counts().writers == before.writers);
+
+    consume(counter);
+    CHECK(queue_counts().queues == before.queues);
+
+    log_i(writer_test, "Opens it again");
+    release_thread_writer();
+
+    consume(counter);
+    CHECK(counter.count == 2);
+    CHECK(queue_counts().queues == before.queues);
+}
+
+TEST_CASE("Queues that fill up before they are consumed are counted", "[logging]")
+{
+    // Every event takes more than a byte, so these can not fit in one queue
+    constexpr std::size_t EVENTS = KROMPIR_LOG_QUEUE_SIZE;
+
+    EventCounter counter("burst_test");
+
+    release_thread_writer();
+    consume(counter);
+    const auto before = queue_counts();
+
+    for (std::size_t event = 0; event < EVENTS; ++event)
+        log_i(burst_test, "Event {}", event);
+
+    consume(counter);
+    CHECK(counter.count == EVENTS);
+
+    // The full queues are drained and freed, the last one is still open
+    CHECK(queue_counts().queues_consumed >= before.queues + 2);
+    CHECK(queue_counts().queues == before.queues + 1);
+
+    release_thread_writer();
+    consume(counter);
+    CHECK(queue_counts().queues == before.queues);
+}
+
+TEST_CASE("Short-lived threads do not leak writers or lose events", "[logging]")
+{
+    constexpr std::size_t ROUNDS = 4;
+    constexpr std::size_t THREADS = 64;
+    constexpr std::size_t EVENTS = 500;
+
+    EventCounter counter("pool_test");
+
+    release_thread_writer();
+    consume(counter);
+    const auto before = queue_counts();
+
+    for (std::size_t round = 0; round < ROUNDS; ++round) {
+        {
+            std::vector<std::jthread> pool;
+            pool.reserve(THREADS);
+
+            // Far more events than fit in the initial queues
+            for (std::size_t idx = 0; idx < THREADS; ++idx) {
+                pool.emplace_back([idx] {
+                    for (std::size_t event = 0; event < EVENTS; ++event)
+                        log_i(pool_test, "Event {} of thread {}", event, idx);
+                });
+            }
+        }
+
+        CHECK(queue_counts().writers == before.writers);
+
+        // Every queue of the pool, grown or not, is freed once drained
+        consume(counter);
+        CHECK(queue_counts().queues_consumed >= before.queues + THREADS);
+        CHECK(queue_counts().queues == before.queues);
+    }
+
+    CHECK(counter.count == ROUNDS * THREADS * EVENTS);
+}
@@ -0,0 +1,145 @@
+#include "metrics/metrics.hpp"
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <cstdint>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using krompir::metrics::histogram_bucket;
+using krompir::metrics::histogram_bucket_max;
+using krompir::metrics::HISTOGRAM_BUCKETS;
+using krompir::metrics::Registry;
+using krompir::metrics::detail::SHARED_SHARD;
+using krompir::metrics::detail::thread_shard;
+
+TEST_CASE("Histogram buckets cover every value", "[metrics]")
+{
+    constexpr std::uint64_t MAX = std::numeric_limits<std::uint64_t>::max();
+
+    const std::vector<std::uint64_t> values = {0, 1, 31, 32, 1000, 1ULL << 40U, MAX};
+
+    for (const auto value : values) {
+        const auto bucket = histogram_bucket(value);
+
+        REQUIRE(bucket < HISTOGRAM_BUCKETS);
+        CHECK(histogram_bucket_max(bucket) >= value);
+
+        if (bucket > 0)
+            CHECK(histogram_bucket_max(bucket - 1) < value);
+    }
+
+    CHECK(histogram_bucket(MAX) == HISTOGRAM_BUCKETS - 1);
+}
+
+TEST_CASE("Counters merge the shards of every thread", "[metrics]")
+{
+    constexpr int THREADS = 8;
+    constexpr int ADDS = 10000;
+
+    Registry registry;
+    auto& counter = registry.counter("test_total", "A test counter");
+
+    {
+        std::vector<std::jthread> threads;
+        for (int idx = 0; idx < THREADS; ++idx) {
+            threads.emplace_back([&] {
+                for (int add = 0; add < ADDS; ++add)
+                    counter.add();
+            });
+        }
+    }
+
+    CHECK(counter.value() == THREADS * ADDS);
+    CHECK(&registry.counter("test_total", "A test counter") == &counter);
+    CHECK_THROWS_AS(registry.gauge("test_total", "A gauge"), std::invalid_argument);
+}
+
+TEST_CASE("Thread locals destroyed after the shard is released share", "[metrics]")
+{
+    Registry registry;
+    auto& counter = registry.counter("test_total", "A test counter");
+
+    /// Counts when its thread exits
+    struct CountOnExit {
+        krompir::metrics::Counter* counter = nullptr;
+        bool* shared = nullptr;
+
+        CountOnExit() = default;
+        CountOnExit(const CountOnExit&) = delete;
+        CountOnExit& operator=(const CountOnExit&) = delete;
+        CountOnExit(CountOnExit&&) = delete;
+        CountOnExit& operator=(CountOnExit&&) = delete;
+
+        ~CountOnExit()
+        {
+            *shared = thread_shard() == SHARED_SHARD;
+            counter->add();
+        }
+    };
+
+    bool owned = false;
+    bool shared = false;
+
+    std::thread([&] {
+        // Constructed before the shard is claimed, so destroyed after
+        thread_local CountOnExit on_exit;
+        on_exit.counter = &counter;
+        on_exit.shared = &shared;
+
+        owned = thread_shard() != SHARED_SHARD;
+        counter.add();
+    }).join();
+
+    CHECK(owned);
+    CHECK(shared);
+    CHECK(counter.value() == 2);
+}
+
+TEST_CASE("Histogram quantiles are within a bucket", "[metrics]")
+{
+    Registry registry;
+    auto& histogram = registry.histogram("test_nanoseconds", "A test histogram");
+
+    for (std::uint64_t value = 1; value <= 1000; ++value)
+        histogram.record(value);
+
+    const auto snapshot = histogram.snapshot();
+
+    CHECK(snapshot.count == 1000);
+    CHECK(snapshot.sum == 500500);
+    CHECK(snapshot.max == 1000);
+
+    // Buckets are at most 1/16 wide
+    CHECK(snapshot.quantile(0.5) >= 500);
+    CHECK(snapshot.quantile(0.5) <= 500 + 500 / 16);
+    CHECK(snapshot.quantile(1.0) == 1000);
+
+    auto merged = snapshot;
+    merged.merge(snapshot);
+    CHECK(merged.count == 2000);
+    CHECK(merged.quantile(0.5) == snapshot.quantile(0.5));
+}
+
+TEST_CASE("Snapshots are exported for Prometheus", "[metrics]")
+{
+    Registry registry;
+    registry.counter("test_total", "Things\ncounted").add(3);
+    registry.gauge("test_queue", "Queued things").set(-2);
+    registry.histogram("test_nanoseconds", "Latency").record(std::uint64_t{7});
+
+    std::ostringstream out;
+    krompir::metrics::write_prometheus(registry.snapshot(), out);
+
+    const auto text = out.str();
+
+    CHECK(text.find("# HELP test_total Things\\ncounted\n") != std::string::npos);
+    CHECK(text.find("# TYPE test_total counter\ntest_total 3\n") != std::string::npos);
+    CHECK(text.find("test_queue -2\n") != std::string::npos);
+    CHECK(text.find("test_nanoseconds_bucket{le=\"7\"} 1\n") != std::string::npos);
+    CHECK(text.find("test_nanoseconds_bucket{le=\"+Inf\"} 1\n") != std::string::npos);
+    CHECK(text.find("test_nanoseconds_sum 7\n") != std::string::npos);
+}
@@ -0,0 +1,189 @@
+#include "packs/pack.hpp"
+#include "packs/pack_diff.hpp"
+#include "test_files.hpp"
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <filesystem>
+#include <sstream>
+#include <string>
+
+using krompir::packs::PackCache;
+using krompir::packs::PackCacheStats;
+using krompir::packs::split_jar_name;
+using krompir::test::TempDir;
+using krompir::test::write_text;
+
+TEST_CASE("Mod IDs and versions are split from JAR names", "[packs]")
+{
+    CHECK(split_jar_name("jei-1.20.1-forge-15.2.0.27.jar").id == "jei");
+    CHECK(
+        split_jar_name("jei-1.20.1-forge-15.2.0.27.jar").version
+        == "1.20.1-forge-15.2.0.27"
+    );
+    CHECK(split_jar_name("Xaeros_Minimap_24.0.3_Forge.jar").id == "xaeros_minimap");
+    CHECK(split_jar_name("sodium-fabric-v0.5.3.jar").id == "sodium-fabric");
+    CHECK(split_jar_name("sodium-fabric-v0.5.3.jar").version == "v0.5.3");
+    CHECK(split_jar_name("Botania.jar").id == "botania");
+    CHECK(split_jar_name("Botania.jar").version.empty());
+    CHECK(split_jar_name("foo-.jar").id == "foo-");
+}
+
+TEST_CASE("Packs are compared by mod and by override", "[packs]")
+{
+    const TempDir dir("krompir_pack_test");
+    const auto& root = dir.path();
+
+    const auto old_pack = root / "old";
+    const auto new_pack = root / "new";
+
+    write_text(old_pack / "mods" / "jei-15.2.0.jar", "jei");
+    write_text(old_pack / "mods" / "create-0.5.0.jar", "create");
+    write_text(old_pack / "mods" / "optifine_HD_U.jar", "optifine");
+    write_text(old_pack / "config" / "jei.toml", "a = 1\n");
+    write_text(old_pack / "config" / "create.toml", "b = 1\n");
+    write_text(old_pack / "logs" / "latest.log", "not part of the pack");
+
+    write_text(new_pack / "mods" / "jei-15.3.0.jar", "jei, newer");
+    write_text(new_pack / "mods" / "create-0.5.0.jar", "create");
+    write_text(new_pack / "mods" / "sodium-0.5.3.jar", "sodium");
+    write_text(new_pack / "config" / "jei.toml", "a = 2\n");
+    write_text(new_pack / "overrides" / "config" / "create.toml", "b = 1\n");
+    write_text(new_pack / "options.txt", "fov:90\n");
+
+    PackCache cache;
+    PackCacheStats stats;
+
+    const auto from = krompir::packs::load_pack(old_pack, cache, stats, 2);
+    const auto to = krompir::packs::load_pack(new_pack, cache, stats, 2);
+
+    CHECK(from.name == "old");
+    CHECK(from.mods.size() == 3);
+    CHECK(from.overrides.size() == 2);
+    CHECK(stats.read == 11);
+
+    const auto diff = krompir::packs::diff_packs(from, to);
+
+    REQUIRE(diff.added_mods.size() == 1);
+    CHECK(diff.added_mods[0].id == "sodium");
+    REQUIRE(diff.updated_mods.size() == 1);
+    CHECK(diff.updated_mods[0].from.version == "15.2.0");
+    CHECK(diff.updated_mods[0].to.version == "15.3.0");
+    REQUIRE(diff.removed_mods.size() == 1);
+    CHECK(diff.removed_mods[0].id == "optifine_hd_u");
+    CHECK(diff.unchanged_mods == 1);
+
+    REQUIRE(diff.added_overrides.size() == 1);
+    CHECK(diff.added_overrides[0].path == "options.txt");
+    REQUIRE(diff.changed_overrides.size() == 1);
+    CHECK(diff.changed_overrides[0].to.path == "config/jei.toml");
+    CHECK(diff.removed_overrides.empty());
+    CHECK(diff.unchanged_overrides == 1);
+
+    std::ostringstream markdown;
+    krompir::packs::write_markdown(diff, markdown);
+    CHECK(markdown.str().find("| jei | 15.2.0 | 15.3.0 |") != std::string::npos);
+    CHECK(markdown.str().find("- Added `options.txt`") != std::string::npos);
+
+    std::ostringstream json;
+    krompir::packs::write_json(diff, json);
+    CHECK(json.str().find(R"("from": "15.2.0", "to": "15.3.0")") != std::string::npos);
+
+    // A warm cache, saved and read back, reads nothing
+    std::stringstream saved;
+    cache.write(saved);
+
+    PackCache restored;
+    restored.read(saved);
+    CHECK(restored.size() == cache.size());
+
+    PackCacheStats warm;
+    const auto again = krompir::packs::load_pack(new_pack, restored, warm);
+
+    CHECK(warm.read == 0);
+    CHECK(warm.unchanged == 6);
+    CHECK(krompir::packs::diff_packs(to, again).empty());
+}
+
+TEST_CASE("Packwiz and Modrinth lockfiles are read", "[packs]")
+{
+    const TempDir dir("krompir_lockfile_test");
+    const auto& root = dir.path();
+
+    write_text(root / "packwiz" / "pack.toml", "name = 'My Pack'\nversion = '1.1'\n");
+    write_text(root / "packwiz" / "index.toml", "hash-format = \"sha256\"\n");
+    write_text(
+        root / "packwiz" / "mods" / "jei.pw.toml",
+        "name = \"Just Enough Items\"\n"
+        "filename = \"jei-1.20.1-forge-15.2.0.27.jar\"\n"
+    );
+
+    write_text(
+        root / "modrinth" / "modrinth.index.json",
+        R"({
+  "name": "My Pack",
+  "versionId": "1.0",
+  "files": [
+    {"path": "mods/jei-1.20-forge-15.1.0.jar", "hashes": {"sha1": "a"}, "fileSize": 9},
+    {"path": "config/jei.toml", "hashes": {"sha1": "def"}, "fileSize": 4}
+  ]
+})"
+    );
+
+    PackCache cache;
+    PackCacheStats stats;
+
+    const auto packwiz = krompir::packs::load_pack(root / "packwiz", cache, stats);
+    CHECK(packwiz.name == "My Pack");
+    CHECK(packwiz.version == "1.1");
+    REQUIRE(packwiz.mods.size() == 1);
+    CHECK(packwiz.mods[0].id == "jei");
+    CHECK(packwiz.mods[0].name == "Just Enough Items");
+    CHECK(packwiz.mods[0].version == "1.20.1-forge-15.2.0.27");
+    CHECK(packwiz.overrides.empty());
+
+    const auto modrinth = krompir::packs::load_pack(
+        root / "modrinth" / "modrinth.index.json", cache, stats
+    );
+    CHECK(modrinth.version == "1.0");
+    REQUIRE(modrinth.mods.size() == 1);
+    CHECK(modrinth.mods[0].version == "1.20-forge-15.1.0");
+    REQUIRE(modrinth.overrides.size() == 1);
+    CHECK(modrinth.overrides[0].path == "config/jei.toml");
+    CHECK(modrinth.overrides[0].size == 4);
+
+    const auto diff = krompir::packs::diff_packs(modrinth, packwiz);
+    REQUIRE(diff.updated_mods.size() == 1);
+    CHECK(diff.removed_overrides.size() == 1);
+}
+
+TEST_CASE("The game folder of a launcher instance is the pack", "[packs]")
+{
+    const TempDir dir("krompir_instance_test");
+    const auto& root = dir.path();
+
+    const auto prism = root / "Prism Pack";
+    write_text(prism / "instance.cfg", "InstanceType=OneSix\n");
+    write_text(prism / "mmc-pack.json", "{}");
+    write_text(prism / ".minecraft" / "mods" / "jei-15.2.0.jar", "jei");
+    write_text(prism / ".minecraft" / "config" / "jei.toml", "a = 1\n");
+    write_text(prism / ".minecraft" / "logs" / "latest.log", "not part of the pack");
+
+    const auto multimc = root / "MultiMC Pack";
+    write_text(multimc / "instance.cfg", "InstanceType=OneSix\n");
+    write_text(multimc / "minecraft" / "mods" / "jei-15.2.0.jar", "jei");
+    write_text(multimc / "minecraft" / "config" / "jei.toml", "a = 1\n");
+
+    PackCache cache;
+    PackCacheStats stats;
+
+    for (const auto& instance : {prism, multimc}) {
+        const auto pack = krompir::packs::load_pack(instance, cache, stats);
+
+        CHECK(pack.name == instance.filename().string());
+        REQUIRE(pack.mods.size() == 1);
+        CHECK(pack.mods[0].path == "mods/jei-15.2.0.jar");
+        REQUIRE(pack.overrides.size() == 1);
+        CHECK(pack.overrides[0].path == "config/jei.toml");
+    }
+}
@@ -0,0 +1,89 @@
+/**
+ * @file test_files.hpp
+ * @brief Temporary folders and files for tests that read from disk.
+ * @copyright MIT
+ */
+#pragma once
+
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <string_view>
+#include <system_error>
+
+namespace krompir {
+namespace test {
+
+/**
+ * A fresh folder in the temporary directory, removed with everything in it
+ * when the test ends, whether it passed or not.
+ */
+class TempDir {
+    std::filesystem::path path_;
+
+public:
+    /**
+     * Create the folder.
+     *
+     * @param name Prefix of the folder name, made unique so concurrent runs do
+     *        not share it.
+     */
+    explicit TempDir(std::string_view name)
+    {
+        std::random_device random;
+        const auto suffix = std::to_string(random());
+
+        path_ = std::filesystem::temp_directory_path()
+                / (std::string(name) + "_" + suffix);
+        std::filesystem::remove_all(path_);
+        std::filesystem::create_directories(path_);
+    }
+
+    ~TempDir()
+    {
+        std::error_code err;
+        std::filesystem::remove_all(path_, err);
+    }
+
+    TempDir(const TempDir&) = delete;
+    TempDir& operator=(const TempDir&) = delete;
+    TempDir(TempDir&&) = delete;
+    TempDir& operator=(TempDir&&) = delete;
+
+    [[nodiscard]] const std::filesystem::path&
+    path() const noexcept
+    {
+        return path_;
+    }
+
+    [[nodiscard]] std::filesystem::path
+    operator/(const std::filesystem::path& relative) const
+    {
+        return path_ / relative;
+    }
+};
+
+/**
+ * Write a file, creating the folders it is in.
+ */
+inline void
+write_text(const std::filesystem::path& path, std::string_view text)
+{
+    std::filesystem::create_directories(path.parent_path());
+    std::ofstream(path, std::ofstream::out | std::ofstream::binary) << text;
+}
+
+/**
+ * Read a whole file.
+ */
+inline std::string
+read_text(const std::filesystem::path& path)
+{
+    std::ifstream file(path, std::ifstream::in | std::ifstream::binary);
+    return {std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+}
+
+} // namespace test
+} // namespace krompir
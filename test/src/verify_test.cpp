@@ -0,0 +1,202 @@
+#include "packs/verify.hpp"
+#include "test_files.hpp"
+#include "utils/strings.hpp"
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <filesystem>
+#include <sstream>
+#include <string>
+
+using krompir::packs::build_manifest;
+using krompir::packs::HashStats;
+using krompir::packs::PackCache;
+using krompir::packs::PackCacheStats;
+using krompir::packs::PackError;
+using krompir::packs::read_manifest;
+using krompir::packs::ReadBackend;
+using krompir::packs::verify_instance;
+using krompir::packs::write_manifest;
+using krompir::test::TempDir;
+using krompir::test::write_text;
+
+namespace {
+
+/**
+ * Make an instance with a file bigger than a few reads.
+ */
+void
+make_instance(const std::filesystem::path& root)
+{
+    std::string big(1'500'000, '\0');
+    for (std::size_t idx = 0; idx < big.size(); ++idx)
+        big[idx] = static_cast<char>(idx * 7 % 251);
+
+    write_text(root / "mods" / "big.jar", big);
+    write_text(root / "mods" / "small.jar", "small");
+    write_text(root / "config" / "empty.toml", "");
+    write_text(root / "config" / "jei.toml", "a = 1\n");
+    write_text(root / "options.txt", "fov:90\n");
+    write_text(root / "logs" / "latest.log", "not part of the instance");
+}
+
+} // namespace
+
+TEST_CASE("Manifests list the files of an instance", "[packs]")
+{
+    const TempDir dir("krompir_verify_manifest_test");
+    const auto& root = dir.path();
+    make_instance(root);
+
+    for (const auto backend : {ReadBackend::automatic, ReadBackend::blocking}) {
+        PackCache cache;
+        HashStats stats;
+        const auto manifest = build_manifest(root, cache, stats, 2, backend);
+
+        REQUIRE(manifest.files.size() == 5);
+        CHECK(manifest.files[0].path == "config/empty.toml");
+        CHECK(manifest.files[0].hash == krompir::utils::fnv1a(""));
+        CHECK(manifest.files[2].path == "mods/big.jar");
+        CHECK(manifest.files[2].size == 1'500'000);
+        CHECK(manifest.files[3].hash == krompir::utils::fnv1a("small"));
+        CHECK(stats.read == 5);
+        CHECK(stats.bytes_read == 1'500'000 + 5 + 6 + 7);
+
+        std::stringstream saved;
+        write_manifest(manifest, saved);
+        const auto loaded = read_manifest(saved);
+
+        REQUIRE(loaded.files.size() == 5);
+        CHECK(loaded.files[2].hash == manifest.files[2].hash);
+    }
+
+    // Paths are escaped, so any name can be saved
+    krompir::packs::Manifest odd;
+    odd.files.push_back({"config/new\nline\tand\\slash.txt", 1, 2});
+
+    std::stringstream saved;
+    write_manifest(odd, saved);
+    const auto loaded = read_manifest(saved);
+
+    REQUIRE(loaded.files.size() == 1);
+    CHECK(loaded.files[0].path == odd.files[0].path);
+    CHECK(loaded.files[0].size == 1);
+    CHECK(loaded.files[0].hash == 2);
+
+    // Both backends hash the same, and asking for io_uring without it fails
+    PackCache automatic;
+    HashStats automatic_stats;
+    const auto hash = build_manifest(root, automatic, automatic_stats, 1).files[2].hash;
+
+    PackCache blocking;
+    HashStats stats;
+    CHECK(
+        hash
+        == build_manifest(root, blocking, stats, 1, ReadBackend::blocking).files[2].hash
+    );
+
+    PackCache io_uring;
+    if (automatic_stats.backend == ReadBackend::io_uring) {
+        CHECK(
+            hash
+            == build_manifest(root, io_uring, stats, 1, ReadBackend::io_uring)
+                   .files[2]
+                   .hash
+        );
+    }
+    else {
+        CHECK_THROWS_AS(
+            build_manifest(root, io_uring, stats, 1, ReadBackend::io_uring), PackError
+        );
+    }
+}
+
+TEST_CASE("Instances are verified against their manifest", "[packs]")
+{
+    const TempDir dir("krompir_verify_instance_test");
+    const auto& root = dir.path();
+    make_instance(root);
+
+    PackCache cache;
+    HashStats stats;
+    const auto manifest = build_manifest(root, cache, stats);
+
+    auto report = verify_instance(root, manifest, cache);
+    CHECK(report.ok());
+    CHECK(report.intact == 5);
+    CHECK(report.stats.unchanged == 5);
+    CHECK(report.stats.read == 0);
+
+    std::filesystem::remove(root / "options.txt");
+    write_text(root / "config" / "extra.toml", "");
+    write_text(root / "config" / "jei.toml", "a = 2\n");
+    write_text(root / "mods" / "small.jar", "smaller");
+
+    PackCache cold;
+    report = verify_instance(root, manifest, cold);
+    CHECK_FALSE(report.ok());
+    CHECK(report.missing == std::vector<std::string>{"options.txt"});
+    CHECK(report.extra == std::vector<std::string>{"config/extra.toml"});
+    CHECK(
+        report.corrupt == std::vector<std::string>{"config/jei.toml", "mods/small.jar"}
+    );
+    CHECK(report.intact == 2);
+    CHECK(report.stats.read == 3); // The size of small.jar gives it away
+}
+
+TEST_CASE("Launcher instances are verified in their game folder", "[packs]")
+{
+    const TempDir dir("krompir_verify_prism");
+    const auto& root = dir.path();
+
+    write_text(root / "instance.cfg", "InstanceType=OneSix\n");
+    write_text(root / ".minecraft" / "mods" / "small.jar", "small");
+    write_text(root / ".minecraft" / "options.txt", "fov:90\n");
+
+    PackCache cache;
+    HashStats stats;
+    const auto manifest = build_manifest(root, cache, stats);
+
+    REQUIRE(manifest.files.size() == 2);
+    CHECK(manifest.files[0].path == "mods/small.jar");
+    CHECK(manifest.files[1].path == "options.txt");
+
+    // The same files, checked from the game folder itself
+    const auto report = verify_instance(root / ".minecraft", manifest, cache);
+    CHECK(report.ok());
+    CHECK(report.intact == 2);
+}
+
+TEST_CASE("Described files keep the hash of their content", "[packs]")
+{
+    const TempDir dir("krompir_verify_described_test");
+    const auto& root = dir.path();
+    make_instance(root);
+    const auto metafile = root / "mods" / "jei.pw.toml";
+    write_text(metafile, "name = \"JEI\"\n");
+
+    PackCache cache;
+    PackCacheStats described;
+    cache.describe(metafile, PackCache::FileType::metafile, described);
+
+    HashStats stats;
+    const auto manifest = build_manifest(root, cache, stats);
+    CHECK(stats.read == 6);
+
+    // The metafile is not read again, in this run or from a saved cache
+    std::stringstream saved;
+    cache.write(saved);
+    PackCache loaded;
+    loaded.read(saved);
+
+    for (auto* warm : {&cache, &loaded}) {
+        const auto report = verify_instance(root, manifest, *warm);
+        CHECK(report.ok());
+        CHECK(report.stats.unchanged == 6);
+        CHECK(report.stats.read == 0);
+    }
+
+    // And it still is described
+    cache.describe(metafile, PackCache::FileType::metafile, described);
+    CHECK(described.unchanged == 1);
+}
@@ -0,0 +1,194 @@
+#include "test_files.hpp"
+#include "world/nbt.hpp"
+#include "world/world_scan.hpp"
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <string_view>
+
+using krompir::test::TempDir;
+using krompir::world::NbtError;
+using krompir::world::UsageKind;
+using krompir::world::WorldUsage;
+
+namespace {
+
+/**
+ * Builds NBT by hand.
+ */
+struct NbtWriter {
+    std::string data;
+
+    void
+    u8(std::uint8_t value)
+    {
+        data.push_back(static_cast<char>(value));
+    }
+
+    void
+    u16(std::uint16_t value)
+    {
+        u8(static_cast<std::uint8_t>(value >> 8u));
+        u8(static_cast<std::uint8_t>(value & 0xFFu));
+    }
+
+    void
+    i32(std::uint32_t value)
+    {
+        u16(static_cast<std::uint16_t>(value >> 16u));
+        u16(static_cast<std::uint16_t>(value & 0xFFFFu));
+    }
+
+    void
+    str(std::string_view value)
+    {
+        u16(static_cast<std::uint16_t>(value.size()));
+        data += value;
+    }
+
+    void
+    tag(std::uint8_t type, std::string_view name)
+    {
+        u8(type);
+        str(name);
+    }
+
+    void
+    string_tag(std::string_view name, std::string_view value)
+    {
+        tag(8, name);
+        str(value);
+    }
+};
+
+/**
+ * A 1.20 style chunk using a few mods.
+ */
+std::string
+make_chunk()
+{
+    NbtWriter nbt;
+    nbt.tag(10, "");
+    nbt.tag(3, "DataVersion");
+    nbt.i32(3465);
+
+    // One section with stone and a cogwheel
+    nbt.tag(9, "sections");
+    nbt.u8(10);
+    nbt.i32(1);
+    nbt.tag(10, "block_states");
+    nbt.tag(9, "palette");
+    nbt.u8(10);
+    nbt.i32(2);
+    nbt.string_tag("Name", "minecraft:stone");
+    nbt.u8(0);
+    nbt.string_tag("Name", "create:cogwheel");
+    nbt.tag(10, "Properties");
+    nbt.string_tag("axis", "y");
+    nbt.u8(0);
+    nbt.u8(0);
+    nbt.tag(12, "data");
+    nbt.i32(2);
+    nbt.data.append(16, '\0');
+    nbt.u8(0);
+    nbt.u8(0);
+
+    // A belt holding an ingot
+    nbt.tag(9, "block_entities");
+    nbt.u8(10);
+    nbt.i32(1);
+    nbt.string_tag("id", "create:belt");
+    nbt.tag(9, "Items");
+    nbt.u8(10);
+    nbt.i32(1);
+    nbt.string_tag("id", "mekanism:ingot_osmium");
+    nbt.tag(1, "Count");
+    nbt.u8(1);
+    nbt.u8(0);
+    nbt.u8(0);
+
+    // And a named crow
+    nbt.tag(9, "Entities");
+    nbt.u8(10);
+    nbt.i32(1);
+    nbt.string_tag("id", "alexsmobs:crow");
+    nbt.string_tag("Name", "not:an_id");
+    nbt.u8(0);
+
+    nbt.u8(0);
+    return nbt.data;
+}
+
+} // namespace
+
+TEST_CASE("Chunk IDs are counted per namespace and kind", "[world]")
+{
+    WorldUsage usage;
+    krompir::world::count_chunk(make_chunk(), usage);
+
+    REQUIRE(usage.namespaces.size() == 4);
+    REQUIRE(usage.namespaces.at("minecraft")[UsageKind::block] == 1);
+    REQUIRE(usage.namespaces.at("create")[UsageKind::block] == 1);
+    REQUIRE(usage.namespaces.at("create")[UsageKind::block_entity] == 1);
+    REQUIRE(usage.namespaces.at("create").total() == 2);
+    REQUIRE(usage.namespaces.at("mekanism")[UsageKind::item] == 1);
+    REQUIRE(usage.namespaces.at("alexsmobs")[UsageKind::entity] == 1);
+    REQUIRE_FALSE(usage.namespaces.contains("not"));
+}
+
+TEST_CASE("Truncated NBT is rejected", "[world]")
+{
+    const auto chunk = make_chunk();
+
+    WorldUsage usage;
+    REQUIRE_THROWS_AS(
+        krompir::world::count_chunk(std::string_view(chunk).substr(0, 40), usage),
+        NbtError
+    );
+}
+
+TEST_CASE("Region files are scanned", "[world]")
+{
+    constexpr std::size_t SECTOR = 4096;
+
+    const TempDir world("krompir_world_test");
+    std::filesystem::create_directories(world / "region");
+
+    // Two uncompressed chunks and one pointing past the end of the file
+    const auto chunk = make_chunk();
+    std::string region(2 * SECTOR, '\0');
+
+    for (const std::size_t idx : {0, 33}) {
+        const auto sector = static_cast<std::uint32_t>(region.size() / SECTOR);
+
+        NbtWriter body;
+        body.i32(static_cast<std::uint32_t>(chunk.size() + 1));
+        body.u8(3);
+        body.data += chunk;
+        body.data.resize((body.data.size() + SECTOR - 1) / SECTOR * SECTOR);
+
+        const auto sectors = static_cast<std::uint32_t>(body.data.size() / SECTOR);
+
+        NbtWriter location;
+        location.i32((sector << 8u) | sectors);
+
+        region.replace(idx * 4, 4, location.data);
+        region += body.data;
+    }
+
+    region[2 * 4 + 2] = 0x7F;
+    region[2 * 4 + 3] = 1;
+
+    std::ofstream(world / "region" / "r.0.0.mca", std::ios::binary) << region;
+
+    const auto usage = krompir::world::scan_world(world.path(), 2);
+
+    REQUIRE(usage.regions == 1);
+    REQUIRE(usage.chunks == 3);
+    REQUIRE(usage.chunks_skipped == 1);
+    REQUIRE(usage.namespaces.at("create")[UsageKind::block] == 2);
+}